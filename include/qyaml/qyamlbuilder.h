@@ -1,16 +1,89 @@
 #pragma once
 
+#include <QByteArray>
 #include <QObject>
 
+#include "qyaml/qyamldocument.h"
+#include "qyaml/yamlnode.h"
 #include "qyaml_global.h"
 
+struct fy_event;
+struct fy_mark;
+struct fy_token;
+
+//! Builds QYamlDocument trees from the libfyaml event stream.
+//!
+//! The builder is only functional if the library was built against
+//! libfyaml, use isAvailable() to check.
 class QYAML_SHARED_EXPORT QYamlBuilder : public QObject
 {
-    Q_OBJECT
+  Q_OBJECT
+
+  struct Frame
+  {
+    SharedNode node;
+    qsizetype startByte = 0;
+    bool expectKey = true;
+    QString key;
+    int keyId = YamlStringPool::NoId;
+    int keyStart = -1;
+  };
+
 public:
-    explicit QYamlBuilder(QObject *parent = nullptr);
+  explicit QYamlBuilder(QObject* parent = nullptr);
 
-signals:
+  //! Returns true if the library was built with the libfyaml backend.
+  static bool isAvailable();
 
-};
+  //! Builds the documents from the UTF-8 encoded text.
+  //!
+  //! The text is not copied and must remain valid until build returns.
+  //! Node offsets are UTF-16 character offsets, the same as the offsets
+  //! produced by the native QYamlParser.
+  bool build(const QByteArray& utf8);
+
+  //! Returns the documents created by the last call to build().
+  QList<SharedDocument> documents() const;
+
+  //! Sets the QTextDocument revision that new documents are stamped with.
+  void setRevision(int revision);
 
+  //! Sets the pool that map keys, anchor names and tag handles are
+  //! interned in. If no pool is set they are not interned.
+  void setStringPool(QSharedPointer<YamlStringPool> pool);
+
+private:
+  QList<SharedDocument> m_documents;
+  SharedDocument m_currentDoc;
+  QList<Frame> m_stack;
+  int m_revision = 0;
+  QSharedPointer<YamlStringPool> m_stringPool;
+
+  const char* m_data = nullptr;
+  qsizetype m_size = 0;
+  qsizetype m_bytePos = 0;
+  int m_charPos = 0;
+
+  void handleEvent(fy_event* event);
+  //! Adds node to the collection being built. startByte and endByte span
+  //! its source, which is only decoded if it is a complex key.
+  void addChild(SharedNode node,
+                qsizetype startByte = 0,
+                qsizetype endByte = 0);
+  void addAnchor(fy_token* token);
+  YamlStringPool::Entry intern(const QString& text);
+  QString source(qsizetype startByte, qsizetype endByte) const;
+  bool isFlow() const;
+  int toOffset(const fy_mark* mark, int fallback = -1);
+  int toOffset(qsizetype bytePos);
+
+  //! Creates a node in the arena of the current document.
+  template<typename T, typename... Args>
+  YamlRef<T> createNode(Args&&... args)
+  {
+    auto arena = (m_currentDoc ? m_currentDoc->arena().data() : nullptr);
+    auto node = YamlArena::create<T>(arena, std::forward<Args>(args)...);
+    node->setDocument(m_currentDoc.data());
+    return node;
+  }
+};
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <QObject>
+#include <QPointer>
 #include <QTextCursor>
 
+#include <limits>
+
+#include "qyaml/yamlarena.h"
 #include "qyaml/yamlerrors.h"
 #include "qyaml/yamlnode.h"
+#include "qyaml/yamlnodetable.h"
+#include "qyaml/yamlstringpool.h"
 #include "qyaml_global.h"
 
 class YamlNode;
@@ -13,12 +19,30 @@ class YamlSequence;
 class YamlMapItem;
 class YamlYamlDirective;
 class YamlTagDirective;
+class QTextDocument;
 
 class QYAML_SHARED_EXPORT QYamlDocument : public QObject
 {
   Q_OBJECT
 public:
   explicit QYamlDocument(QObject* parent = nullptr);
+  ~QYamlDocument() override;
+
+  //! Returns the arena that the document's nodes are allocated from, or
+  //! nullptr if YamlArena::isEnabled() was false when the document was
+  //! created.
+  //!
+  //! The nodes are destroyed with the arena, hold the document or the
+  //! arena for as long as a node of the document is used.
+  //!
+  //! \sa YamlArena::create()
+  QSharedPointer<YamlArena> arena() const;
+
+  //! Returns the pool that the document's keys, anchor names and tag
+  //! handles were interned in, or nullptr if they were not.
+  QSharedPointer<YamlStringPool> stringPool() const;
+  //! Sets the pool that the document's strings are interned in.
+  void setStringPool(QSharedPointer<YamlStringPool> pool);
 
   //! Returns the major version value.
   //!
@@ -43,15 +67,9 @@ public:
   //! version is 1.2 (at present)
   bool isImplicitVersion() const;
 
-  //! Returns the QTextCursor start position of the version directive
-  QTextCursor versionStart() const;
-
   //! Returns the int start position of the version directive
   int versionStartPos() const;
 
-  //  //! Returns the start QTextCursor position of the version directive
-  //  void setVersionStart(const QTextCursor &versionStart);
-
   //! Returns the length of the version directive
   int versionLength() const;
 
@@ -64,31 +82,70 @@ public:
   //! otherwise false.
   void setImplicitVersion(bool implicitVersion);
 
-  //! Returns the QTextCursor for the start of the document text.
-  QTextCursor start();
-
   //! Returns the int position for the start of the document text.
   int startPos();
 
-  //! Sets the QTextCursor for the start of the document text.
-  void setStart(QTextCursor position, SharedStart start = nullptr);
+  //! Sets the int position for the start of the document text.
+  void setStart(int position, SharedStart start = nullptr);
 
   bool hasStart();
 
-  //! Returns the QTextCursor for the end of the document text.
-  QTextCursor end();
-
   //! Returns the int position for the end of the document text.
   int endPos();
 
-  //! Sets the QTextCursor for the end of the document text.
-  void setEnd(QTextCursor mark, SharedEnd end = nullptr);
+  //! Sets the int position for the end of the document text.
+  void setEnd(int mark, SharedEnd end = nullptr);
 
   bool hasEnd();
 
   //! Returns the text length for this document.
   int textLength();
 
+  //! Returns the QTextDocument revision that the node offsets were
+  //! calculated against.
+  //!
+  //! Nodes store plain character offsets rather than QTextCursor's. If the
+  //! QTextDocument::revision() no longer matches this value the offsets
+  //! are stale until the text is reparsed.
+  int revision() const;
+
+  //! Sets the QTextDocument revision that the node offsets were
+  //! calculated against.
+  void setRevision(int revision);
+
+  //! Returns the offset that the positions of the document and its nodes
+  //! are relative to.
+  //!
+  //! Documents parsed from a whole text have a base of 0, their positions
+  //! are offsets into the text. Documents parsed from a stream by
+  //! QYamlParser::feed(QByteArrayView) have positions relative to their
+  //! own start, and their base is where they start in the stream, which
+  //! can be too far in for an int.
+  qsizetype base() const;
+  //! Sets the offset that the positions of the document are relative to.
+  void setBase(qsizetype base);
+
+  //! Returns the QTextDocument the document was parsed from, or nullptr
+  //! if it was not parsed from one.
+  //!
+  //! YamlNode::start() and YamlNode::end() build their cursors in it.
+  QTextDocument* textDocument() const;
+  //! Sets the QTextDocument the document was parsed from.
+  void setTextDocument(QTextDocument* document);
+
+  //! Moves the document and every node within it by delta characters.
+  //!
+  //! Used after an edit earlier in the text so that the document does not
+  //! need to be reparsed.
+  void shift(int delta);
+
+  //! Removes the nodes that start within [from, to) and moves those at or
+  //! after to by delta characters, as does the end of the document.
+  //!
+  //! Used after an edit within the document so that only the lines it
+  //! touched need to be parsed again, their nodes are then added back.
+  void replaceRange(int from, int to, int delta);
+
   //! Returns the implicit start flag.
   //!
   //! If the document started with a start document tag (---) then false,
@@ -117,41 +174,66 @@ public:
   bool getExplicitTags() const;
   void setExplicitTags(bool ExplicitTags);
 
-  //! Returns the ordered list of yaml nodes.
+  //! Returns the nodes of the document in the order of the rows of
+  //! nodeTable(), depth first with siblings in position order.
   //!
-  //! To return the map of QTextCursor->Node then use the nodeMap() method.
+  //! To return the map of position->Node then use the nodeMap() method.
   QList<SharedNode> nodes() const;
 
-  //! Returns the map of QTextCursor->Node.
+  //! Returns the map of start position->Node, the outermost node where
+  //! more than one starts at a position.
+  //!
+  //! The map is made from nodeTable() on each call. To return the ordered
+  //! node list use the nodes() method.
+  QMap<int, SharedNode> nodeMap() const;
+
+  //! Returns the nodes of the document as a flat table.
   //!
-  //! To return the ordered node list use the nodes() method.
-  const QMap<QTextCursor, SharedNode>& nodeMap() const;
+  //! The table is the store of the document's nodes, the other node
+  //! accessors read it. It is rebuilt on first use after nodes are added
+  //! or removed. Parsers build it before handing the document over so that
+  //! later readers only walk the table.
+  const YamlNodeTable& nodeTable() const;
 
-  //! Returns the yaml root node item at index.
+  //! Returns the node of row index of nodeTable().
   SharedNode node(int index);
 
-  //! Returns the yaml root node item at the cursor.
+  //! Returns the innermost node that starts at the cursor.
   SharedNode node(QTextCursor cursor);
 
+  //! Returns the innermost node that starts at position, or nullptr if
+  //! none does.
+  SharedNode nodeAtPosition(int position);
+
   //! Adds a YamlNode* to the document and returns true if successful, otherwise
   //! returns false.
   //!
   //! Only scalars, maps and sequences can be added to the document. Other
-  //! types are internal sub types of these types.
-  bool addNode(SharedNode Data, bool root = false);
+  //! types are internal sub types of these types. The descendants of a
+  //! collection are added with it, nodes that are not the child of another
+  //! are the roots of nodeTable().
+  bool addNode(SharedNode Data);
 
   void addDirective(SharedNode directive);
 
-  QMap<QTextCursor, SharedTagDirective> tags() const;
-  void setTags(const QMap<QTextCursor, SharedTagDirective>& tags);
+  QMap<int, SharedTagDirective> tags() const;
+  void setTags(const QMap<int, SharedTagDirective>& tags);
   void addTag(SharedTagDirective tag);
   bool hasTag();
-  void removeTag(QTextCursor position);
+  void removeTag(int position);
 
-  QMap<QTextCursor, SharedReservedDirective> reserved() const;
-  void addReserved(const QMap<QTextCursor, SharedReservedDirective>& reserved);
+  QMap<int, SharedReservedDirective> reserved() const;
+  void addReserved(const QMap<int, SharedReservedDirective>& reserved);
   bool hasReserved();
-  void removeReserved(QTextCursor position);
+  void removeReserved(int position);
+
+  //! Adds an anchor to the document.
+  //!
+  //! Anchors are local to the document they are defined in.
+  void addAnchor(SharedAnchor anchor);
+  //! Returns the anchor with name, or nullptr if there is no such anchor.
+  SharedAnchor anchor(const QString& name) const;
+  QMap<QString, SharedAnchor> anchors() const;
 
   SharedYamlDirective getDirective() const;
   bool hasDirective();
@@ -176,6 +258,8 @@ public:
   void setWarnings(const YamlWarnings& newWarnings);
 
 private:
+  // declared first so that it is destroyed after every handle to a node.
+  QSharedPointer<YamlArena> m_arena;
   SharedYamlDirective m_directive;
   //! true if the directive string is NOT in document.
   bool m_implicitVersion = true;
@@ -184,27 +268,42 @@ private:
 
   bool explicitTags = false;
 
-  QTextCursor m_start;
-  QTextCursor m_end;
-  // holds ordered ROOT list of data
-  QList<SharedNode> m_root;
-  // holds ordered list of all nodes in document
-  QList<SharedNode> m_data;
-  // holds a map position => node* of ALL nodes.
-  QMap<QTextCursor, SharedNode> m_nodes;
+  int m_start = -1;
+  int m_end = -1;
+  int m_revision = 0;
+  qsizetype m_base = 0;
+  QPointer<QTextDocument> m_textDocument;
+  QSharedPointer<YamlStringPool> m_stringPool;
   // TODO maybe merge these with test.
-  QMap<QTextCursor, SharedYamlDirective> m_yaml;
-  QMap<QTextCursor, SharedTagDirective> m_tags;
-  QMap<QTextCursor, SharedReservedDirective> m_reserved;
+  QMap<int, SharedYamlDirective> m_yaml;
+  QMap<int, SharedTagDirective> m_tags;
+  QMap<int, SharedReservedDirective> m_reserved;
+  QMap<QString, SharedAnchor> m_anchors;
+  // holds every node of the document.
+  mutable YamlNodeTable m_table;
+  mutable bool m_tableValid = false;
 
   YamlErrors m_errors;
   YamlWarnings m_warnings;
 
-  bool addSequenceData(QSharedPointer<YamlSequence> sequence,
-                       QSharedPointer<YamlMapItem> item = nullptr);
-  bool addMapData(QSharedPointer<YamlMap> map,
-                  QSharedPointer<YamlMapItem> item = nullptr);
-  bool addMapItemData(QSharedPointer<YamlMapItem> item);
+  void addToTable(const SharedNode& node);
+  template<typename T>
+  static void shiftKeys(QMap<int, T>& map,
+                        int delta,
+                        int from = std::numeric_limits<int>::min())
+  {
+    QMap<int, T> shiftedMap;
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+      shiftedMap.insert(it.key() >= from ? it.key() + delta : it.key(),
+                        it.value());
+    }
+    map = shiftedMap;
+  }
+  template<typename T>
+  static void removeKeys(QMap<int, T>& map, int from, int to)
+  {
+    map.erase(map.lowerBound(from), map.lowerBound(to));
+  }
 };
 //! \typedef typedef QSharedPointer<QYamlDocument> SharedDocument
 //! typedef for a shared pointer to QYamlDocument.
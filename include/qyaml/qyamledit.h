@@ -51,12 +51,19 @@ private:
   QString m_filename;
   QString m_zipFile;
   HoverWidget* m_hoverWidget = nullptr;
-  SharedNode m_hoverNode = nullptr;
+  //! Only compared with the node under the mouse, the document it was in
+  //! may have been replaced since.
+  const YamlNode* m_hoverNode = nullptr;
   int m_hoverTime = HOVERTIME;
+  int m_revision = -1;
+  //! The length of the plain text, checked against each edit.
+  int m_textLength = 0;
 
   void killHoverWidget();
+  void showText(const QString& text);
   void textHasChanged(int position, int charsRemoved, int charsAdded);
   bool isInText(const QPoint& pos);
+  void updateVisibleBlocks();
 
   static const int HOVERTIME = 4000;
 };
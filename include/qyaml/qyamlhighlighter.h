@@ -1,7 +1,9 @@
 #pragma once
 
 #include <QColor>
+#include <QFutureWatcher>
 #include <QSyntaxHighlighter>
+#include <QTextBlock>
 
 #include "qyaml/yamlnode.h"
 #include "qyaml_global.h"
@@ -9,20 +11,23 @@
 class QYamlParser;
 class QYamlEdit;
 class YamlNode;
-class YamlMapItem;
+class YamlFormatter;
+struct YamlBlockFormats;
+class QTimer;
 
 class QYAML_SHARED_EXPORT QYamlHighlighter : public QSyntaxHighlighter
 {
   Q_OBJECT
 
-  struct FormatSize
+  //! Marks a block that was skipped in lazy mode.
+  struct BlockData : public QTextBlockUserData
   {
-    int start = -1;
-    int length = 0;
+    bool pending = false;
   };
 
 public:
   explicit QYamlHighlighter(QYamlParser* parser, QYamlEdit* parent);
+  ~QYamlHighlighter() override;
 
   const QColor& backgroundColor() const;
   void setBackgroundColor(const QColor& backgroundColor);
@@ -69,6 +74,31 @@ public:
   QColor warningColor() const;
   void setWarningColor(const QColor& warningColor);
 
+  //! Rehighlights the blocks that hold the (position, length) ranges.
+  //!
+  //! Connected to QYamlParser::tokensChanged() so that a parse only
+  //! reformats the blocks whose tokens changed. Each block is only
+  //! rehighlighted once. While the formats of a parse are being computed
+  //! the blocks are rehighlighted when they are ready.
+  void rehighlightRanges(const QList<QPair<int, int>>& ranges);
+
+  //! Returns true if lazy highlighting is enabled, default false.
+  bool isLazy() const;
+  //! Enables or disables lazy highlighting.
+  //!
+  //! In lazy mode only the blocks set by setVisibleBlocks(int, int) are
+  //! highlighted straight away. The rest are marked as pending and
+  //! highlighted in short slices while the event loop is idle, nearest
+  //! to the visible blocks first, so that a very large file shows its
+  //! highlighted text at once.
+  void setLazy(bool lazy);
+
+  //! Sets the numbers of the first and last blocks visible in the editor.
+  //!
+  //! Any pending blocks that are now visible are highlighted at once and
+  //! the idle highlighting restarts from the new position.
+  void setVisibleBlocks(int first, int last);
+
 protected:
 private:
   // QSyntaxHighlighter interface
@@ -92,39 +122,42 @@ private:
   QColor m_errorColor;
   QColor m_warningColor;
 
-  QTextCharFormat m_textFormat;
-  QTextCharFormat m_mapFormat;
-  QTextCharFormat m_mapKeyFormat;
-  QTextCharFormat m_mapValueFormat;
-  QTextCharFormat m_seqFormat;
-  QTextCharFormat m_seqValueFormat;
-  QTextCharFormat m_commentFormat;
-  QTextCharFormat m_scalarFormat;
-  QTextCharFormat m_directiveFormat;
-  QTextCharFormat m_tagFormat;
-  QTextCharFormat m_reservedFormat;
-  QTextCharFormat m_docStartFormat;
-  QTextCharFormat m_docEndFormat;
-  QTextCharFormat m_warningFormat;
-
-  bool isFormatable(int nodeStart,
-                    int nodeLength,
-                    int blockStart,
-                    int textLength,
-                    FormatSize& result);
-  void setScalarFormat(SharedNode node, int blockStart, int textLength);
-  void setKeyFormat(QSharedPointer<YamlMapItem> node,
-                    int blockStart,
-                    int nodeLength);
-  void setCommentFormat(SharedNode node, int blockStart, int textLength);
-  void setDirectiveFormat(SharedNode node, int blockStart, int textLength);
-  void setTagFormat(SharedNode node, int blockStart, int textLength);
-  void setReservedFormat(SharedNode node, int blockStart, int textLength);
-  void setMapFormat(SharedNode node, int blockStart, int textLength);
-  void setMapItemFormat(QSharedPointer<YamlMapItem> node,
-                        int blockStart,
-                        int textLength);
-  void setSequenceFormat(SharedNode node, int blockStart, int textLength);
-  void setStartTagFormat(SharedNode node, int blockStart, int textLength);
-  void setEndTagFormat(SharedNode node, int blockStart, int textLength);
+  //! Every format the highlighter uses, built by buildFormats() whenever a
+  //! colour changes and never modified while highlighting.
+  QList<QTextCharFormat> m_formats;
+  //! Formats blocks that have no precomputed ranges.
+  QSharedPointer<YamlFormatter> m_formatter;
+  //! The ranges of every block, computed on a worker thread after each
+  //! full parse. Only used while their revision matches the text.
+  QSharedPointer<YamlBlockFormats> m_blockFormats;
+  QFutureWatcher<YamlBlockFormats>* m_formatWatcher;
+  int m_formatRevision = -1;
+
+  bool m_lazy = false;
+  //! true while a pending block is being highlighted.
+  bool m_forced = false;
+  int m_firstVisible = 0;
+  int m_lastVisible = 0;
+  QTimer* m_idleTimer;
+  //! The next blocks above and below the visible blocks to check.
+  int m_above = -1;
+  int m_below = -1;
+  bool m_takeBelow = true;
+  //! Blocks were marked pending after the idle pass started.
+  bool m_rescan = false;
+
+  static constexpr int IDLE_SLICE = 8; // mS
+
+  bool isPending(const QTextBlock& block) const;
+  void setPending(bool pending);
+  void startIdle();
+  void resetIdle();
+  void highlightIdleSlice();
+
+  void buildFormats();
+  QColor color(int kind) const;
+  void startFormatting();
+  void formattingFinished();
+  void cancelFormatting();
+  void textChanged();
 };
@@ -1,14 +1,22 @@
 #pragma once
 
 #include <QFile>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QObject>
+#include <QPromise>
 #include <QRegularExpression>
+#include <QSet>
 #include <QSharedPointer>
 #include <QTextDocument>
 
+#include <functional>
+
 #include <config/baseconfig.h>
 
 #include "qyaml/qyamldocument.h"
+#include "qyaml/yamlarena.h"
+#include "qyaml/yamlstringpool.h"
 #include "qyaml/yamlnode.h"
 #include "qyaml_global.h"
 #include "utilities/characters.h"
@@ -16,6 +24,9 @@
 class QYamlDocument;
 class YamlNode;
 class YamlAnchor;
+class YamlBoundaryScanner;
+class YamlLines;
+class YamlTokens;
 
 class QYAML_SHARED_EXPORT QYamlSettings : public BaseConfig
 {
@@ -59,6 +70,22 @@ class QYAML_SHARED_EXPORT QYamlParser : public QObject
   };
 
 public:
+  //! The parser used to build the documents.
+  enum Backend
+  {
+    //! The built in line based parser.
+    NativeBackend,
+    //! The libfyaml event stream parser. If the library was built without
+    //! libfyaml the native parser is used instead.
+    FYamlBackend,
+  };
+
+  //! Constructs a parser that is not attached to a QTextDocument.
+  //!
+  //! Nodes only hold character offsets so a headless parser can be used
+  //! in worker threads or non GUI processes, each thread should use its
+  //! own parser. Use setTextDocument() to attach an editor document later.
+  explicit QYamlParser(QObject* parent = nullptr);
   explicit QYamlParser(QTextDocument* doc, QObject* parent = nullptr);
   explicit QYamlParser(QYamlSettings* settings,
                        QTextDocument* doc,
@@ -68,22 +95,162 @@ public:
 
   QString prettyPrint() const;
 
+  //! Returns the parser backend, default NativeBackend.
+  Backend backend() const;
+  //! Sets the parser backend.
+  //!
+  //! \sa QYamlBuilder::isAvailable()
+  void setBackend(Backend backend);
+
+  //! Returns true if the native parser splits the text at its document
+  //! boundaries and parses the documents on the thread pool, the default.
+  bool isThreaded() const;
+  //! Sets whether the native parser parses the documents on the thread
+  //! pool. If threaded is false the text is parsed in one pass on the
+  //! calling thread, the documents found are the same.
+  void setThreaded(bool threaded);
+
+  //! Returns the pool that map keys, anchor names and tag handles are
+  //! interned in.
+  //!
+  //! Unless a pool was set with setStringPool() each parse starts a new
+  //! pool, and each document read by feed(QByteArrayView) has a pool of
+  //! its own, so the parser does not hold on to the strings of text it
+  //! has finished with. Reparsing an edit adds to the pool of the
+  //! documents being edited. Documents hold a reference to the pool their
+  //! strings came from.
+  QSharedPointer<YamlStringPool> stringPool() const;
+  //! Sets the pool used for later parses, instead of a new pool for each.
+  //!
+  //! Parsers that share a pool share their strings, and ids can be
+  //! compared across their documents. pool must not be null.
+  void setStringPool(QSharedPointer<YamlStringPool> pool);
+
   //! Returns the file name loaded via loadFile(const QString&) or
   //! loadFromZip(const QString&, const QString&)
   const QString filename() const;
 
-  //! Loads the file in href into the editor.
+  //! Loads and parses the file in filename.
+  //!
+  //! The file is memory mapped and its UTF-8 text parsed in place. With
+  //! the libfyaml backend no UTF-16 copy of the text is made unless text()
+  //! is called, the file stays mapped until the next parse.
   bool loadFile(const QString& filename);
 
   //! Loads the file in href from the zipped file zipfile.
+  //!
+  //! The entry is decompressed a chunk at a time and each chunk passed to
+  //! feed(QByteArrayView), so each document is parsed as soon as it has
+  //! been decompressed. No temporary file is written.
   bool loadFromZip(const QString& zipFile, const QString& href);
 
+  //! Loads and parses several entries of the zipped file zipFile.
+  //!
+  //! The archive is opened once and each entry is decompressed in turn
+  //! and parsed on the global thread pool. If hrefs is empty every .yaml
+  //! and .yml entry is loaded. Returns a map of entry name to its
+  //! documents, entries that cannot be read are left out.
+  static QMap<QString, QList<SharedDocument>> loadArchive(
+    const QString& zipFile,
+    const QStringList& hrefs = QStringList(),
+    Backend backend = NativeBackend);
+
   //! Parses the text string from startPos for length characters.
   //!
   //! By default parse(const QString&) parses the entire text string
-  //! from the beginning.
+  //! from the beginning. Multi-document text is split at the document
+  //! markers and the documents are parsed in parallel.
   bool parse(const QString& text, int startPos = 0, int length = -1);
 
+  //! Parses UTF-8 encoded text.
+  bool parse(const QByteArray& utf8);
+
+  //! Reads and parses all of the UTF-8 encoded text in device. The device
+  //! is opened if it is not already open. Sequential devices, such as a
+  //! QuaZipFile, are read until they are exhausted.
+  bool parse(QIODevice* device);
+
+  //! Adds the next chunk of a UTF-8 stream.
+  //!
+  //! Each document is parsed, and documentParsed() emitted, as soon as the
+  //! '...' or '---' line that ends it arrives. Only the text of the
+  //! current document is held, parsed documents are not kept by the
+  //! parser. Node offsets are from the start of their document, the
+  //! offset of the document in the stream is QYamlDocument::base().
+  void feed(QByteArrayView data);
+
+  //! Ends the stream started by feed(QByteArrayView), parsing the last
+  //! document. The next call to feed() starts a new stream.
+  void finish();
+
+  //! Returns the number of bytes passed to feed(QByteArrayView) that are
+  //! not yet part of a parsed document.
+  qsizetype pendingSize() const;
+
+  //! Returns the attached QTextDocument, or nullptr for a headless parser.
+  QTextDocument* textDocument() const;
+
+  //! Attaches the parser to document.
+  //!
+  //! Documents created after this are stamped with the document revision
+  //! and createCursor(int) builds cursors in it.
+  void setTextDocument(QTextDocument* document);
+
+  //! Loads the file in filename and parses it on a worker thread.
+  //!
+  //! The documents are set, and parseComplete() emitted, on the parser's
+  //! own thread once the parse has finished. The returned future reports
+  //! progress and can be used to cancel the parse.
+  QFuture<QList<SharedDocument>> loadFileAsync(const QString& filename);
+
+  //! Parses the text string on a worker thread.
+  //!
+  //! Starting another parse, synchronous or not, cancels any parse that
+  //! is still running. \sa loadFileAsync(const QString&)
+  QFuture<QList<SharedDocument>> parseAsync(const QString& text);
+
+  //! Stamps every document with the current revision of the attached
+  //! QTextDocument and emits parseComplete() again.
+  //!
+  //! Used when text that has already been parsed, for instance by
+  //! loadFromZip(const QString&, const QString&), is then set in the
+  //! QTextDocument.
+  void updateRevision();
+
+  //! Returns true if the last parse only parsed the lines around an edit
+  //! again, false if it parsed the whole text.
+  //!
+  //! Only the ranges given by tokensChanged() can have changed after an
+  //! incremental parse.
+  bool isIncremental() const;
+
+  //! Returns true if an asynchronous parse is running.
+  bool isParsing() const;
+
+  //! Reparses text after an edit, as reported by
+  //! QTextDocument::contentsChange.
+  //!
+  //! This is reparse(int, int, QStringView) for callers that have the
+  //! whole of the new text. If text does not follow from the text of the
+  //! last parse it is parsed from scratch.
+  bool reparse(const QString& text,
+               int position,
+               int charsRemoved,
+               int charsAdded);
+
+  //! Reparses the text after an edit in which charsRemoved characters at
+  //! position were replaced by added, as reported by
+  //! QTextDocument::contentsChange.
+  //!
+  //! The edit is applied to the parser's own copy of the text so only the
+  //! added text is needed. Nodes never span lines, so an edit within a
+  //! document only has the lines it touches parsed again, the nodes after
+  //! it are moved by the change in length. An edit across documents has
+  //! those documents parsed again. Edits to document markers or
+  //! directives, or with the libfyaml backend, fall back to a full
+  //! parse().
+  bool reparse(int position, int charsRemoved, QStringView added);
+
   //! Returns the list of QyamlDocument's.
   //!
   //! Use isMultiDocument() to detect if there is more than one document,
@@ -107,6 +274,20 @@ public:
   //! returns nullptr;
   SharedNode nodeAt(QTextCursor cursor);
 
+  //! Returns the innermost node at the character offset position if it
+  //! exists otherwise returns nullptr;
+  //!
+  //! The lookup uses the position index of the document's node table so
+  //! is cheap enough to call on every mouse move.
+  SharedNode nodeAt(int position);
+
+  //! Returns a QTextCursor at the character offset position.
+  //!
+  //! Nodes only hold plain offsets, this builds a cursor on demand
+  //! for editors that need one. A null cursor is returned if there is no
+  //! attached QTextDocument.
+  QTextCursor createCursor(int position);
+
   bool isEmpty();
   int count();
 
@@ -115,34 +296,79 @@ public:
   QList<SharedDocument>::iterator end();
   QList<SharedDocument>::const_iterator constEnd();
 
+  //! Returns the parsed text.
+  //!
+  //! If the text was parsed from UTF-8 by the libfyaml backend it is
+  //! converted to UTF-16 by the first call.
   QString text() const;
 
   //  const QMap<QTextCursor, SharedNode>& nodes() const;
 
 signals:
   void parseComplete();
+  //! Emitted as an asynchronous parse progresses, value is the number of
+  //! documents parsed so far out of maximum.
+  void parseProgress(int value, int maximum);
+  //! Emitted for each document completed by feed(QByteArrayView) or
+  //! finish().
+  void documentParsed(SharedDocument document);
+  //! Emitted after parseComplete() with the (position, length) ranges of
+  //! the text whose highlighting can differ from the previous parse.
+  //!
+  //! Text that has only moved because of an edit earlier in the document
+  //! is not included, its formats move with it.
+  void tokensChanged(const QList<QPair<int, int>>& ranges);
 
 protected:
-  bool l_directive(const QString& line,
+  bool l_directive(QStringView line,
                    int& start,
                    SharedNode& d,
                    SharedComment& c);
-  bool s_l_comments(const QString& line,
+  bool s_l_comments(QStringView line,
                     int& start,
                     SharedComment& sharedcomment);
-  bool c_directives_end(const QString& line, int& start, SharedNode& node);
-  bool c_document_end(const QString& line, int& start, SharedNode& node);
-  bool l_document_suffix(const QString& line,
+  bool c_directives_end(QStringView line, int& start, SharedNode& node);
+  bool c_document_end(QStringView line, int& start, SharedNode& node);
+  bool l_document_suffix(QStringView line,
                          int& start,
                          SharedNode& n,
                          SharedComment& c);
-  bool s_b_comment(const QString& line,
+  bool s_b_comment(QStringView line,
                    int& start,
                    SharedComment& sharedcomment);
 
 private:
   QYamlSettings* m_settings = nullptr;
-  QString m_text;
+  //! The UTF-16 text, decoded from m_utf8 on demand.
+  mutable QString m_text;
+  //! The UTF-8 text parsed by the libfyaml backend, this may be a raw view
+  //! of m_mappedFile.
+  QByteArray m_utf8;
+  QSharedPointer<QFile> m_mappedFile;
+  QByteArray m_pending;
+  qsizetype m_scanned = 0;
+  qsizetype m_streamOffset = 0;
+  QSharedPointer<YamlBoundaryScanner> m_boundary;
+  //! The tokens of the last parse, compared with those of the next.
+  QSharedPointer<YamlTokens> m_tokens;
+  //! The documents that were reparsed in place since the last parse, the
+  //! tokens of the others are carried over from m_tokens.
+  QSet<const QYamlDocument*> m_reparsed;
+  //! The edit that the next parse follows, m_editPosition is -1 if it is
+  //! not known.
+  bool m_editPending = false;
+  int m_editPosition = -1;
+  int m_editRemoved = 0;
+  int m_editAdded = 0;
+  bool m_incremental = false;
+  //! The arena of the document being parsed.
+  QSharedPointer<YamlArena> m_arena;
+  //! The document the nodes being created belong to.
+  QYamlDocument* m_arenaDocument = nullptr;
+  QSharedPointer<YamlStringPool> m_stringPool =
+    QSharedPointer<YamlStringPool>::create();
+  //! true if m_stringPool was set by setStringPool() and is kept.
+  bool m_sharedPool = false;
   QTextDocument* m_document = nullptr;
   QMap<QString, SharedAnchor> m_anchors;
   QList<SharedDocument> m_documents;
@@ -150,10 +376,13 @@ private:
   QString m_zipFile;
   YamlErrors m_errors = NoErrors;
   YamlWarnings m_warnings = NoWarnings;
-  QTextCursor m_start;
-  QTextCursor m_end;
   int m_currentVersion = 12;
+  Backend m_backend = NativeBackend;
+  bool m_threaded = true;
+  QFutureWatcher<QList<SharedDocument>>* m_watcher = nullptr;
 
+  //! The size of the chunks that zip entries are decompressed in.
+  static constexpr qint64 CHUNK_SIZE = 64 * 1024;
   static constexpr int MAX_VERSION = 12;
   static constexpr int MIN_VERSION_MAJOR = 1;
   static constexpr int MAX_VERSION_MAJOR = 1; // for future expansion ??
@@ -175,28 +404,46 @@ private:
   //  static const QRegularExpression TAG_DIRECTIVE;
 
   SharedDocument parseDocumentStart(struct fy_event* event);
+  static bool parseRegions(QStringView text,
+                           int offset,
+                           int revision,
+                           QThread* owner,
+                           QSharedPointer<YamlStringPool> pool,
+                           QList<SharedDocument>& documents,
+                           QPromise<QList<SharedDocument>>* promise = nullptr);
+  QFuture<QList<SharedDocument>> startAsync(
+    std::function<bool(QString&)> read);
+  void cancelAsync();
+  void completeParse(bool incremental = false);
+  void setSource(const QString& text);
+  void parseStreamRegion(qsizetype regionEnd, qsizetype consumed);
+  void setSource(const QByteArray& utf8);
+  bool buildDocuments(const QByteArray& utf8);
+  int revision() const;
+  bool parseDocuments(QStringView text,
+                      int offset,
+                      QList<SharedDocument>& documents,
+                      SharedDocument into = nullptr,
+                      const YamlLines* lines = nullptr);
+  static bool isStructuralLine(QStringView text, int from, int to);
   bool resolveAnchors();
-  QTextCursor createCursor(int position);
   //  void parseFlowSequence(SharedSequence sequence,
   //                         int& i,
-  //                         const QString& text);
-  //  void parseFlowMap(SharedMap map, int& i, const QString& text);
-  //  QSharedPointer<YamlComment> parseComment(int& i, const QString& text);
-  //  QSharedPointer<YamlScalar> parseFlowScalar(const QString& text, int i);
-  bool getNextChar(QChar& c, const QString& text, int& i);
-  int getInitialSpaces(const QString& docText,
+  //                         QStringView text);
+  //  void parseFlowMap(SharedMap map, int& i, QStringView text);
+  //  YamlRef<YamlComment> parseComment(int& i, QStringView text);
+  //  YamlRef<YamlScalar> parseFlowScalar(QStringView text, int i);
+  bool getNextChar(QChar& c, QStringView text, int& i);
+  int getInitialSpaces(QStringView docText,
                        int initialIndent,
                        int& i,
                        QChar& c);
-  //  void buildDocuments(const QString& text,
+  //  void buildDocuments(QStringView text,
   //                      QList<SharedNode> nodes,
   //                      QList<SharedNode> rootNodes);
-  SharedNode nodeInSequence(QTextCursor cursor, SharedSequence seq);
-  SharedNode nodeInMap(QTextCursor cursor, SharedMap map);
-  SharedNode nodeOrRecurse(QTextCursor cursor, SharedNode node);
 
   QString lookahead(int& index,
-                    const QString& text,
+                    QStringView text,
                     QChar endof = Characters::NEWLINE);
   //  bool hasYamlDirective()
   //  {
@@ -211,43 +458,39 @@ private:
   bool e_node() { return false; }
   bool l_directive_document() { return false; }
 
-  bool ns_reserved_directive(const QString& line,
+  bool ns_reserved_directive(QStringView line,
                              int& start,
                              SharedNode& sharednode,
                              SharedComment& sharedcomment);
 
-  bool ns_char_plus(const QString& s, QString& value)
+  bool ns_char_plus(QStringView s, QString& value)
   {
-    QString result;
-    for (auto c : s) {
-      if (!ns_char(c)) {
-        if (!result.isEmpty()) {
-          value = result;
-          return true;
-        }
-        break;
-      }
-      result += c;
-    }
-    return false;
+    // the run is only copied once its end is found.
+    qsizetype length = 0;
+    while (length < s.length() && ns_char(s.at(length)))
+      length++;
+    if (length == 0 || length == s.length())
+      return false;
+    value = s.first(length).toString();
+    return true;
   }
 
-  bool ns_directive_parameter(const QString& s, QString& param);
+  bool ns_directive_parameter(QStringView s, QString& param);
 
-  bool ns_directive_name(const QString& s, QString& name);
+  bool ns_directive_name(QStringView s, QString& name);
 
-  bool ns_tag_directive(const QString& line,
+  bool ns_tag_directive(QStringView line,
                         int& start,
                         SharedNode& sharednode,
                         SharedComment& sharedcomment);
 
-  bool ns_yaml_directive(const QString& line,
+  bool ns_yaml_directive(QStringView line,
                          int& start,
                          SharedNode& sharednode,
                          SharedComment& sharedcomment);
 
   //! Returns true if a forbidden construct is passed
-  bool c_forbidden(const QString& line, SharedNode& node)
+  bool c_forbidden(QStringView line, SharedNode& node)
   {
     //    auto indent = initial_whitespace(line);
     //    // should start at beginning of line.
@@ -278,11 +521,11 @@ private:
   bool c_mapping_end(QChar c);
   bool c_comment(QChar c);
   //! non content or end of text
-  bool b_comment(const QString& line);
-  bool s_b_comment(const QString& s, QString& comment);
-  bool l_comment(const QString& s, int& start, SharedComment& sharedcomment);
+  bool b_comment(QStringView line);
+  bool s_b_comment(QStringView s, QString& comment);
+  bool l_comment(QStringView s, int& start, SharedComment& sharedcomment);
   bool b_as_line_feed(QChar c) { return (b_break(c)); }
-  bool c_nb_comment_text(const QString& line, QString& comment);
+  bool c_nb_comment_text(QStringView line, QString& comment);
   bool c_anchor(QChar c);
   bool c_alias(QChar c);
   bool c_tag(QChar c);
@@ -294,32 +537,32 @@ private:
   bool c_reserved(QChar c);
   bool c_escape(QChar c);
   bool c_ns_esc_char(QChar c);
-  bool c_ns_esc_char(const QString& line);
+  bool c_ns_esc_char(QStringView line);
   bool c_printable(QChar c);
-  bool c_ns_properties(const QString s,
+  bool c_ns_properties(QStringView s,
                        int& start,
                        QString& result,
                        YamlNode::TagHandleType& type);
 
-  bool c_ns_tag_property(const QString& text,
+  bool c_ns_tag_property(QStringView text,
                          SharedAnchorBase& base,
                          YamlNode::TagHandleType& type);
 
-  bool c_verbatim_tag(const QString& line, QString& uri);
+  bool c_verbatim_tag(QStringView line, QString& uri);
 
   //! Returns true if the string s contains valid ns shorthand tag. The tag
   //! value is set to the correct tag name if the tag is a named type. The
   //! type attribute is set to either YamlNode::Named, YamlNode::Secondary or
   //! YamlNode::Primary to specify the tag type.
-  bool c_ns_shorthand_tag(const QString& line,
+  bool c_ns_shorthand_tag(QStringView line,
                           QString& tag,
                           YamlNode::TagHandleType& type);
-  bool c_tag_handle(const QString& line,
+  bool c_tag_handle(QStringView line,
                     QString& tag,
                     YamlNode::TagHandleType& type);
-  bool c_primary_tag_handle(const QString& line);
-  bool c_secondary_tag_handle(const QString& line);
-  bool c_named_tag_handle(const QString& line, QString& tag);
+  bool c_primary_tag_handle(QStringView line);
+  bool c_secondary_tag_handle(QStringView line);
+  bool c_named_tag_handle(QStringView line, QString& tag);
 
   //! Returns true if c is a line feed character
   bool b_line_feed(QChar c);
@@ -340,9 +583,9 @@ private:
   bool b_non_content(QChar& c);
 
   //! Returns true for an empty scalar, otherwise false.
-  bool e_scalar(const QString& s) { return s.isEmpty(); }
+  bool e_scalar(QStringView s) { return s.isEmpty(); }
 
-  bool c_ns_alias_node(const QString& text, QString& name)
+  bool c_ns_alias_node(QStringView text, QString& name)
   {
     if (text.isEmpty())
       return false;
@@ -358,7 +601,7 @@ private:
     return false;
   }
 
-  bool ns_anchor_name(const QString& text, QString& name)
+  bool ns_anchor_name(QStringView text, QString& name)
   {
     auto i = 0;
     auto c = text.at(i++);
@@ -371,7 +614,7 @@ private:
     return false;
   }
 
-  //  bool c_ns_anchor_property(const QString& text, int& start, QString&
+  //  bool c_ns_anchor_property(QStringView text, int& start, QString&
   //  property)
   //  {
   //    if (text.isEmpty())
@@ -386,7 +629,7 @@ private:
   //    return false;
   //  }
 
-  bool c_ns_anchor_property(const QString& text,
+  bool c_ns_anchor_property(QStringView text,
                             SharedAnchorBase& base);
 
   bool nb_double_char(QChar c)
@@ -400,7 +643,7 @@ private:
 
   bool ns_double_char(QChar c) { return (nb_double_char(c) && !s_white(c)); }
 
-  bool c_double_quoted(const QString& line, QString& name)
+  bool c_double_quoted(QStringView line, QString& name)
   {
     if (line.isEmpty())
       return false;
@@ -413,7 +656,7 @@ private:
     return true;
   }
 
-  bool c_flow_sequence(const QString& text, int& start)
+  bool c_flow_sequence(QStringView text, int& start)
   {
     if (text.isEmpty())
       return false;
@@ -436,7 +679,7 @@ private:
     return false;
   }
 
-  bool ns_flow_sequence_entries(const QString& text)
+  bool ns_flow_sequence_entries(QStringView text)
   {
     if (text.isEmpty())
       return false;
@@ -450,7 +693,7 @@ private:
     return false;
   }
 
-  bool ns_flow_pair_entry(const QString& text)
+  bool ns_flow_pair_entry(QStringView text)
   {
     if (ns_flow_pair_yaml_key_entry(text) ||
         c_ns_flow_map_empty_key_entry(text) ||
@@ -460,18 +703,18 @@ private:
     return false;
   }
 
-  bool ns_flow_pair_yaml_key_entry(const QString& text) { return false; }
+  bool ns_flow_pair_yaml_key_entry(QStringView text) { return false; }
 
-  bool c_ns_flow_map_empty_key_entry(const QString& text) { return false; }
+  bool c_ns_flow_map_empty_key_entry(QStringView text) { return false; }
 
-  bool c_ns_flow_pair_json_key_entry(const QString& text)
+  bool c_ns_flow_pair_json_key_entry(QStringView text)
   {
     //    if (c_flow_json_node(c)) {
     //    }
     return false;
   }
 
-  bool c_flow_json_node(const QString& text)
+  bool c_flow_json_node(QStringView text)
   {
     if (c_ns_properties(text)) {
       return true;
@@ -479,7 +722,7 @@ private:
     return false;
   }
 
-  bool c_ns_properties(const QString& text)
+  bool c_ns_properties(QStringView text)
   {
     if (text.isEmpty())
       return false;
@@ -512,7 +755,7 @@ private:
 
   bool ns_flow_sequence_entry() {return false;}
 
-  bool s_separate_lines(const QString& text, SharedComment comment, int& length)
+  bool s_separate_lines(QStringView text, SharedComment comment, int& length)
   {
     auto s = text;
     auto p = 0;
@@ -526,7 +769,7 @@ private:
     return false;
   }
 
-  bool s_separate_in_line(const QString& text, int& length)
+  bool s_separate_in_line(QStringView text, int& length)
   {
     if (text.isEmpty())
       return false;
@@ -549,7 +792,7 @@ private:
     return false;
   }
 
-  bool s_flow_line_prefix(const QString& text, int& length)
+  bool s_flow_line_prefix(QStringView text, int& length)
   {
     auto indent = initial_whitespace(text);
     auto len = 0;
@@ -563,7 +806,7 @@ private:
     return false;
   }
 
-  bool s_separation_spaces(const QString& text,
+  bool s_separation_spaces(QStringView text,
                            int& length,
                            int& indent,
                            QList<SharedComment> comments)
@@ -617,10 +860,10 @@ private:
   bool s_space(QChar c);
   bool s_tab(QChar c);
   bool s_white(QChar c);
-  int s_indent(const QString& line);
-  bool s_indent_less_than(int value, const QString& line);
-  bool s_indent_less_or_equal(int value, const QString& line);
-  bool l_empty(const QString& line, int indent)
+  int s_indent(QStringView line);
+  bool s_indent_less_than(int value, QStringView line);
+  bool s_indent_less_or_equal(int value, QStringView line);
+  bool l_empty(QStringView line, int indent)
   {
     // TODO s_line_prefix
     if (/*s_line_prefix(line) || */ s_indent_less_than(indent, line)) {
@@ -639,14 +882,14 @@ private:
   // TODO s-flow-folded
   bool b_as_space(QChar c);
   //! Returns length of whitespace characters at start of text.
-  int initial_whitespace(const QString& s);
+  int initial_whitespace(QStringView s);
 
   bool ns_char(QChar c);
   bool ns_dec_digit(QChar c);
   bool ns_hex_digit(QChar c);
   bool ns_ascii_char(QChar c);
   bool ns_word_char(QChar c);
-  bool ns_uri_char(const QString& line);
+  bool ns_uri_char(QStringView line);
   bool ns_tag_char(QChar c);
   bool ns_esc_null(QChar& c);
   bool ns_esc_bell(QChar& c);
@@ -665,19 +908,31 @@ private:
   bool ns_esc_nb_space(QChar& c);
   bool ns_esc_line_seperator(QChar& c);
   bool ns_esc_paragraph_seperator(QChar& c);
-  bool ns_esc_8_bit(const QString& line);
-  bool ns_esc_16_bit(const QString& line);
-  bool ns_esc_32_bit(const QString& line);
+  bool ns_esc_8_bit(QStringView line);
+  bool ns_esc_16_bit(QStringView line);
+  bool ns_esc_32_bit(QStringView line);
   bool ns_tag_prefix(QChar c) { return false; }
   bool ns_anchor_char(QChar c);
 
   bool nb_json(QChar c);
 
   void createDocIfNull(int start, SharedDocument& currentDoc);
+  //! Starts a new string pool for the next parse, unless one was set by
+  //! setStringPool().
+  void resetStringPool();
+  //! Creates a node in the arena of the document being parsed.
+  template<typename T, typename... Args>
+  YamlRef<T> createNode(Args&&... args)
+  {
+    auto node =
+      YamlArena::create<T>(m_arena.data(), std::forward<Args>(args)...);
+    node->setDocument(m_arenaDocument);
+    return node;
+  }
   void storeNode(SharedDocument currentDoc,
                  SharedNode node,
                  int& start,
                  int length);
-  void bypassTextAndUpdatePos(QString& s, int& pos, QString result);
-  void bypassWhitespaceAndUpdatePos(QString& s, int& pos);
+  void bypassTextAndUpdatePos(QStringView& s, int& pos, QStringView result);
+  void bypassWhitespaceAndUpdatePos(QStringView& s, int& pos);
 };
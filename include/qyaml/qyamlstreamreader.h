@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QIODevice>
+#include <QList>
+
+#include <iterator>
+
+#include "qyaml/qyamldocument.h"
+#include "qyaml/qyamlparser.h"
+#include "qyaml_global.h"
+
+//! Reads the documents of a YAML stream one at a time.
+//!
+//! Only the document being read, and any others completed by the same
+//! chunk of input, are held so memory use does not grow with the length
+//! of the stream. Each document is released once the caller drops it.
+//!
+//! \code
+//! QYamlStreamReader reader(&file);
+//! for (auto doc : reader) {
+//!   ...
+//! }
+//! \endcode
+class QYAML_SHARED_EXPORT QYamlStreamReader
+{
+public:
+  //! A forward only iterator over the documents of the stream.
+  class iterator
+  {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = SharedDocument;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const SharedDocument*;
+    using reference = const SharedDocument&;
+
+    iterator() = default;
+    explicit iterator(QYamlStreamReader* reader);
+
+    reference operator*() const { return m_document; }
+    pointer operator->() const { return &m_document; }
+    iterator& operator++();
+    bool operator==(const iterator& other) const
+    {
+      return m_reader == other.m_reader && m_document == other.m_document;
+    }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+  private:
+    QYamlStreamReader* m_reader = nullptr;
+    SharedDocument m_document;
+  };
+
+  //! Constructs a reader for the UTF-8 text in device. The device is
+  //! opened if it is not already open, it is not owned by the reader.
+  explicit QYamlStreamReader(
+    QIODevice* device,
+    QYamlParser::Backend backend = QYamlParser::NativeBackend);
+  ~QYamlStreamReader();
+
+  //! Returns the next document or nullptr at the end of the stream.
+  //!
+  //! For sockets, pipes and other sequential devices this blocks until
+  //! enough data has arrived or the device is closed.
+  SharedDocument next();
+
+  //! Returns true if every document has been returned by next().
+  bool atEnd() const;
+
+  //! Returns the number of documents parsed but not yet returned by
+  //! next().
+  qsizetype readyCount() const;
+
+  //! Returns the number of bytes read from the device that are not yet
+  //! part of a parsed document.
+  qsizetype pendingSize() const;
+
+  iterator begin();
+  iterator end();
+
+private:
+  Q_DISABLE_COPY(QYamlStreamReader)
+
+  QIODevice* m_device;
+  QYamlParser* m_parser;
+  QList<SharedDocument> m_ready;
+  bool m_finished = false;
+
+  static constexpr qint64 CHUNK_SIZE = 64 * 1024;
+};
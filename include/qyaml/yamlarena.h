@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QList>
+#include <QSharedPointer>
+
+#include <new>
+#include <utility>
+
+#include "qyaml/yamlref.h"
+#include "qyaml_global.h"
+
+//! A bump pointer allocator for the nodes of a QYamlDocument.
+//!
+//! Memory is taken from large blocks rather than allocated per node. The
+//! arena owns the nodes made by create(), including their reference
+//! counts, so there is no allocation per node at all. When the arena is
+//! destroyed it runs the destructors of its nodes and releases all of the
+//! blocks together, handles to the nodes do not keep it alive.
+//!
+//! An arena is not thread safe, it is only used by the thread parsing
+//! its document.
+class QYAML_SHARED_EXPORT YamlArena
+{
+public:
+  explicit YamlArena(qsizetype blockSize = DEFAULT_BLOCK_SIZE);
+  ~YamlArena();
+
+  //! Returns size bytes aligned to alignment.
+  void* allocate(qsizetype size, qsizetype alignment);
+
+  //! Constructs a T in arena and returns a handle to it. If arena is null
+  //! the T is allocated on the heap and shared by its handles instead.
+  template<typename T, typename... Args>
+  static YamlRef<T> create(YamlArena* arena, Args&&... args)
+  {
+    if (!arena)
+      return YamlRef<T>(new T(std::forward<Args>(args)...));
+    return YamlRef<T>(arena->construct<T>(std::forward<Args>(args)...));
+  }
+
+  //! Returns true if new documents allocate their nodes from an arena,
+  //! the default.
+  static bool isEnabled();
+  //! Sets whether new documents allocate their nodes from an arena. With
+  //! the arena disabled every node is a separate heap allocation, which
+  //! is only useful to measure what the arena saves.
+  static void setEnabled(bool enabled);
+
+  //! Returns the number of allocations made from the arena.
+  qsizetype allocationCount() const;
+  //! Returns the number of bytes handed out by the arena.
+  qsizetype bytesAllocated() const;
+  //! Returns the number of blocks, the heap allocations actually made.
+  qsizetype blockCount() const;
+  //! Returns true if address is within the memory of the arena.
+  bool owns(const void* address) const;
+
+private:
+  Q_DISABLE_COPY(YamlArena)
+
+  //! Runs the destructor of an object when the arena is destroyed. The
+  //! record is allocated just before the object it destroys.
+  struct Destructor
+  {
+    Destructor* next;
+    void (*destroy)(Destructor* record);
+  };
+
+  struct Block
+  {
+    char* data;
+    qsizetype size;
+  };
+
+  //! Sorted by address.
+  QList<Block> m_blocks;
+  qsizetype m_blockSize;
+  char* m_current = nullptr;
+  qsizetype m_remaining = 0;
+  qsizetype m_allocations = 0;
+  qsizetype m_bytes = 0;
+  Destructor* m_destructors = nullptr;
+
+  static constexpr qsizetype DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+  template<typename T>
+  static constexpr qsizetype objectOffset()
+  {
+    return qsizetype((sizeof(Destructor) + alignof(T) - 1) &
+                     ~(alignof(T) - 1));
+  }
+
+  template<typename T>
+  static void destroy(Destructor* record)
+  {
+    auto memory = reinterpret_cast<char*>(record) + objectOffset<T>();
+    std::launder(reinterpret_cast<T*>(memory))->~T();
+  }
+
+  template<typename T, typename... Args>
+  T* construct(Args&&... args)
+  {
+    constexpr auto alignment = qMax(alignof(T), alignof(Destructor));
+    auto memory = static_cast<char*>(
+      allocate(objectOffset<T>() + qsizetype(sizeof(T)), alignment));
+    auto object = new (memory + objectOffset<T>())
+      T(std::forward<Args>(args)...);
+    object->m_ref.storeRelaxed(YamlRefCounted::ARENA_OWNED);
+    m_destructors = new (memory) Destructor{ m_destructors, &destroy<T> };
+    return object;
+  }
+};
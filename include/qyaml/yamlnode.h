@@ -1,17 +1,27 @@
 #pragma once
 
-#include <QObject>
+#include <QCoreApplication>
+#include <QMap>
 #include <QTextCursor>
 
 #include "qyaml/yamlerrors.h"
+#include "qyaml/yamlref.h"
+#include "qyaml/yamlstringpool.h"
 
-class YamlNode; // forward declare so QSharedPointer works;
+class QTextDocument;
+class QYamlDocument;
+class YamlNode; // forward declare so YamlRef works;
 //! \typedef typedef SharedNode SharedNode
-//! typedef for a shared pointer to YamlNode.
-typedef QSharedPointer<YamlNode> SharedNode;
-class YamlNode : public QObject
+//! typedef for a handle to YamlNode.
+typedef YamlRef<YamlNode> SharedNode;
+//! The base of the nodes of a QYamlDocument.
+//!
+//! Nodes are normally created in the YamlArena of their document and live
+//! as long as it does, a SharedNode does not keep them alive on its own.
+class YamlNode : public YamlRefCounted
 {
-  Q_OBJECT
+  Q_DECLARE_TR_FUNCTIONS(YamlNode)
+
 public:
   enum FlowType
   {
@@ -45,7 +55,8 @@ public:
     NonSpecific,
   };
 
-  YamlNode(QObject* parent = nullptr);
+  YamlNode();
+  virtual ~YamlNode() = default;
 
   SharedNode parent() const;
   void setParent(SharedNode Parent);
@@ -59,17 +70,51 @@ public:
   int getColumn() const;
   void setColumn(int column);
 
-  const QTextCursor& start() const;
+  //! Returns the document the node belongs to, or nullptr if it has not
+  //! been added to one.
+  QYamlDocument* document() const;
+  //! Sets the document the node belongs to. The parser sets this when it
+  //! creates the node, and QYamlDocument again when it builds its node
+  //! table.
+  void setDocument(QYamlDocument* document);
+
+  //! Returns a QTextCursor at the start of the node.
+  //!
+  //! The cursor is in the QTextDocument of the QYamlDocument the node
+  //! belongs to, or is null if there is none.
+  QTextCursor start() const;
+  //! Returns a QTextCursor at the start of the node within document.
+  //!
+  //! Nodes only store plain character offsets, the cursor is built on
+  //! demand and is not updated by later edits to the document.
+  QTextCursor start(QTextDocument* document) const;
+  //! Returns the character offset of the start of the node.
   int startPos() const;
-  void setStart(const QTextCursor& start);
+  void setStart(int start);
 
-  const QTextCursor& end() const;
+  //! Returns a QTextCursor at the end of the node.
+  //!
+  //! The cursor is in the QTextDocument of the QYamlDocument the node
+  //! belongs to, or is null if there is none.
+  QTextCursor end() const;
+  //! Returns a QTextCursor at the end of the node within document.
+  //!
+  //! Nodes only store plain character offsets, the cursor is built on
+  //! demand and is not updated by later edits to the document.
+  QTextCursor end(QTextDocument* document) const;
+  //! Returns the character offset of the end of the node.
   int endPos() const;
-  virtual void setEnd(const QTextCursor& end);
+  virtual void setEnd(int end);
 
   virtual int length() const;
   //  void setLength(int newLength);
 
+  //! Moves all of the stored offsets of this node by delta characters.
+  //!
+  //! Child nodes are not moved, QYamlDocument::shift(int) walks the
+  //! whole tree.
+  virtual void shift(int delta);
+
   //! Returns the value of the errors flags.
   const YamlErrors& errors() const;
 
@@ -81,7 +126,7 @@ public:
   void setErrors(const YamlErrors& newErrors);
 
   //! Returns true if the node has any errors.
-  bool hasErrors();
+  bool hasErrors() const;
 
   //! Returns the value of the warning flags.
   const YamlWarnings& warnings() const;
@@ -105,28 +150,28 @@ public:
   //! if the type of the node is Scalar.
   bool hasDodgyChar();
 
-  //! Returns a map of QTextCursor => YamlWarning.
+  //! Returns a map of character offset => YamlWarning.
   //!
   //! Certain characters such as inline tabs are allowed but not preferred
   //! within scalar values.
   //!
   //! This will indicate that there are non-preferred characters if and only
   //! if the type of the node is Scalar.
-  QMap<QTextCursor, YamlWarning> dodgyChars() const;
+  QMap<int, YamlWarning> dodgyChars() const;
 
   //! Certain characters such as inline tabs are allowed but not preferred
   //! within scalar values.
   //!
   //! This will indicate that there are non-preferred characters if and only
   //! if the type of the node is Scalar.
-  void addDodgyChar(QTextCursor pos, YamlWarning warning);
+  void addDodgyChar(int pos, YamlWarning warning);
 
   //! Certain characters such as inline tabs are allowed but not preferred
   //! within scalar values.
   //!
   //! This will indicate that there are non-preferred characters if and only
   //! if the type of the node is Scalar.
-  QMap<QTextCursor, YamlWarning>::size_type removeDodgyChar(QTextCursor pos);
+  QMap<int, YamlWarning>::size_type removeDodgyChar(int pos);
 
   Type type() const;
 
@@ -202,62 +247,66 @@ protected:
 
 private:
   SharedNode m_parent;
+  QYamlDocument* m_document = nullptr;
   int m_indent = 0;
   int m_row = 0;
   int m_column = 0;
-  QTextCursor m_start;
-  QTextCursor m_end;
+  int m_start = -1;
+  int m_end = -1;
 
   YamlErrors m_errors;
   YamlWarnings m_warnings;
-  QMap<QTextCursor, YamlWarning> m_dodgyChars;
+  QMap<int, YamlWarning> m_dodgyChars;
 };
 
 class YamlDirective : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlDirective(QObject* parent = nullptr);
+  YamlDirective();
 
-  QTextCursor nameStart() const;
-  void setNameStart(const QTextCursor& nameStart);
+  int nameStart() const;
+  void setNameStart(int nameStart);
 
   QString name() const;
   void setName(const QString& name);
 
+  // YamlNode interface
+  void shift(int delta) override;
+
 private:
   QString m_name;
-  QTextCursor m_nameStart;
+  int m_nameStart = -1;
 };
 
-//! \typedef typedef QSharedPointer<YamlDirective> SharedDirective
-//! typedef for a shared pointer to YamlDirective.
-typedef QSharedPointer<YamlDirective> SharedDirective;
+//! \typedef typedef YamlRef<YamlDirective> SharedDirective
+//! typedef for a handle to YamlDirective.
+typedef YamlRef<YamlDirective> SharedDirective;
 
 class YamlReservedDirective : public YamlDirective
 {
-  Q_OBJECT
 public:
-  YamlReservedDirective(QObject* parent = nullptr);
+  YamlReservedDirective();
 
-  void addParameter(QTextCursor cursor, const QString& param);
-  QString parameter(QTextCursor cursor);
-  QMap<QTextCursor, QString> parameters();
+  void addParameter(int position, const QString& param);
+  QString parameter(int position);
+  QMap<int, QString> parameters();
+
+  // YamlNode interface
+  void shift(int delta) override;
 
 private:
-  QMap<QTextCursor, QString> m_parameters;
+  QMap<int, QString> m_parameters;
 };
-//! \typedef typedef QSharedPointer<YamlReservedDirective>
-//! SharedReservedDirective typedef for a shared pointer to
+//! \typedef typedef YamlRef<YamlReservedDirective>
+//! SharedReservedDirective typedef for a handle to
 //! YamlReservedDirective.
-typedef QSharedPointer<YamlReservedDirective> SharedReservedDirective;
+typedef YamlRef<YamlReservedDirective> SharedReservedDirective;
 
 class YamlYamlDirective : public YamlDirective
 {
-  Q_OBJECT
 public:
-  YamlYamlDirective(QObject* parent = nullptr);
-  YamlYamlDirective(int major, int minor, QObject* parent = nullptr);
+  YamlYamlDirective();
+  YamlYamlDirective(int major, int minor);
 
   int major() const;
   void setMajor(int major);
@@ -267,124 +316,131 @@ public:
 
   bool isValid();
 
-  QTextCursor versionStart() const;
   int versionStartPos() const;
-  void setVersionStart(const QTextCursor& versionStart);
+  void setVersionStart(int versionStart);
+
+  // YamlNode interface
+  void shift(int delta) override;
 
 private:
   int m_major = 1;
   int m_minor = 2;
-  QTextCursor m_versionStart;
+  int m_versionStart = -1;
 };
 //! \typedef typedef SharedYamlDirective SharedYamlDirective
-//! typedef for a shared pointer to YamlYamlDirective.
-typedef QSharedPointer<YamlYamlDirective> SharedYamlDirective;
+//! typedef for a handle to YamlYamlDirective.
+typedef YamlRef<YamlYamlDirective> SharedYamlDirective;
 
 class YamlTagDirective : public YamlDirective
 {
-  Q_OBJECT
 public:
-  YamlTagDirective(QObject* parent = nullptr);
-  YamlTagDirective(const QString& handle,
-                   const QString& value,
-                   QObject* parent = nullptr);
+  YamlTagDirective();
+  YamlTagDirective(const QString& handle, const QString& value);
 
   bool isValid();
 
   QString value() const;
   void setValue(const QString& value);
-  void setValueStart(QTextCursor cursor);
-  QTextCursor valueStart();
+  void setValueStart(int position);
   int valueStartPos();
 
   QString handle() const;
-  void setHandle(const QString& id);
-  void setHandleStart(QTextCursor cursor);
-  QTextCursor handleStart();
+  //! Sets the handle, handleId being its id in a YamlStringPool if it was
+  //! interned.
+  void setHandle(const QString& id, int handleId = YamlStringPool::NoId);
+  //! Returns the YamlStringPool id of the handle, or YamlStringPool::NoId.
+  int handleId() const;
+  void setHandleStart(int position);
   int handleStartPos();
 
   TagHandleType handleType() const;
   void setHandleType(TagHandleType handleType);
 
+  // YamlNode interface
+  void shift(int delta) override;
+
 private:
   TagHandleType m_handleType = NoTagType;
-  QTextCursor m_handleStart;
+  int m_handleStart = -1;
   QString m_handle;
-  QTextCursor m_valueStart;
+  int m_handleId = YamlStringPool::NoId;
+  int m_valueStart = -1;
   QString m_value;
 };
 //! \typedef typedef SharedTagDirective SharedTagDirective
-//! typedef for a shared pointer to YamlTagDirective.
-typedef QSharedPointer<YamlTagDirective> SharedTagDirective;
+//! typedef for a handle to YamlTagDirective.
+typedef YamlRef<YamlTagDirective> SharedTagDirective;
 
 class YamlStart : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlStart(QObject* parent = nullptr);
+  YamlStart();
 };
 //! \typedef typedef SharedStart SharedStart
-//! typedef for a shared pointer to YamlStart.
-typedef QSharedPointer<YamlStart> SharedStart;
+//! typedef for a handle to YamlStart.
+typedef YamlRef<YamlStart> SharedStart;
 
 class YamlEnd : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlEnd(QObject* parent = nullptr);
+  YamlEnd();
 };
-//! \typedef typedef QSharedPointer<YamlEnd> SharedEnd
-//! typedef for a shared pointer to YamlEnd.
-typedef QSharedPointer<YamlEnd> SharedEnd;
+//! \typedef typedef YamlRef<YamlEnd> SharedEnd
+//! typedef for a handle to YamlEnd.
+typedef YamlRef<YamlEnd> SharedEnd;
 
 class YamlAnchorBase : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlAnchorBase(QObject* parent = nullptr);
+  YamlAnchorBase();
 
   QString name() const;
-  void setName(const QString& name);
+  //! Sets the name, nameId being its id in a YamlStringPool if it was
+  //! interned.
+  void setName(const QString& name, int nameId = YamlStringPool::NoId);
+  //! Returns the YamlStringPool id of the name, or YamlStringPool::NoId.
+  int nameId() const;
+
+  int nameStart() const;
+  void setNameStart(int nameStart);
 
-  QTextCursor nameStart() const;
-  void setNameStart(const QTextCursor& nameStart);
+  // YamlNode interface
+  void shift(int delta) override;
 
 private:
   QString m_name;
-  QTextCursor m_nameStart;
+  int m_nameId = YamlStringPool::NoId;
+  int m_nameStart = -1;
 };
-//! \typedef typedef QSharedPointer<YamlAnchor> SharedAnchor
-//! typedef for a shared pointer to YamlAnchor.
-typedef QSharedPointer<YamlAnchorBase> SharedAnchorBase;
+//! \typedef typedef YamlRef<YamlAnchor> SharedAnchor
+//! typedef for a handle to YamlAnchor.
+typedef YamlRef<YamlAnchorBase> SharedAnchorBase;
 
 class YamlAnchor : public YamlAnchorBase
 {
-  Q_OBJECT
 public:
-  YamlAnchor(QObject* parent = nullptr);
+  YamlAnchor();
 
 };
-//! \typedef typedef QSharedPointer<YamlAnchor> SharedAnchor
-//! typedef for a shared pointer to YamlAnchor.
-typedef QSharedPointer<YamlAnchor> SharedAnchor;
+//! \typedef typedef YamlRef<YamlAnchor> SharedAnchor
+//! typedef for a handle to YamlAnchor.
+typedef YamlRef<YamlAnchor> SharedAnchor;
 
 class YamlAlias : public YamlAnchorBase
 {
-  Q_OBJECT
 public:
-  YamlAlias(QObject* parent = nullptr);
+  YamlAlias();
 
 private:
   SharedAnchor m_anchor;
 
 };
-//! \typedef typedef QSharedPointer<YamlAnchor> SharedAnchor
-//! typedef for a shared pointer to YamlAnchor.
-typedef QSharedPointer<YamlAlias> SharedAlias;
+//! \typedef typedef YamlRef<YamlAnchor> SharedAnchor
+//! typedef for a handle to YamlAnchor.
+typedef YamlRef<YamlAlias> SharedAlias;
 
 class YamlScalar : public YamlNode
 {
-  Q_OBJECT
 public:
   enum Style
   {
@@ -392,8 +448,8 @@ public:
     SINGLEQUOTED,
     DOUBLEQUOTED,
   };
-  YamlScalar(QObject* parent = nullptr);
-  YamlScalar(QString value, QObject* parent = nullptr);
+  YamlScalar();
+  YamlScalar(QString value);
 
   QString data() const;
   void setData(const QString& data);
@@ -417,19 +473,24 @@ private:
   QString toFlowScalar(const QString& text);
   QString toBlockScalar(const QString& text);
 };
-//! \typedef typedef QSharedPointer<YamlScalar> SharedScalar
-//! typedef for a shared pointer to YamlScalar.
-typedef QSharedPointer<YamlScalar> SharedScalar;
+//! \typedef typedef YamlRef<YamlScalar> SharedScalar
+//! typedef for a handle to YamlScalar.
+typedef YamlRef<YamlScalar> SharedScalar;
 
 class YamlMapItem : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlMapItem(QObject* parent = nullptr);
-  YamlMapItem(const QString& key, SharedNode data, QObject* parent = nullptr);
+  YamlMapItem();
+  YamlMapItem(const QString& key, SharedNode data);
 
   const QString& key() const;
-  void setKey(const QString& key);
+  //! Sets the key, keyId being its id in a YamlStringPool if it was
+  //! interned.
+  void setKey(const QString& key, int keyId = YamlStringPool::NoId);
+  //! Returns the YamlStringPool id of the key, or YamlStringPool::NoId.
+  //!
+  //! Keys from the same pool can be compared by id.
+  int keyId() const;
   int keyLength() const;
 
   SharedNode data() const;
@@ -443,45 +504,47 @@ public:
 
 private:
   QString m_key;
+  int m_keyId = YamlStringPool::NoId;
   SharedNode m_data = nullptr;
-  QTextCursor m_keyStart;
-  QTextCursor m_dataStart;
 };
-//! \typedef typedef QSharedPointer<YamlMapItem> SharedMapItem
-//! typedef for a shared pointer to YamlMapItem.
-typedef QSharedPointer<YamlMapItem> SharedMapItem;
+//! \typedef typedef YamlRef<YamlMapItem> SharedMapItem
+//! typedef for a handle to YamlMapItem.
+typedef YamlRef<YamlMapItem> SharedMapItem;
 
 class YamlMap : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlMap(QObject* parent = nullptr);
-  YamlMap(QMap<QString, QSharedPointer<YamlMapItem>> data,
-          QObject* parent = nullptr);
+  YamlMap();
+  YamlMap(QMap<QString, YamlRef<YamlMapItem>> data);
 
-  QMap<QString, QSharedPointer<YamlMapItem>> data() const;
-  void setData(QMap<QString, QSharedPointer<YamlMapItem>> data);
-  bool insert(const QString& key, QSharedPointer<YamlMapItem> data);
+  QMap<QString, YamlRef<YamlMapItem>> data() const;
+  void setData(QMap<QString, YamlRef<YamlMapItem>> data);
+  bool insert(const QString& key, YamlRef<YamlMapItem> data);
   int remove(const QString& key);
-  QSharedPointer<YamlMapItem> value(const QString& key);
+  YamlRef<YamlMapItem> value(const QString& key);
+  //! Returns the item whose key has the YamlStringPool id keyId, or
+  //! nullptr. Only items with an interned key can be found this way.
+  YamlRef<YamlMapItem> value(int keyId) const;
   bool contains(const QString& key);
 
   // YamlNode interface
   QString toString(const QString& text, FlowType override) override;
 
 private:
-  QMap<QString, QSharedPointer<YamlMapItem>> m_data;
+  QMap<QString, YamlRef<YamlMapItem>> m_data;
+  QHash<int, YamlRef<YamlMapItem>> m_keyIds;
+
+  void indexKey(const YamlRef<YamlMapItem>& item);
 };
-//! \typedef typedef QSharedPointer<YamlMap> SharedMap
-//! typedef for a shared pointer to YamlMap.
-typedef QSharedPointer<YamlMap> SharedMap;
+//! \typedef typedef YamlRef<YamlMap> SharedMap
+//! typedef for a handle to YamlMap.
+typedef YamlRef<YamlMap> SharedMap;
 
 class YamlSequence : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlSequence(QObject* parent = nullptr);
-  YamlSequence(QVector<SharedNode> sequence, QObject* parent = nullptr);
+  YamlSequence();
+  YamlSequence(QVector<SharedNode> sequence);
 
   QVector<SharedNode> data() const;
   void setData(QVector<SharedNode> data);
@@ -489,7 +552,7 @@ public:
   void remove(int index);
   int indexOf(SharedNode node);
 
-  //  void setEnd(const QTextCursor& end) override;
+  //  void setEnd(int end) override;
 
   // YamlNode interface
   QString toString(const QString& text, FlowType override) override;
@@ -497,16 +560,15 @@ public:
 private:
   QVector<SharedNode> m_data;
 };
-//! \typedef typedef QSharedPointer<YamlSequence> SharedSequence
-//! typedef for a shared pointer to YamlSequence.
-typedef QSharedPointer<YamlSequence> SharedSequence;
+//! \typedef typedef YamlRef<YamlSequence> SharedSequence
+//! typedef for a handle to YamlSequence.
+typedef YamlRef<YamlSequence> SharedSequence;
 
 class YamlComment : public YamlNode
 {
-  Q_OBJECT
 public:
-  YamlComment(QObject* parent = nullptr);
-  YamlComment(QString value, QObject* parent = nullptr);
+  YamlComment();
+  YamlComment(QString value);
 
   void append(QChar c);
   QString data() const;
@@ -519,6 +581,6 @@ public:
 private:
   QString m_data;
 };
-//! \typedef typedef QSharedPointer<YamlComment> SharedComment
-//! typedef for a shared pointer to YamlComment.
-typedef QSharedPointer<YamlComment> SharedComment;
+//! \typedef typedef YamlRef<YamlComment> SharedComment
+//! typedef for a handle to YamlComment.
+typedef YamlRef<YamlComment> SharedComment;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QObject>
+
+#include "qyaml/yamlarena.h"
+#include "qyaml/yamlnode.h"
+#include "qyaml_global.h"
+
+//! A QObject wrapper around a YamlNode.
+//!
+//! Nodes are plain classes so that a large document does not pay for a
+//! QObject per node. Where a node has to be handed to something that
+//! expects a QObject, for example a property binding or a queued signal,
+//! it can be wrapped in a YamlNodeObject. The wrapper shares the node, it
+//! does not copy it, and holds the arena of the node's document so the
+//! node outlives the document if need be.
+class QYAML_SHARED_EXPORT YamlNodeObject : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int type READ type CONSTANT)
+  Q_PROPERTY(int startPos READ startPos CONSTANT)
+  Q_PROPERTY(int endPos READ endPos CONSTANT)
+  Q_PROPERTY(int length READ length CONSTANT)
+  Q_PROPERTY(bool hasErrors READ hasErrors CONSTANT)
+
+public:
+  explicit YamlNodeObject(SharedNode node, QObject* parent = nullptr);
+
+  //! Returns the wrapped node.
+  SharedNode node() const;
+
+  //! Returns the YamlNode::Type of the node.
+  int type() const;
+  int startPos() const;
+  int endPos() const;
+  int length() const;
+  bool hasErrors() const;
+
+private:
+  // declared first so that it is released after the node.
+  QSharedPointer<YamlArena> m_arena;
+  SharedNode m_node;
+};
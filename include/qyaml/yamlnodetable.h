@@ -0,0 +1,138 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "qyaml/yamlnode.h"
+#include "qyaml_global.h"
+
+//! A flat table of the nodes of a QYamlDocument.
+//!
+//! The node tree is laid out in depth first order as a set of parallel
+//! arrays, one per field, so that walking the document reads contiguous
+//! memory rather than following a pointer per node. Rows are addressed by
+//! index, the tree structure being held as parent, first child and next
+//! sibling indexes. The children of a node are in position order.
+//!
+//! The text of scalars and comments is kept in a side table so that the
+//! per row arrays stay small. node() returns the SharedNode of a row for
+//! code that needs the full node.
+//!
+//! The table is the only store of the nodes of a QYamlDocument. Nodes are
+//! added with add() and take their rows when the table is next built.
+//!
+//! The rows are also indexed by position, sorted by start offset with
+//! each row linked to the row whose span encloses it, so that rowAt()
+//! takes O(log n + depth) rather than a walk of the tree.
+class QYAML_SHARED_EXPORT YamlNodeTable
+{
+public:
+  //! The index of a row that does not exist, for example the parent of a
+  //! root node.
+  static constexpr int NoIndex = -1;
+
+  //! Builds the table from the given nodes and all of their descendants.
+  //!
+  //! A node may appear more than once in nodes, and may also be the
+  //! descendant of another, it only gets one row. Nodes that are not the
+  //! child of another node become roots, ordered by position.
+  void build(const QList<SharedNode>& nodes);
+  //! Rebuilds the table from its rows and the nodes added since it was
+  //! last built.
+  void build();
+  void clear();
+
+  //! Adds node and all of its descendants. The node has no row until the
+  //! table is rebuilt.
+  void add(const SharedNode& node);
+  //! Removes the nodes, added or with a row, for which predicate returns
+  //! true. The table has to be rebuilt afterwards.
+  template<typename Predicate>
+  void removeIf(Predicate predicate)
+  {
+    // the remaining nodes are built into new rows.
+    auto nodes = m_nodes;
+    nodes.append(m_added);
+    nodes.removeIf(predicate);
+    clear();
+    m_added = nodes;
+  }
+
+  //! Returns the number of rows.
+  int size() const;
+  bool isEmpty() const;
+
+  YamlNode::Type type(int index) const;
+  int startPos(int index) const;
+  int length(int index) const;
+  int endPos(int index) const;
+  int parent(int index) const;
+  int firstChild(int index) const;
+  int nextSibling(int index) const;
+  //! Returns the indexes of the root rows in position order.
+  const QList<int>& roots() const;
+
+  //! Returns the text of a scalar or comment row, otherwise an empty
+  //! string.
+  QString data(int index) const;
+
+  //! Returns the node that row index was built from.
+  SharedNode node(int index) const;
+
+  //! Returns the innermost row whose span contains position, or NoIndex
+  //! if there is none.
+  //!
+  //! A row contains the positions from its start up to, but not
+  //! including, its end.
+  int rowAt(int position) const;
+
+  //! Returns the rows whose span overlaps the positions from to to
+  //! inclusive, rows that enclose others first.
+  //!
+  //! As for rowAt() a row spans the positions from its start up to, but
+  //! not including, its end, so a row that ends at from is not returned.
+  //!
+  //! Used to visit only the nodes within a block of text rather than every
+  //! node in the document.
+  QList<int> rowsInRange(int from, int to) const;
+
+  //! Returns the rows that have a position sorted by start, rows that
+  //! enclose others first.
+  const QList<int>& rowsByPosition() const;
+
+  //! Returns the row of node, or NoIndex if it is not in the table.
+  int indexOf(const SharedNode& node) const;
+
+  //! Moves the position of every row by delta characters.
+  //!
+  //! Only the table is changed, the nodes must be moved separately.
+  void shift(int delta);
+
+private:
+  QList<quint8> m_types;
+  QList<int> m_starts;
+  QList<int> m_lengths;
+  QList<int> m_parents;
+  QList<int> m_firstChildren;
+  QList<int> m_nextSiblings;
+  // index into m_data, or NoIndex if the row has no text.
+  QList<int> m_dataIndexes;
+  QList<QString> m_data;
+  QList<SharedNode> m_nodes;
+  // nodes added since the table was built, they have no row yet.
+  QList<SharedNode> m_added;
+  QHash<YamlNode*, int> m_rows;
+  QList<int> m_roots;
+  // the position index, rows with a start sorted by start, outer rows
+  // before the rows they enclose.
+  QList<int> m_sortedRows;
+  QList<int> m_sortedStarts;
+  // the row whose span encloses each row, or NoIndex.
+  QList<int> m_enclosing;
+
+  int addRow(const SharedNode& node, int parent);
+  void addSubtree(const SharedNode& node, int parent);
+  void buildPositionIndex();
+  static QList<SharedNode> children(const SharedNode& node);
+};
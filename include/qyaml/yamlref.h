@@ -0,0 +1,200 @@
+#pragma once
+
+#include <QAtomicInt>
+#include <QHashFunctions>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "qyaml_global.h"
+
+class YamlArena;
+
+//! The reference count of an object handled by YamlRef.
+//!
+//! The count is held by the object itself, so a handle is a single pointer
+//! and no control block is allocated alongside the object. Objects created
+//! in a YamlArena belong to the arena instead, their count is never
+//! touched and they are destroyed when the arena is.
+class QYAML_SHARED_EXPORT YamlRefCounted
+{
+public:
+  //! Returns true if the object belongs to a YamlArena rather than to its
+  //! handles.
+  bool isArenaOwned() const { return m_ref.loadRelaxed() == ARENA_OWNED; }
+
+  //! Returns true if object belongs to an arena that is running the
+  //! destructors of its objects on this thread. The object may already
+  //! have been destroyed, so its handles must not touch it.
+  static bool isBeingDestroyed(const void* object);
+
+protected:
+  YamlRefCounted() = default;
+  // a copy is a new object, it has no handles yet.
+  YamlRefCounted(const YamlRefCounted&) {}
+  YamlRefCounted& operator=(const YamlRefCounted&) { return *this; }
+  ~YamlRefCounted() = default;
+
+private:
+  template<typename T>
+  friend class YamlRef;
+  friend class YamlArena;
+
+  static constexpr int ARENA_OWNED = -1;
+  mutable QAtomicInt m_ref;
+
+  void ref() const
+  {
+    if (m_ref.loadRelaxed() != ARENA_OWNED)
+      m_ref.ref();
+  }
+
+  //! Returns true if the last handle of a heap object was released.
+  bool deref() const
+  {
+    return (m_ref.loadRelaxed() != ARENA_OWNED && !m_ref.deref());
+  }
+};
+
+//! A handle to a YamlRefCounted object, used for the nodes of a
+//! QYamlDocument.
+//!
+//! A handle to a heap object shares it as QSharedPointer would, the object
+//! is deleted with its last handle. A handle to an object in a YamlArena
+//! does not own it. The object lives as long as its arena, so handles to
+//! the nodes of a document are only valid while the document, or its
+//! arena, is held.
+template<typename T>
+class YamlRef
+{
+public:
+  YamlRef() noexcept = default;
+  YamlRef(std::nullptr_t) noexcept {}
+  explicit YamlRef(T* object) noexcept
+    : m_object(object)
+  {
+    if (m_object)
+      m_object->ref();
+  }
+  YamlRef(const YamlRef& other) noexcept
+    : YamlRef(other.m_object)
+  {
+  }
+  YamlRef(YamlRef&& other) noexcept
+    : m_object(std::exchange(other.m_object, nullptr))
+  {
+  }
+  template<typename X,
+           std::enable_if_t<std::is_convertible_v<X*, T*>, bool> = true>
+  YamlRef(const YamlRef<X>& other) noexcept
+    : YamlRef(other.data())
+  {
+  }
+  template<typename X,
+           std::enable_if_t<std::is_convertible_v<X*, T*>, bool> = true>
+  YamlRef(YamlRef<X>&& other) noexcept
+    : m_object(std::exchange(other.m_object, nullptr))
+  {
+  }
+  ~YamlRef() { release(); }
+
+  YamlRef& operator=(YamlRef other) noexcept
+  {
+    swap(other);
+    return *this;
+  }
+
+  T* data() const noexcept { return m_object; }
+  T* get() const noexcept { return m_object; }
+  T* operator->() const noexcept { return m_object; }
+  T& operator*() const noexcept { return *m_object; }
+  explicit operator bool() const noexcept { return m_object != nullptr; }
+  bool operator!() const noexcept { return m_object == nullptr; }
+  bool isNull() const noexcept { return m_object == nullptr; }
+
+  void reset() noexcept { YamlRef().swap(*this); }
+  void reset(T* object) noexcept { YamlRef(object).swap(*this); }
+  void clear() noexcept { reset(); }
+  void swap(YamlRef& other) noexcept { std::swap(m_object, other.m_object); }
+
+private:
+  template<typename X>
+  friend class YamlRef;
+
+  T* m_object = nullptr;
+
+  void release()
+  {
+    // only the address is passed, the object may no longer exist.
+    if (m_object && !YamlRefCounted::isBeingDestroyed(m_object) &&
+        m_object->deref())
+      delete m_object;
+  }
+};
+
+template<typename T, typename X>
+bool
+operator==(const YamlRef<T>& lhs, const YamlRef<X>& rhs) noexcept
+{
+  return lhs.data() == rhs.data();
+}
+
+template<typename T, typename X>
+bool
+operator!=(const YamlRef<T>& lhs, const YamlRef<X>& rhs) noexcept
+{
+  return lhs.data() != rhs.data();
+}
+
+template<typename T>
+bool
+operator==(const YamlRef<T>& lhs, std::nullptr_t) noexcept
+{
+  return lhs.isNull();
+}
+
+template<typename T>
+bool
+operator!=(const YamlRef<T>& lhs, std::nullptr_t) noexcept
+{
+  return !lhs.isNull();
+}
+
+template<typename T>
+bool
+operator==(std::nullptr_t, const YamlRef<T>& rhs) noexcept
+{
+  return rhs.isNull();
+}
+
+template<typename T>
+bool
+operator!=(std::nullptr_t, const YamlRef<T>& rhs) noexcept
+{
+  return !rhs.isNull();
+}
+
+template<typename T>
+size_t
+qHash(const YamlRef<T>& ref, size_t seed = 0) noexcept
+{
+  return qHash(ref.data(), seed);
+}
+
+//! Returns ref cast to a YamlRef<X>, the object must be an X.
+template<typename X, typename T>
+YamlRef<X>
+yamlRefCast(const YamlRef<T>& ref)
+{
+  return YamlRef<X>(static_cast<X*>(ref.data()));
+}
+
+//! Returns ref cast to a YamlRef<X>, or a null handle if the object is not
+//! an X.
+template<typename X, typename T>
+YamlRef<X>
+yamlRefDynamicCast(const YamlRef<T>& ref)
+{
+  return YamlRef<X>(dynamic_cast<X*>(ref.data()));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QString>
+
+#include "qyaml_global.h"
+
+//! A pool of interned strings for map keys, anchor names and tag handles.
+//!
+//! Large files repeat the same few keys many thousands of times. Each
+//! distinct string is stored once, intern() returns the pooled copy, which
+//! shares its data with every other use of the same text, along with an
+//! id. Two strings from the same pool are equal if and only if their ids
+//! are equal.
+//!
+//! A pool can be shared between parsers, for example those parsing the
+//! documents of one stream on several threads, so it is thread safe.
+class QYAML_SHARED_EXPORT YamlStringPool
+{
+public:
+  //! The id of a string that was not interned.
+  static constexpr int NoId = -1;
+
+  struct Entry
+  {
+    int id = NoId;
+    QString text;
+  };
+
+  //! Returns the pooled copy of text and its id, adding text to the pool
+  //! if it is not already there.
+  Entry intern(const QString& text);
+
+  //! Returns the id of text, or NoId if it is not in the pool.
+  int id(const QString& text) const;
+
+  //! Returns the string with id, or an empty string if there is no such id.
+  QString string(int id) const;
+
+  //! Returns the number of distinct strings in the pool.
+  int size() const;
+
+  //! Returns the number of intern() calls that found their string already
+  //! in the pool, each one a string that did not need to be stored again.
+  qsizetype reuseCount() const;
+
+private:
+  mutable QReadWriteLock m_lock;
+  QHash<QString, int> m_ids;
+  QList<QString> m_strings;
+  QAtomicInteger<qsizetype> m_reused;
+};
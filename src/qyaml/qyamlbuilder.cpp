@@ -1,7 +1,402 @@
 #include "qyaml/qyamlbuilder.h"
+#include "qyaml/qyamldocument.h"
+#include "qyaml/yamlnode.h"
 
-QYamlBuilder::QYamlBuilder(QObject *parent)
-    : QObject{parent}
+#ifdef QYAML_HAS_FYAML
+#include <libfyaml.h>
+#endif
+
+//====================================================================
+//=== QYamlBuilder
+//====================================================================
+QYamlBuilder::QYamlBuilder(QObject* parent)
+  : QObject{ parent }
+{
+}
+
+bool
+QYamlBuilder::isAvailable()
+{
+#ifdef QYAML_HAS_FYAML
+  return true;
+#else
+  return false;
+#endif
+}
+
+QList<SharedDocument>
+QYamlBuilder::documents() const
+{
+  return m_documents;
+}
+
+void
+QYamlBuilder::setRevision(int revision)
+{
+  m_revision = revision;
+}
+
+void
+QYamlBuilder::setStringPool(QSharedPointer<YamlStringPool> pool)
+{
+  m_stringPool = pool;
+}
+
+YamlStringPool::Entry
+QYamlBuilder::intern(const QString& text)
+{
+  if (!m_stringPool)
+    return { YamlStringPool::NoId, text };
+  return m_stringPool->intern(text);
+}
+
+QString
+QYamlBuilder::source(qsizetype startByte, qsizetype endByte) const
 {
+  startByte = qBound(qsizetype(0), startByte, m_size);
+  endByte = qBound(startByte, endByte, m_size);
+  return QString::fromUtf8(m_data + startByte, endByte - startByte);
+}
+
+int
+QYamlBuilder::toOffset(qsizetype bytePos)
+{
+  // libfyaml marks are byte offsets into the UTF-8 text while nodes hold
+  // UTF-16 offsets. Marks arrive in (almost) ascending order so the
+  // conversion walks on from the last converted mark rather than from the
+  // start of the text. Only lead bytes count, four byte sequences become a
+  // surrogate pair.
+  bytePos = qBound(qsizetype(0), bytePos, m_size);
+  while (m_bytePos < bytePos) {
+    auto c = uchar(m_data[m_bytePos++]);
+    if ((c & 0xC0) != 0x80)
+      m_charPos += (c >= 0xF0 ? 2 : 1);
+  }
+  while (m_bytePos > bytePos) {
+    auto c = uchar(m_data[--m_bytePos]);
+    if ((c & 0xC0) != 0x80)
+      m_charPos -= (c >= 0xF0 ? 2 : 1);
+  }
+  return m_charPos;
+}
+
+#ifdef QYAML_HAS_FYAML
 
+int
+QYamlBuilder::toOffset(const fy_mark* mark, int fallback)
+{
+  if (!mark)
+    return fallback;
+  return toOffset(qsizetype(mark->input_pos));
 }
+
+bool
+QYamlBuilder::isFlow() const
+{
+  for (auto& frame : m_stack) {
+    if (frame.node->flowType() == YamlNode::Flow)
+      return true;
+  }
+  return false;
+}
+
+void
+QYamlBuilder::addChild(SharedNode node,
+                       qsizetype startByte,
+                       qsizetype endByte)
+{
+  if (m_stack.isEmpty()) {
+    m_currentDoc->addNode(node);
+    return;
+  }
+
+  auto& top = m_stack.last();
+  if (top.node->type() == YamlNode::Sequence) {
+    yamlRefCast<YamlSequence>(top.node)->append(node);
+  } else if (top.node->type() == YamlNode::Map) {
+    if (top.expectKey) {
+      // A scalar key is its value. A complex key, a collection or an
+      // alias, has no single value so is keyed by its source text, which
+      // keeps distinct keys apart.
+      auto scalar = yamlRefDynamicCast<YamlScalar>(node);
+      auto key =
+        intern(scalar ? scalar->data() : source(startByte, endByte));
+      top.key = key.text;
+      top.keyId = key.id;
+      top.keyStart = node->startPos();
+      top.expectKey = false;
+    } else {
+      auto item = createNode<YamlMapItem>();
+      item->setKey(top.key, top.keyId);
+      item->setData(node);
+      item->setStart(top.keyStart);
+      item->setEnd(node->endPos());
+      item->setFlowType(node->flowType());
+      yamlRefCast<YamlMap>(top.node)->insert(top.key, item);
+      top.key.clear();
+      top.keyId = YamlStringPool::NoId;
+      top.keyStart = -1;
+      top.expectKey = true;
+    }
+  }
+}
+
+void
+QYamlBuilder::addAnchor(fy_token* token)
+{
+  if (!token || !m_currentDoc)
+    return;
+  size_t len = 0;
+  auto text = fy_token_get_text(token, &len);
+  auto anchor = createNode<YamlAnchor>();
+  auto name = intern(QString::fromUtf8(text, qsizetype(len)));
+  anchor->setName(name.text, name.id);
+  anchor->setStart(toOffset(fy_token_start_mark(token)));
+  anchor->setEnd(toOffset(fy_token_end_mark(token)));
+  // the name follows the & indicator.
+  anchor->setNameStart(anchor->startPos() + 1);
+  m_currentDoc->addAnchor(anchor);
+}
+
+void
+QYamlBuilder::handleEvent(fy_event* event)
+{
+  auto start = toOffset(fy_event_start_mark(event));
+  auto end = toOffset(fy_event_end_mark(event), start);
+
+  switch (event->type) {
+    case FYET_NONE:
+    case FYET_STREAM_START:
+    case FYET_STREAM_END:
+      break;
+
+    case FYET_DOCUMENT_START: {
+      m_currentDoc = SharedDocument(new QYamlDocument());
+      m_currentDoc->setRevision(m_revision);
+      m_currentDoc->setStringPool(m_stringPool);
+      auto implicit = event->document_start.implicit;
+      if (implicit) {
+        m_currentDoc->setStart(start);
+        m_currentDoc->setImplicitStart(true);
+      } else {
+        auto docStart = createNode<YamlStart>();
+        docStart->setStart(start);
+        docStart->setEnd(start + 3);
+        m_currentDoc->setStart(start, docStart);
+      }
+
+      // libfyaml has already resolved the directives into the document
+      // state, it does not supply their positions.
+      auto state = event->document_start.document_state;
+      if (state) {
+        if (fy_document_state_version_explicit(state)) {
+          auto version = fy_document_state_version(state);
+          auto directive = createNode<YamlYamlDirective>(version->major,
+                                                         version->minor);
+          directive->setName(QStringLiteral("YAML"));
+          m_currentDoc->addDirective(directive);
+          m_currentDoc->setImplicitVersion(false);
+        }
+        if (fy_document_state_tags_explicit(state)) {
+          void* iter = nullptr;
+          const fy_tag* tag;
+          while ((tag = fy_document_state_tag_directive_iterate(state, &iter))) {
+            if (fy_document_state_tag_is_default(state, tag))
+              continue;
+            auto directive = createNode<YamlTagDirective>();
+            auto handle = intern(QString::fromUtf8(tag->handle));
+            directive->setHandle(handle.text, handle.id);
+            directive->setValue(QString::fromUtf8(tag->prefix));
+            directive->setName(QStringLiteral("TAG"));
+            m_currentDoc->addDirective(directive);
+          }
+          m_currentDoc->setExplicitTags(true);
+        }
+      }
+      break;
+    }
+
+    case FYET_DOCUMENT_END: {
+      if (!m_currentDoc)
+        break;
+      if (event->document_end.implicit) {
+        m_currentDoc->setEnd(end);
+        m_currentDoc->setImplicitEnd(true);
+      } else {
+        auto docEnd = createNode<YamlEnd>();
+        docEnd->setStart(start);
+        docEnd->setEnd(start + 3);
+        m_currentDoc->setEnd(end, docEnd);
+        m_currentDoc->setImplicitEnd(false);
+      }
+      m_documents.append(m_currentDoc);
+      m_currentDoc = nullptr;
+      m_stack.clear();
+      break;
+    }
+
+    case FYET_MAPPING_START:
+    case FYET_SEQUENCE_START: {
+      SharedNode node;
+      fy_token* anchor;
+      if (event->type == FYET_MAPPING_START) {
+        node = createNode<YamlMap>();
+        anchor = event->mapping_start.anchor;
+      } else {
+        node = createNode<YamlSequence>();
+        anchor = event->sequence_start.anchor;
+      }
+      node->setStart(start);
+      node->setFlowType(fy_event_get_node_style(event) == FYNS_FLOW
+                          ? YamlNode::Flow
+                          : YamlNode::Block);
+      addAnchor(anchor);
+      Frame frame;
+      frame.node = node;
+      frame.startByte = qsizetype(fy_event_start_mark(event)->input_pos);
+      m_stack.append(frame);
+      break;
+    }
+
+    case FYET_MAPPING_END:
+    case FYET_SEQUENCE_END: {
+      if (m_stack.isEmpty())
+        break;
+      auto frame = m_stack.takeLast();
+      // for flow collections this is the position of the closing bracket.
+      frame.node->setEnd(start);
+      addChild(frame.node,
+               frame.startByte,
+               qsizetype(fy_event_end_mark(event)->input_pos));
+      break;
+    }
+
+    case FYET_SCALAR: {
+      // The value has its quotes removed and its escapes and line folding
+      // processed. The marks still span the source text, quotes included,
+      // so they give the position and length.
+      size_t len = 0;
+      auto text = fy_token_get_text(event->scalar.value, &len);
+      auto scalar =
+        createNode<YamlScalar>(QString::fromUtf8(text, qsizetype(len)));
+      switch (fy_event_get_node_style(event)) {
+        case FYNS_SINGLE_QUOTED:
+          scalar->setStyle(YamlScalar::SINGLEQUOTED);
+          break;
+        case FYNS_DOUBLE_QUOTED:
+          scalar->setStyle(YamlScalar::DOUBLEQUOTED);
+          break;
+        default:
+          scalar->setStyle(YamlScalar::PLAIN);
+          break;
+      }
+      scalar->setStart(start);
+      scalar->setEnd(end);
+      scalar->setFlowType(isFlow() ? YamlNode::Flow : YamlNode::Block);
+      addAnchor(event->scalar.anchor);
+      addChild(scalar);
+      break;
+    }
+
+    case FYET_ALIAS: {
+      auto alias = createNode<YamlAlias>();
+      size_t len = 0;
+      auto text = fy_token_get_text(event->alias.anchor, &len);
+      auto name = intern(QString::fromUtf8(text, qsizetype(len)));
+      alias->setName(name.text, name.id);
+      alias->setStart(start);
+      alias->setEnd(end);
+      // the name follows the * indicator.
+      alias->setNameStart(start + 1);
+      addChild(alias,
+               qsizetype(fy_event_start_mark(event)->input_pos),
+               qsizetype(fy_event_end_mark(event)->input_pos));
+      break;
+    }
+  }
+}
+
+bool
+QYamlBuilder::build(const QByteArray& utf8)
+{
+  m_documents.clear();
+  m_currentDoc = nullptr;
+  m_stack.clear();
+  m_data = utf8.constData();
+  m_size = utf8.size();
+  m_bytePos = 0;
+  m_charPos = 0;
+
+  fy_parse_cfg cfg{};
+  cfg.flags = FYPCF_QUIET;
+  auto parser = fy_parser_create(&cfg);
+  if (!parser)
+    return false;
+
+  if (fy_parser_set_string(parser, m_data, size_t(m_size)) != 0) {
+    fy_parser_destroy(parser);
+    return false;
+  }
+
+  fy_event* event;
+  while ((event = fy_parser_parse(parser))) {
+    handleEvent(event);
+    fy_parser_event_free(parser, event);
+  }
+  auto result = !fy_parser_get_stream_error(parser);
+  fy_parser_destroy(parser);
+
+  // keep what was built before any error.
+  if (m_currentDoc) {
+    m_currentDoc->setEnd(toOffset(m_size));
+    m_documents.append(m_currentDoc);
+    m_currentDoc = nullptr;
+  }
+  m_stack.clear();
+  m_data = nullptr;
+  m_size = 0;
+
+  for (auto& doc : m_documents) {
+    doc->nodeTable();
+  }
+
+  return result;
+}
+
+#else
+
+int
+QYamlBuilder::toOffset(const fy_mark*, int fallback)
+{
+  return fallback;
+}
+
+bool
+QYamlBuilder::isFlow() const
+{
+  return false;
+}
+
+void
+QYamlBuilder::addChild(SharedNode, qsizetype, qsizetype)
+{
+}
+
+void
+QYamlBuilder::addAnchor(fy_token*)
+{
+}
+
+void
+QYamlBuilder::handleEvent(fy_event*)
+{
+}
+
+bool
+QYamlBuilder::build(const QByteArray&)
+{
+  m_documents.clear();
+  return false;
+}
+
+#endif
@@ -1,15 +1,43 @@
 #include "qyaml/qyamldocument.h"
 #include "qyaml/yamlnode.h"
-#include "utilities/ContainerUtil.h"
+
+#include <QSet>
 
 //====================================================================
 //=== QYamlDocument
 //====================================================================
 QYamlDocument::QYamlDocument(QObject* parent)
   : QObject(parent)
+  , m_arena(YamlArena::isEnabled() ? new YamlArena() : nullptr)
 {
 }
 
+QYamlDocument::~QYamlDocument()
+{
+  // a node held elsewhere must not point at a deleted document.
+  for (auto i = 0; i < m_table.size(); i++) {
+    m_table.node(i)->setDocument(nullptr);
+  }
+}
+
+QSharedPointer<YamlArena>
+QYamlDocument::arena() const
+{
+  return m_arena;
+}
+
+QSharedPointer<YamlStringPool>
+QYamlDocument::stringPool() const
+{
+  return m_stringPool;
+}
+
+void
+QYamlDocument::setStringPool(QSharedPointer<YamlStringPool> pool)
+{
+  m_stringPool = pool;
+}
+
 int
 QYamlDocument::majorVersion() const
 {
@@ -56,54 +84,41 @@ QYamlDocument::setImplicitVersion(bool implicitVersion)
   m_implicitVersion = implicitVersion;
 }
 
-QTextCursor
-QYamlDocument::start()
-{
-  return m_start;
-}
-
 int
 QYamlDocument::startPos()
 {
-  return m_start.position();
+  return m_start;
 }
 
 void
-QYamlDocument::setStart(QTextCursor position, SharedStart start)
+QYamlDocument::setStart(int position, SharedStart start)
 {
+  m_tableValid = false;
   m_start = position;
   m_implicitStart = false;
-  if (start) {
-    m_data.append(start);
-    m_nodes.insert(start->start(), start);
-  }
+  if (start)
+    addToTable(start);
 }
 
 bool
 QYamlDocument::hasStart()
 {
-  return !m_start.isNull();
-}
-
-QTextCursor
-QYamlDocument::end()
-{
-  return m_end;
+  return m_start >= 0;
 }
 
 int
 QYamlDocument::endPos()
 {
-  return m_end.position();
+  return m_end;
 }
 
 void
-QYamlDocument::setEnd(QTextCursor mark, SharedEnd end)
+QYamlDocument::setEnd(int mark, SharedEnd end)
 {
+  m_tableValid = false;
   if (end) {
-    m_end = end->end();
-    m_data.append(end);
-    m_nodes.insert(end->start(), end);
+    m_end = end->endPos();
+    addToTable(end);
   } else {
     m_end = mark;
     m_implicitEnd = false;
@@ -113,13 +128,124 @@ QYamlDocument::setEnd(QTextCursor mark, SharedEnd end)
 bool
 QYamlDocument::hasEnd()
 {
-  return !m_end.isNull();
+  return m_end >= 0;
 }
 
 int
 QYamlDocument::textLength()
 {
-  return m_end.position() - m_start.position();
+  return m_end - m_start;
+}
+
+int
+QYamlDocument::revision() const
+{
+  return m_revision;
+}
+
+void
+QYamlDocument::setRevision(int revision)
+{
+  m_revision = revision;
+}
+
+qsizetype
+QYamlDocument::base() const
+{
+  return m_base;
+}
+
+void
+QYamlDocument::setBase(qsizetype base)
+{
+  m_base = base;
+}
+
+QTextDocument*
+QYamlDocument::textDocument() const
+{
+  return m_textDocument;
+}
+
+void
+QYamlDocument::setTextDocument(QTextDocument* document)
+{
+  m_textDocument = document;
+}
+
+void
+QYamlDocument::shift(int delta)
+{
+  if (delta == 0)
+    return;
+  if (m_start >= 0)
+    m_start += delta;
+  if (m_end >= 0)
+    m_end += delta;
+
+  // The table holds each node once however many containers it is in.
+  auto& table = nodeTable();
+  for (auto i = 0; i < table.size(); i++) {
+    table.node(i)->shift(delta);
+  }
+  m_table.shift(delta);
+
+  shiftKeys(m_yaml, delta);
+  shiftKeys(m_tags, delta);
+  shiftKeys(m_reserved, delta);
+}
+
+void
+QYamlDocument::replaceRange(int from, int to, int delta)
+{
+  // The nodes to remove are found by where they were, a node moved back
+  // by a deletion can land within the range.
+  QSet<YamlNode*> removed;
+  auto& table = nodeTable();
+  for (auto i = 0; i < table.size(); i++) {
+    auto node = table.node(i);
+    if (node->startPos() >= to) {
+      node->shift(delta);
+    } else if (node->startPos() >= from) {
+      removed.insert(node.data());
+    } else if (node->endPos() >= to) {
+      // a node around the range, the document start for instance.
+      node->setEnd(node->endPos() + delta);
+    }
+  }
+  if (m_end >= to)
+    m_end += delta;
+
+  auto isRemoved = [&removed](const SharedNode& node) {
+    return removed.contains(node.data());
+  };
+  m_table.removeIf(isRemoved);
+  m_anchors.removeIf([&isRemoved](QMap<QString, SharedAnchor>::iterator it) {
+    return isRemoved(it.value());
+  });
+  if (m_directive && isRemoved(m_directive))
+    m_directive = nullptr;
+  removeKeys(m_yaml, from, to);
+  removeKeys(m_tags, from, to);
+  removeKeys(m_reserved, from, to);
+  shiftKeys(m_yaml, delta, to);
+  shiftKeys(m_tags, delta, to);
+  shiftKeys(m_reserved, delta, to);
+  m_tableValid = false;
+}
+
+const YamlNodeTable&
+QYamlDocument::nodeTable() const
+{
+  if (!m_tableValid) {
+    m_table.build();
+    m_tableValid = true;
+    auto self = const_cast<QYamlDocument*>(this);
+    for (auto i = 0; i < m_table.size(); i++) {
+      m_table.node(i)->setDocument(self);
+    }
+  }
+  return m_table;
 }
 
 bool
@@ -149,46 +275,53 @@ QYamlDocument::setExplicitTags(bool ExplicitTags)
 QList<SharedNode>
 QYamlDocument::nodes() const
 {
-  return m_data;
+  auto& table = nodeTable();
+  QList<SharedNode> nodes;
+  nodes.reserve(table.size());
+  for (auto row = 0; row < table.size(); row++) {
+    nodes.append(table.node(row));
+  }
+  return nodes;
 }
 
 SharedNode
 QYamlDocument::node(int index)
 {
-  return m_data.at(index);
+  return nodeTable().node(index);
 }
 
 SharedNode
 QYamlDocument::node(QTextCursor cursor)
 {
-  return m_nodes.value(cursor, nullptr);
+  return nodeAtPosition(cursor.position());
+}
+
+SharedNode
+QYamlDocument::nodeAtPosition(int position)
+{
+  auto& table = nodeTable();
+  // the rows starting at position come outermost first.
+  SharedNode node;
+  for (auto row : table.rowsInRange(position, position)) {
+    if (table.startPos(row) == position)
+      node = table.node(row);
+  }
+  return node;
 }
 
 bool
-QYamlDocument::addNode(SharedNode data, bool root)
+QYamlDocument::addNode(SharedNode data)
 {
   switch (data->type()) {
     case YamlNode::Comment:
     case YamlNode::Scalar:
+    case YamlNode::Anchor:
     case YamlNode::Start:
     case YamlNode::End:
-      m_data.append(data);
-      if (root)
-        m_root.append(data);
-      m_nodes.insert(data->start(), data);
+    case YamlNode::Sequence:
+    case YamlNode::Map:
+      addToTable(data);
       return true;
-    case YamlNode::Sequence: {
-      m_data.append(data);
-      if (root)
-        m_root.append(data);
-      return addSequenceData(qSharedPointerDynamicCast<YamlSequence>(data));
-    }
-    case YamlNode::Map: {
-      m_data.append(data);
-      if (root)
-        m_root.append(data);
-      return addMapData(qSharedPointerDynamicCast<YamlMap>(data));
-    }
     default:
       return false;
   }
@@ -197,135 +330,34 @@ QYamlDocument::addNode(SharedNode data, bool root)
 void
 QYamlDocument::addDirective(SharedNode directive)
 {
-  auto yaml = qSharedPointerDynamicCast<YamlYamlDirective>(directive);
+  auto yaml = yamlRefDynamicCast<YamlYamlDirective>(directive);
   if (yaml) {
     if (m_yaml.isEmpty()) {
       //      directive->setError(YamlError::TooManyYamlDirectivesError, true);
       //    } else {
       m_directive = yaml;
     }
-    m_yaml.insert(directive->start(), yaml);
-    m_nodes.insert(directive->start(), yaml);
-    m_data.append(yaml);
+    m_yaml.insert(directive->startPos(), yaml);
+    addToTable(yaml);
     return;
   }
-  auto tag = qSharedPointerDynamicCast<YamlTagDirective>(directive);
+  auto tag = yamlRefDynamicCast<YamlTagDirective>(directive);
   if (tag) {
-    m_tags.insert(tag->start(), tag);
-    m_nodes.insert(tag->start(), tag);
-    m_data.append(tag);
+    m_tags.insert(tag->startPos(), tag);
+    addToTable(tag);
   }
-  auto reserved = qSharedPointerDynamicCast<YamlReservedDirective>(directive);
+  auto reserved = yamlRefDynamicCast<YamlReservedDirective>(directive);
   if (reserved) {
-    m_reserved.insert(reserved->start(), reserved);
-    m_nodes.insert(reserved->start(), reserved);
-    m_data.append(reserved);
-  }
-}
-
-bool
-QYamlDocument::addSequenceData(QSharedPointer<YamlSequence> sequence,
-                               QSharedPointer<YamlMapItem> item)
-{
-  if (item) // sub sequence in map
-    m_nodes.insert(item->start(), item);
-  else
-    m_nodes.insert(sequence->start(), sequence);
-
-  for (auto data : sequence->data()) {
-    if (data) {
-      switch (data->type()) {
-        case YamlNode::Comment:
-          //        m_nodes.insert(data->start(), data);
-          break;
-        case YamlNode::Scalar:
-          m_data.append(data);
-          m_nodes.insert(data->start(), data);
-          break;
-        case YamlNode::Sequence:
-          addSequenceData(qobject_cast<YamlSequence*>(data));
-          break;
-        case YamlNode::Map:
-          addMapData(qobject_cast<YamlMap*>(data));
-          break;
-        default:
-          return false; // should only happen on error.
-      }
-    }
-  }
-  return false;
-}
-
-bool
-QYamlDocument::addMapData(QSharedPointer<YamlMap> map,
-                          QSharedPointer<YamlMapItem> item)
-{
-  if (item) // sub map in map
-    m_nodes.insert(item->start(), item);
-  else
-    m_nodes.insert(map->start(), map);
-
-  bool result = true;
-  if (map) {
-    for (auto key : map->data().keys()) {
-      auto i = map->value(key);
-      auto data = i->data();
-      switch (data->type()) {
-        case YamlNode::Comment:
-          //          m_nodes.insert(data->start(), data);
-          break;
-        case YamlNode::Scalar:
-          m_data.append(data);
-          m_nodes.insert(data->start(), i);
-          break;
-        case YamlNode::Sequence: {
-          addSequenceData(qobject_cast<YamlSequence*>(data), i);
-          break;
-        }
-        case YamlNode::Map: {
-          addMapData(qobject_cast<YamlMap*>(data), i);
-          break;
-        }
-        case YamlNode::MapItem: {
-          bool r = addMapItemData(qobject_cast<YamlMapItem*>(data));
-          if (!r)
-            result = false;
-          break;
-        }
-        default:
-          return false; // should only happen on error.
-      }
-    }
+    m_reserved.insert(reserved->startPos(), reserved);
+    addToTable(reserved);
   }
-  return true;
 }
 
-bool
-QYamlDocument::addMapItemData(QSharedPointer<YamlMapItem> item)
-{
-  if (item) {
-    auto data = item->data();
-    if (data) {
-      switch (data->type()) {
-        case YamlNode::Comment:
-          //          m_nodes.insert(data->start(), data);
-          return true;
-        case YamlNode::Scalar:
-          m_data.append(data);
-          m_nodes.insert(item->start(), item);
-          return true;
-        case YamlNode::Sequence: {
-          return addSequenceData(qobject_cast<YamlSequence*>(data));
-        }
-        case YamlNode::Map: {
-          return addMapData(qobject_cast<YamlMap*>(data));
-        }
-        default:
-          return false;
-      }
-    }
-  }
-  return false;
+void
+QYamlDocument::addToTable(const SharedNode& node)
+{
+  m_table.add(node);
+  m_tableValid = false;
 }
 
 const YamlErrors&
@@ -364,35 +396,40 @@ QYamlDocument::setWarnings(const YamlWarnings& newWarnings)
   m_warnings = newWarnings;
 }
 
-const QMap<QTextCursor, SharedNode>&
+QMap<int, SharedNode>
 QYamlDocument::nodeMap() const
 {
-  return m_nodes;
+  auto& table = nodeTable();
+  QMap<int, SharedNode> map;
+  // outer rows come first, so the first row at each start is kept.
+  for (auto row : table.rowsByPosition()) {
+    auto start = table.startPos(row);
+    if (!map.contains(start))
+      map.insert(start, table.node(row));
+  }
+  return map;
 }
 
-QMap<QTextCursor, SharedTagDirective>
+QMap<int, SharedTagDirective>
 QYamlDocument::tags() const
 {
   return m_tags;
 }
 
 void
-QYamlDocument::setTags(const QMap<QTextCursor, SharedTagDirective>& tags)
+QYamlDocument::setTags(const QMap<int, SharedTagDirective>& tags)
 {
   m_tags = tags;
-  for (auto [key, tag] : asKeyValueRange(tags)) {
-    m_data.append(tag);
-    m_nodes.insert(key, tag);
+  for (auto& tag : tags) {
+    addToTable(tag);
   }
 }
 
 void
 QYamlDocument::addTag(SharedTagDirective tag)
 {
-  m_tags.insert(tag->start(), tag);
-  m_root.append(tag);
-  m_data.append(tag);
-  m_nodes.insert(tag->start(), tag);
+  m_tags.insert(tag->startPos(), tag);
+  addToTable(tag);
 }
 
 bool
@@ -402,17 +439,17 @@ QYamlDocument::hasTag()
 }
 
 void
-QYamlDocument::removeTag(QTextCursor position)
+QYamlDocument::removeTag(int position)
 {
   m_tags.remove(position);
 }
 
-QMap<QTextCursor, SharedReservedDirective> QYamlDocument::reserved() const
+QMap<int, SharedReservedDirective> QYamlDocument::reserved() const
 {
   return m_reserved;
 }
 
-void QYamlDocument::addReserved(const QMap<QTextCursor, SharedReservedDirective> &reserved)
+void QYamlDocument::addReserved(const QMap<int, SharedReservedDirective> &reserved)
 {
   m_reserved = reserved;
 }
@@ -422,11 +459,31 @@ bool QYamlDocument::hasReserved()
   return !m_reserved.isEmpty();
 }
 
-void QYamlDocument::removeReserved(QTextCursor position)
+void QYamlDocument::removeReserved(int position)
 {
   m_reserved.remove(position);
 }
 
+void
+QYamlDocument::addAnchor(SharedAnchor anchor)
+{
+  // a later anchor of the same name overrides the earlier one.
+  m_anchors.insert(anchor->name(), anchor);
+  addToTable(anchor);
+}
+
+SharedAnchor
+QYamlDocument::anchor(const QString& name) const
+{
+  return m_anchors.value(name, nullptr);
+}
+
+QMap<QString, SharedAnchor>
+QYamlDocument::anchors() const
+{
+  return m_anchors;
+}
+
 SharedYamlDirective
 QYamlDocument::getDirective() const
 {
@@ -443,27 +500,15 @@ void
 QYamlDocument::setDirective(SharedYamlDirective directive)
 {
   this->m_directive = directive;
-  m_root.append(directive);
-  m_data.append(directive);
-  m_nodes.insert(directive->start(), m_directive);
-}
-
-QTextCursor
-QYamlDocument::versionStart() const
-{
-  return m_directive->start();
+  addToTable(directive);
 }
 
 int
 QYamlDocument::versionStartPos() const
 {
-  return versionStart().position();
+  return m_directive->startPos();
 }
 
-// void QYamlDocument::setVersionStart(const QTextCursor &versionStart) {
-//   m_versionStart = versionStart;
-// }
-
 int
 QYamlDocument::versionLength() const
 {
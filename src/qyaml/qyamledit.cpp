@@ -5,7 +5,32 @@
 #include "qyaml/qyamlparser.h"
 #include "utilities/characters.h"
 
-#include <JlCompress.h>
+#include <QTextCursor>
+
+namespace {
+
+//! Returns text, taken from a QTextCursor selection, with the characters
+//! that QTextDocument::toPlainText() replaces replaced in the same way.
+QString
+plainText(QString text)
+{
+  for (auto& c : text) {
+    switch (c.unicode()) {
+      case QChar::ParagraphSeparator:
+      case QChar::LineSeparator:
+        c = Characters::NEWLINE;
+        break;
+      case QChar::Nbsp:
+        c = QChar::Space;
+        break;
+      default:
+        break;
+    }
+  }
+  return text;
+}
+
+} // namespace
 
 //====================================================================
 //=== QYamlEdit
@@ -16,9 +41,16 @@ QYamlEdit::QYamlEdit(QWidget* parent)
   , m_highlighter(new QYamlHighlighter(m_parser, this))
 {
   connect(m_parser,
-          &QYamlParser::parseComplete,
+          &QYamlParser::tokensChanged,
           m_highlighter,
-          &QYamlHighlighter::rehighlight);
+          &QYamlHighlighter::rehighlightRanges);
+
+  // only the visible text is highlighted straight away, the rest when the
+  // editor is idle. updateRequest() covers scrolling and resizing.
+  m_highlighter->setLazy(true);
+  connect(this, &QPlainTextEdit::updateRequest, this, [this]() {
+    updateVisibleBlocks();
+  });
 }
 
 const QString
@@ -33,8 +65,16 @@ QYamlEdit::loadFile(const QString& filename)
   m_filename = filename;
   QFile file(m_filename);
   if (file.open(QIODevice::ReadOnly)) {
-    auto text = file.readAll();
-    setText(text);
+    // decode straight from the mapped file rather than reading a copy of
+    // it first.
+    auto size = file.size();
+    auto data = (size > 0 ? file.map(0, size) : nullptr);
+    if (data) {
+      setText(QString::fromUtf8(reinterpret_cast<const char*>(data), size));
+      file.unmap(data);
+    } else {
+      setText(QString::fromUtf8(file.readAll()));
+    }
   }
 }
 
@@ -43,23 +83,34 @@ QYamlEdit::loadFromZip(const QString& zipFile, const QString& href)
 {
   m_filename = href;
   m_zipFile = zipFile;
-  auto fileName = JlCompress::extractFile(zipFile, href);
-  QFile file(fileName);
-  if (file.open(QIODevice::ReadOnly)) {
-    auto text = file.readAll();
-    setText(text);
+  // The parser decompresses the entry in chunks, parsing them as they
+  // arrive, and nothing is written to disk. The editor then shows the
+  // parsed text rather than parsing it again.
+  if (m_parser->loadFromZip(zipFile, href)) {
+    showText(m_parser->text());
+    m_parser->updateRevision();
   }
 }
 
 void
 QYamlEdit::setText(const QString& text)
+{
+  showText(text);
+  // large files are parsed on a worker thread so that the editor stays
+  // responsive, tokensChanged() rehighlights the text when it is done.
+  m_parser->parseAsync(text);
+}
+
+void
+QYamlEdit::showText(const QString& text)
 {
   disconnect(QLNPlainTextEdit::document(),
              &QTextDocument::contentsChange,
              this,
              &QYamlEdit::textHasChanged);
   QPlainTextEdit::setPlainText(text);
-  m_parser->parse(text);
+  m_revision = QLNPlainTextEdit::document()->revision();
+  m_textLength = QLNPlainTextEdit::document()->characterCount() - 1;
   connect(QLNPlainTextEdit::document(),
           &QTextDocument::contentsChange,
           this,
@@ -175,18 +226,18 @@ QYamlEdit::hoverMove(QHoverEvent* event)
 
     if (!m_hoverWidget) {
       createHoverWidget(pos, text, title);
-      m_hoverNode = node;
+      m_hoverNode = node.data();
       return;
     }
 
-    if (m_hoverNode && node != m_hoverNode) {
+    if (m_hoverNode && node.data() != m_hoverNode) {
       if (m_hoverWidget) {
         m_hoverWidget->destroy();
         m_hoverWidget = nullptr;
         createHoverWidget(pos, text, title);
       } else {
         createHoverWidget(pos, text, title);
-        m_hoverNode = node;
+        m_hoverNode = node.data();
       }
     }
   }
@@ -207,6 +258,48 @@ QYamlEdit::setHoverTime(int hoverTime)
 void
 QYamlEdit::textHasChanged(int position, int charsRemoved, int charsAdded)
 {
+  // The highlighter reports its format changes as a contents change but
+  // they do not change the document revision or need the text parsing.
+  auto revision = QLNPlainTextEdit::document()->revision();
+  if (revision == m_revision)
+    return;
+  m_revision = revision;
+
+  // Only the added text is read, the parser applies the edit to its own
+  // copy of the text. If the lengths do not add up the whole text is
+  // parsed again.
+  auto document = QLNPlainTextEdit::document();
+  m_textLength += charsAdded - charsRemoved;
+  if (m_textLength != document->characterCount() - 1) {
+    m_textLength = document->characterCount() - 1;
+    m_parser->parse(document->toPlainText());
+    return;
+  }
+  QTextCursor cursor(document);
+  cursor.setPosition(position);
+  cursor.setPosition(qMin(position + charsAdded, m_textLength),
+                     QTextCursor::KeepAnchor);
+  m_parser->reparse(position, charsRemoved, plainText(cursor.selectedText()));
+}
+
+void
+QYamlEdit::updateVisibleBlocks()
+{
+  auto block = firstVisibleBlock();
+  if (!block.isValid())
+    return;
+  auto first = block.blockNumber();
+  auto last = first;
+  auto top = blockBoundingGeometry(block).translated(contentOffset()).top();
+  auto height = viewport()->height();
+  while (block.isValid() && top <= height) {
+    if (block.isVisible()) {
+      last = block.blockNumber();
+      top += blockBoundingRect(block).height();
+    }
+    block = block.next();
+  }
+  m_highlighter->setVisibleBlocks(first, last);
 }
 
 void
@@ -2,10 +2,16 @@
 #include "qyaml/qyamldocument.h"
 #include "qyaml/qyamledit.h"
 #include "qyaml/qyamlparser.h"
+#include "qyaml/yamlformatter.h"
 #include "qyaml/yamlnode.h"
-#include "utilities/ContainerUtil.h"
 #include "utilities/x11colors.h"
 
+#include <QElapsedTimer>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+#include <QtConcurrent>
+
 QYamlHighlighter::QYamlHighlighter(QYamlParser* parser, QYamlEdit* parent)
   : QSyntaxHighlighter{ parent->document() }
   , m_parser(parser)
@@ -25,485 +31,361 @@ QYamlHighlighter::QYamlHighlighter(QYamlParser* parser, QYamlEdit* parent)
   , m_docEndColor(QColorConstants::X11::LightBlue1)
   , m_errorColor(QColorConstants::X11::red)
   , m_warningColor(QColorConstants::X11::orange)
+  , m_formatWatcher(new QFutureWatcher<YamlBlockFormats>(this))
+  , m_idleTimer(new QTimer(this))
+{
+  // a zero timer fires whenever the event loop has nothing else to do.
+  m_idleTimer->setInterval(0);
+  connect(m_idleTimer,
+          &QTimer::timeout,
+          this,
+          &QYamlHighlighter::highlightIdleSlice);
+
+  // every full parse has its formats computed on a worker thread.
+  connect(m_parser,
+          &QYamlParser::parseComplete,
+          this,
+          &QYamlHighlighter::startFormatting);
+  connect(m_formatWatcher,
+          &QFutureWatcherBase::finished,
+          this,
+          &QYamlHighlighter::formattingFinished);
+  connect(parent->document(),
+          &QTextDocument::contentsChange,
+          this,
+          &QYamlHighlighter::textChanged);
+
+  buildFormats();
+}
+
+QYamlHighlighter::~QYamlHighlighter()
 {
-  m_textFormat.setBackground(m_backgroundColor);
-  m_textFormat.setForeground(m_textColor);
-  m_mapFormat.setBackground(m_backgroundColor);
-  m_mapFormat.setForeground(m_mapColor);
-  m_mapKeyFormat.setBackground(m_backgroundColor);
-  m_mapKeyFormat.setForeground(m_mapKeyColor);
-  m_mapValueFormat.setBackground(m_backgroundColor);
-  m_mapValueFormat.setForeground(m_mapValueColor);
-  m_seqFormat.setBackground(m_backgroundColor);
-  m_seqFormat.setForeground(m_seqColor);
-  m_seqValueFormat.setBackground(m_backgroundColor);
-  m_seqValueFormat.setForeground(m_seqValueColor);
-  m_commentFormat.setBackground(m_backgroundColor);
-  m_commentFormat.setForeground(m_commentColor);
-  m_scalarFormat.setBackground(m_backgroundColor);
-  m_scalarFormat.setForeground(m_scalarColor);
-  m_tagFormat.setBackground(m_backgroundColor);
-  m_tagFormat.setForeground(m_tagColor);
-  m_reservedFormat.setBackground(m_backgroundColor);
-  m_reservedFormat.setForeground(m_reservedColor);
-  m_directiveFormat.setBackground(m_backgroundColor);
-  m_directiveFormat.setForeground(m_directiveColor);
-  m_docStartFormat.setBackground(m_backgroundColor);
-  m_docStartFormat.setForeground(m_docStartColor);
-  m_docEndFormat.setBackground(m_backgroundColor);
-  m_docEndFormat.setForeground(m_docEndColor);
-  m_warningFormat.setBackground(m_warningColor);
-  m_warningFormat.setForeground(m_backgroundColor);
+  cancelFormatting();
 }
 
 void
 QYamlHighlighter::highlightBlock(const QString& text)
 {
-  //  auto doc = m_parser->currentDoc();
-  for (auto doc : m_parser->documents()) {
-    if (!doc)
-      return;
-
-    auto block = currentBlock();
-    auto blockStart = block.position();
-    auto textLength = text.length();
-    auto docStart = doc->startPos();
-    auto docEnd = doc->endPos();
-
-    // doc is completely outside block
-    if (docEnd < blockStart || docStart >= blockStart + textLength ||
-        textLength == 0)
-      continue;
-
-    auto nodes = doc->nodes();
-    auto size = nodes.size();
-    if (nodes.isEmpty())
+  if (m_lazy && !m_forced) {
+    auto number = currentBlock().blockNumber();
+    if (number < m_firstVisible || number > m_lastVisible) {
+      setPending(true);
+      startIdle();
       return;
-
-    for (auto& node : nodes) {
-      auto nodeStart = node->startPos();
-      auto nodeEnd = node->endPos();
-
-      // node is completely outside block
-      if (nodeEnd < blockStart || nodeStart > blockStart + textLength)
-        continue;
-
-      // adjust start and end within text.
-      nodeStart -= blockStart;
-      nodeEnd -= blockStart;
-      nodeStart = nodeStart < 0 ? 0 : nodeStart;
-      nodeEnd = nodeEnd > textLength ? textLength : nodeEnd;
-
-      switch (node->type()) {
-        case YamlNode::Scalar: {
-          //          if (node->hasErrors() &&
-          //              node->errors().testFlag(YamlError::EmptyFlowValue)) {
-          //            setScalarFormat(node, blockStart, text.length());
-          //            continue;
-          //          }
-          setScalarFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::Map: {
-          setMapFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::MapItem: {
-          auto n = qSharedPointerDynamicCast<YamlMapItem>(node);
-          //          auto type = n->data()->type();
-          if (n) {
-            setMapItemFormat(n, blockStart, textLength);
-          }
-          break;
-        }
-        case YamlNode::Sequence: {
-          setSequenceFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::Comment: {
-          setCommentFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::YamlDirective: {
-          setDirectiveFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::TagDirective: {
-          setTagFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::ReservedDirective: {
-          setReservedFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::Anchor:
-          // TODO
-          break;
-        case YamlNode::Start: {
-          setStartTagFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::End: {
-          setEndTagFormat(node, blockStart, textLength);
-          break;
-        }
-        case YamlNode::Directive:
-        case YamlNode::Undefined:
-          // never happen
-          break;
-      }
     }
   }
+  setPending(false);
+
+  auto textLength = text.length();
+  if (textLength == 0)
+    return;
+
+  // The worker thread's ranges are used if they are for this text,
+  // otherwise, after an edit or while they are being computed, the block
+  // is formatted here.
+  auto number = currentBlock().blockNumber();
+  auto useComputed =
+    (m_blockFormats && m_blockFormats->revision == document()->revision() &&
+     number < m_blockFormats->blocks.size());
+  auto& ranges = (useComputed ? m_blockFormats->blocks.at(number)
+                              : m_formatter->formatBlock(
+                                  m_parser->documents(),
+                                  currentBlock().position(),
+                                  textLength));
+  for (auto& range : ranges) {
+    setFormat(range.start, range.length, range.format);
+  }
 }
 
-QColor
-QYamlHighlighter::reservedColor() const
-{
-  return m_reservedColor;
+void
+QYamlHighlighter::startFormatting()
+{
+  // After an edit only the blocks given by tokensChanged() can differ,
+  // they are formatted at once by highlightBlock() rather than waiting
+  // for the whole text to be formatted again.
+  if (m_parser->isIncremental())
+    return;
+  cancelFormatting();
+
+  // the node tables are built here so that the worker only reads them.
+  auto documents = m_parser->documents();
+  auto revision = (documents.isEmpty() ? document()->revision() : 0);
+  for (auto& doc : documents) {
+    doc->nodeTable();
+    revision = qMax(revision, doc->revision());
+  }
+  m_formatRevision = revision;
+
+  // the worker's blocks have to be the ones highlightBlock() is given, so
+  // they are read from the QTextDocument here rather than by the worker.
+  QList<QPair<int, int>> blocks;
+  blocks.reserve(document()->blockCount());
+  for (auto block = document()->begin(); block.isValid();
+       block = block.next()) {
+    blocks.append({ block.position(), block.length() - 1 });
+  }
+
+  auto formats = m_formats;
+  m_formatWatcher->setFuture(QtConcurrent::run(
+    [documents, formats, blocks, revision](
+      QPromise<YamlBlockFormats>& promise) {
+      YamlFormatter formatter(formats);
+      auto result =
+        formatter.formatText(documents, blocks, revision, &promise);
+      if (!promise.isCanceled())
+        promise.addResult(result);
+    }));
 }
 
 void
-QYamlHighlighter::setReservedColor(const QColor& reservedColor)
+QYamlHighlighter::formattingFinished()
 {
-  m_reservedColor = reservedColor;
+  auto future = m_formatWatcher->future();
+  if (future.isCanceled() || future.resultCount() == 0)
+    return;
+  // a result for text that has since changed is dropped, the parse of the
+  // new text starts another.
+  auto result = future.result();
+  if (result.revision != document()->revision())
+    return;
+  // the blocks formatted while the ranges were computed already have the
+  // same formats, the ranges are kept for the blocks still to come.
+  m_blockFormats = QSharedPointer<YamlBlockFormats>::create(result);
 }
 
 void
-QYamlHighlighter::setScalarFormat(SharedNode node,
-                                  int blockStart,
-                                  int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlScalar*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      if (n->errors().testFlag(IllegalFirstCharacter)) {
-        m_scalarFormat.setUnderlineColor(m_errorColor);
-        m_scalarFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, formatable.length, m_scalarFormat);
-        m_scalarFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_scalarFormat.setUnderlineColor(m_backgroundColor);
-      } else if (n->errors().testFlag(EmptyFlowValue)) {
-        m_scalarFormat.setUnderlineColor(m_errorColor);
-        m_scalarFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, 1, m_scalarFormat);
-        m_scalarFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_scalarFormat.setUnderlineColor(m_backgroundColor);
-      } else if (n->hasDodgyChar()) {
-        auto dodgy = n->dodgyChars();
-        setFormat(formatable.start, formatable.length, m_scalarFormat);
-        for (auto [key, warning] : asKeyValueRange(dodgy)) {
-          auto start = key.position() - blockStart;
-          m_scalarFormat.setUnderlineColor(m_warningColor);
-          m_scalarFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-          setFormat(start, 1, m_scalarFormat);
-          m_scalarFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-          m_scalarFormat.setUnderlineColor(m_backgroundColor);
-        }
-      } else
-        setFormat(formatable.start, formatable.length, m_scalarFormat);
-    }
+QYamlHighlighter::cancelFormatting()
+{
+  // the worker reads the nodes so it has to stop before they can change,
+  // it checks for cancellation between lines.
+  if (m_formatWatcher->isRunning()) {
+    m_formatWatcher->cancel();
+    m_formatWatcher->waitForFinished();
   }
 }
 
 void
-QYamlHighlighter::setKeyFormat(QSharedPointer<YamlMapItem> node,
-                               int blockStart,
-                               int nodeLength)
-{
-  FormatSize formatable;
-  if (node) {
-    if (isFormatable(node->startPos(),
-                     node->keyLength(),
-                     blockStart,
-                     nodeLength,
-                     formatable)) {
-      setFormat(formatable.start, formatable.length, m_mapKeyFormat);
-    }
-  }
+QYamlHighlighter::textChanged()
+{
+  // Format changes are also reported as content changes, only an edit
+  // changes the revision. The parser moves the nodes after an edit.
+  if (document()->revision() != m_formatRevision)
+    cancelFormatting();
 }
 
 void
-QYamlHighlighter::setCommentFormat(SharedNode node,
-                                   int blockStart,
-                                   int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlComment*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      if (n->warnings().testFlag(YamlWarning::InvalidSpaceWarning) ||
-          n->warnings().testFlag(YamlWarning::IllegalCommentPosition) ||
-          n->warnings().testFlag(
-            YamlWarning::InvalidMinorVersionWarning)) { // errors override
-                                                        // warnings
-        m_commentFormat.setUnderlineColor(m_warningColor);
-        m_commentFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, formatable.length, m_commentFormat);
-        m_commentFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_commentFormat.setUnderlineColor(m_backgroundColor);
-      } else {
-        setFormat(formatable.start, formatable.length, m_commentFormat);
-      }
-    }
+QYamlHighlighter::buildFormats()
+{
+  m_formats.resize(YamlFormatter::FormatKindCount *
+                   YamlFormatter::MarkingCount);
+  for (auto kind = 0; kind < YamlFormatter::FormatKindCount; kind++) {
+    auto index = kind * YamlFormatter::MarkingCount;
+    QTextCharFormat format;
+    format.setBackground(m_backgroundColor);
+    format.setForeground(color(kind));
+    m_formats[index + YamlFormatter::NoMarking] = format;
+
+    format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+    format.setUnderlineColor(m_errorColor);
+    m_formats[index + YamlFormatter::ErrorMarking] = format;
+    format.setUnderlineColor(m_warningColor);
+    m_formats[index + YamlFormatter::WarningMarking] = format;
   }
+  m_formatter = QSharedPointer<YamlFormatter>::create(m_formats);
+  // ranges already computed hold the old colours.
+  m_blockFormats.reset();
 }
 
-void
-QYamlHighlighter::setDirectiveFormat(SharedNode node,
-                                     int blockStart,
-                                     int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlYamlDirective*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      if (n->errors().testFlag(YamlError::TooManyYamlDirectivesError)) {
-        m_directiveFormat.setUnderlineColor(m_errorColor);
-        m_directiveFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, formatable.length, m_directiveFormat);
-        m_directiveFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_directiveFormat.setUnderlineColor(m_backgroundColor);
-      } else if (n->warnings().testFlag(YamlWarning::InvalidSpaceWarning) ||
-                 n->warnings().testFlag(
-                   YamlWarning::
-                     InvalidMinorVersionWarning)) { // errors override warnings
-        m_directiveFormat.setUnderlineColor(m_warningColor);
-        m_directiveFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, formatable.length, m_tagFormat);
-        m_directiveFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_directiveFormat.setUnderlineColor(m_backgroundColor);
-      } else {
-        setFormat(formatable.start, formatable.length, m_directiveFormat);
-      }
-    }
+QColor
+QYamlHighlighter::color(int kind) const
+{
+  switch (kind) {
+    case YamlFormatter::MapFormat:
+      return m_mapColor;
+    case YamlFormatter::MapKeyFormat:
+      return m_mapKeyColor;
+    case YamlFormatter::MapValueFormat:
+      return m_mapValueColor;
+    case YamlFormatter::SeqFormat:
+      return m_seqColor;
+    case YamlFormatter::SeqValueFormat:
+      return m_seqValueColor;
+    case YamlFormatter::CommentFormat:
+      return m_commentColor;
+    case YamlFormatter::ScalarFormat:
+      return m_scalarColor;
+    case YamlFormatter::DirectiveFormat:
+      return m_directiveColor;
+    case YamlFormatter::TagFormat:
+      return m_tagColor;
+    case YamlFormatter::ReservedFormat:
+      return m_reservedColor;
+    case YamlFormatter::DocStartFormat:
+      return m_docStartColor;
+    case YamlFormatter::DocEndFormat:
+      return m_docEndColor;
+    default:
+      return m_textColor;
   }
 }
 
 void
-QYamlHighlighter::setTagFormat(SharedNode node, int blockStart, int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlTagDirective*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      if (n->warnings().testFlag(InvalidSpaceWarning) ||
-          n->warnings().testFlag(YamlWarning::IllegalCommentPosition)) {
-        m_tagFormat.setUnderlineColor(m_warningColor);
-        m_tagFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, formatable.length, m_tagFormat);
-        m_tagFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_tagFormat.setUnderlineColor(m_backgroundColor);
-      } else {
-        setFormat(formatable.start, formatable.length, m_tagFormat);
+QYamlHighlighter::rehighlightRanges(const QList<QPair<int, int>>& ranges)
+{
+  auto doc = document();
+  if (!doc)
+    return;
+
+  // the ranges are sorted so a block shared by several is only done once.
+  auto lastBlock = -1;
+  for (auto& [position, length] : ranges) {
+    auto block = doc->findBlock(position);
+    while (block.isValid() && block.position() <= position + length) {
+      if (block.blockNumber() > lastBlock) {
+        rehighlightBlock(block);
+        lastBlock = block.blockNumber();
       }
+      block = block.next();
     }
   }
 }
 
+bool
+QYamlHighlighter::isLazy() const
+{
+  return m_lazy;
+}
+
 void
-QYamlHighlighter::setReservedFormat(SharedNode node,
-                                    int blockStart,
-                                    int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlReservedDirective*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      if (n->warnings().testFlag(ReservedDirectiveWarning) ||
-          n->warnings().testFlag(InvalidSpaceWarning)) {
-        m_reservedFormat.setUnderlineColor(m_warningColor);
-        m_reservedFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-        setFormat(formatable.start, formatable.length, m_reservedFormat);
-        m_reservedFormat.setUnderlineStyle(QTextCharFormat::NoUnderline);
-        m_reservedFormat.setUnderlineColor(m_backgroundColor);
-      } else {
-        setFormat(formatable.start, formatable.length, m_reservedFormat);
-      }
-    }
+QYamlHighlighter::setLazy(bool lazy)
+{
+  if (m_lazy == lazy)
+    return;
+  m_lazy = lazy;
+  if (!m_lazy) {
+    m_idleTimer->stop();
+    rehighlight();
   }
 }
 
 void
-QYamlHighlighter::setStartTagFormat(SharedNode node,
-                                    int blockStart,
-                                    int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlStart*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      setFormat(formatable.start, formatable.length, m_docStartFormat);
-    }
+QYamlHighlighter::setVisibleBlocks(int first, int last)
+{
+  if (first == m_firstVisible && last == m_lastVisible)
+    return;
+  m_firstVisible = first;
+  m_lastVisible = last;
+  if (!m_lazy)
+    return;
+
+  auto doc = document();
+  for (auto block = doc->findBlockByNumber(first);
+       block.isValid() && block.blockNumber() <= last;
+       block = block.next()) {
+    if (isPending(block))
+      rehighlightBlock(block);
   }
+  // the remaining work is ordered from the old position, start again.
+  if (m_idleTimer->isActive())
+    resetIdle();
+}
+
+bool
+QYamlHighlighter::isPending(const QTextBlock& block) const
+{
+  auto data = static_cast<BlockData*>(block.userData());
+  return (data && data->pending);
 }
 
 void
-QYamlHighlighter::setEndTagFormat(SharedNode node,
-                                  int blockStart,
-                                  int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlEnd*>(node);
-  if (n) {
-    if (isFormatable(
-          n->startPos(), n->length(), blockStart, textLength, formatable)) {
-      setFormat(formatable.start, formatable.length, m_docEndFormat);
-    }
+QYamlHighlighter::setPending(bool pending)
+{
+  auto data = static_cast<BlockData*>(currentBlockUserData());
+  if (!data) {
+    if (!pending)
+      return;
+    data = new BlockData;
+    setCurrentBlockUserData(data);
   }
+  data->pending = pending;
 }
 
 void
-QYamlHighlighter::setMapFormat(SharedNode node, int blockStart, int textLength)
-{
-
-  auto n = qobject_cast<YamlMap*>(node);
-  if (n) {
-    switch (n->flowType()) {
-      case YamlNode::Flow: {
-        auto start = n->startPos() - blockStart;
-        auto end = n->endPos() - blockStart;
-        if (start >= 0 && start < textLength) {
-          setFormat(start, 1, m_mapFormat);
-        }
-        if (end >= 0 && end < textLength) {
-          setFormat(end, 1, m_mapFormat);
-        }
-        break;
-      }
-      case YamlNode::Block:
-        // TODO
-        break;
-      default:
-        break;
-    }
+QYamlHighlighter::startIdle()
+{
+  if (m_idleTimer->isActive()) {
+    m_rescan = true;
+    return;
   }
+  resetIdle();
+  m_idleTimer->start();
 }
 
 void
-QYamlHighlighter::setMapItemFormat(QSharedPointer<YamlMapItem> node,
-                                   int blockStart,
-                                   int textLength)
-{
-  if (node) {
-    auto n = node->data();
-    switch (n->type()) {
-      case YamlNode::Scalar: {
-        setKeyFormat(node, blockStart, textLength);
-        setScalarFormat(n, blockStart, textLength);
-        break;
-      }
-      case YamlNode::Map: {
-        setKeyFormat(node, blockStart, textLength);
-        setMapFormat(n, blockStart, textLength);
-        break;
-      }
-      case YamlNode::MapItem: { // should never happen
-        setMapItemFormat(
-          qSharedPointerDynamicCast<YamlMapItem>(n), blockStart, textLength);
-        break;
-      }
-      case YamlNode::Sequence: {
-        setKeyFormat(node, blockStart, textLength);
-        setSequenceFormat(n, blockStart, textLength);
-        break;
-      }
-      case YamlNode::Comment: { // should never happen
-        setCommentFormat(n, blockStart, textLength);
-        break;
-      }
-      default:
-        break;
-    }
-  }
+QYamlHighlighter::resetIdle()
+{
+  m_above = m_firstVisible - 1;
+  m_below = m_lastVisible + 1;
+  m_takeBelow = true;
+  m_rescan = false;
 }
 
 void
-QYamlHighlighter::setSequenceFormat(SharedNode node,
-                                    int blockStart,
-                                    int textLength)
-{
-  FormatSize formatable;
-  auto n = qobject_cast<YamlSequence*>(node);
-  if (n) {
-    switch (n->flowType()) {
-      case YamlNode::Flow: {
-        auto start = n->startPos() - blockStart;
-        auto end = n->endPos() - blockStart;
-        if (start >= 0 && start < textLength) {
-          setFormat(start, 1, m_seqFormat);
-        }
-        if (end >= 0 && end < textLength) {
-          setFormat(end, 1, m_seqFormat);
-        }
-        break;
+QYamlHighlighter::highlightIdleSlice()
+{
+  // Block numbers rather than QTextBlocks are kept between slices as the
+  // text can be edited in between.
+  auto doc = document();
+  auto above = doc->findBlockByNumber(m_above);
+  auto below = doc->findBlockByNumber(m_below);
+  QElapsedTimer timer;
+  timer.start();
+
+  while (timer.elapsed() < IDLE_SLICE) {
+    if (!above.isValid() && !below.isValid()) {
+      if (!m_rescan) {
+        m_idleTimer->stop();
+        return;
       }
-      case YamlNode::Block:
-        // TODO
-        break;
-      default:
-        break;
+      resetIdle();
+      above = doc->findBlockByNumber(m_above);
+      below = doc->findBlockByNumber(m_below);
+      continue;
     }
-    for (auto& child : n->data()) {
-      if (child) {
-        switch (child->type()) {
-          case YamlNode::Scalar: {
-            setScalarFormat(n, blockStart, textLength);
-            break;
-          }
-          case YamlNode::Map: {
-            setMapFormat(child, blockStart, textLength);
-            break;
-          }
-          case YamlNode::Sequence: {
-            setSequenceFormat(child, blockStart, textLength);
-            break;
-          }
-          case YamlNode::Comment: {
-            setCommentFormat(node, blockStart, textLength);
-            break;
-          }
-          default:
-            break;
-        }
-      }
+
+    // alternate either side of the visible blocks, nearest first.
+    QTextBlock block;
+    if (below.isValid() && (m_takeBelow || !above.isValid())) {
+      block = below;
+      below = below.next();
+    } else {
+      block = above;
+      above = above.previous();
     }
-  }
-}
+    m_takeBelow = !m_takeBelow;
 
-bool
-QYamlHighlighter::isFormatable(int nodeStart,
-                               int nodeLength,
-                               int blockStart,
-                               int textLength,
-                               FormatSize& result)
-{
-  //  auto offsetstart = start + blockStart;
-  auto end = nodeStart + nodeLength;
-  auto textend = blockStart + textLength;
-
-  if (end < blockStart || nodeStart > textend)
-    return false;
-
-  if (nodeStart < blockStart)
-    result.start = 0;
-  else {
-    result.start = nodeStart - blockStart;
-    result.start = (result.start < 0 ? 0 : result.start);
+    if (isPending(block)) {
+      m_forced = true;
+      rehighlightBlock(block);
+      m_forced = false;
+    }
   }
+  m_above = (above.isValid() ? above.blockNumber() : -1);
+  m_below = (below.isValid() ? below.blockNumber() : doc->blockCount());
+}
 
-  if (end > textend)
-    result.length = textLength;
-  else
-    result.length = nodeLength;
+QColor
+QYamlHighlighter::reservedColor() const
+{
+  return m_reservedColor;
+}
 
-  return true;
+void
+QYamlHighlighter::setReservedColor(const QColor& reservedColor)
+{
+  m_reservedColor = reservedColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -516,6 +398,8 @@ void
 QYamlHighlighter::setMapColor(const QColor& mapColor)
 {
   m_mapColor = mapColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -528,6 +412,8 @@ void
 QYamlHighlighter::setCommentColor(const QColor& commentColor)
 {
   m_commentColor = commentColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -540,6 +426,8 @@ void
 QYamlHighlighter::setSeqValueColor(const QColor& seqValueColor)
 {
   m_seqValueColor = seqValueColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -552,6 +440,8 @@ void
 QYamlHighlighter::setSeqColor(const QColor& seqColor)
 {
   m_seqColor = seqColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -564,6 +454,8 @@ void
 QYamlHighlighter::setMapValueColor(const QColor& mapValueColor)
 {
   m_mapValueColor = mapValueColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -576,6 +468,8 @@ void
 QYamlHighlighter::setMapKeyColor(const QColor& mapKeyColor)
 {
   m_mapKeyColor = mapKeyColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -588,6 +482,8 @@ void
 QYamlHighlighter::setTextColor(const QColor& textColor)
 {
   m_textColor = textColor;
+  buildFormats();
+  rehighlight();
 }
 
 const QColor&
@@ -600,6 +496,8 @@ void
 QYamlHighlighter::setBackgroundColor(const QColor& backgroundColor)
 {
   m_backgroundColor = backgroundColor;
+  buildFormats();
+  rehighlight();
 }
 
 QColor
@@ -612,6 +510,8 @@ void
 QYamlHighlighter::setDocEndColor(const QColor& docEndColor)
 {
   m_docEndColor = docEndColor;
+  buildFormats();
+  rehighlight();
 }
 
 QColor
@@ -624,6 +524,8 @@ void
 QYamlHighlighter::setDocStartColor(const QColor& docStartColor)
 {
   m_docStartColor = docStartColor;
+  buildFormats();
+  rehighlight();
 }
 
 QColor
@@ -636,6 +538,8 @@ void
 QYamlHighlighter::setDirectiveColor(const QColor& directiveColor)
 {
   m_directiveColor = directiveColor;
+  buildFormats();
+  rehighlight();
 }
 
 QColor
@@ -648,6 +552,8 @@ void
 QYamlHighlighter::setTagColor(const QColor& tagColor)
 {
   m_tagColor = tagColor;
+  buildFormats();
+  rehighlight();
 }
 
 QColor
@@ -660,6 +566,8 @@ void
 QYamlHighlighter::setWarningColor(const QColor& warningColor)
 {
   m_warningColor = warningColor;
+  buildFormats();
+  rehighlight();
 }
 
 QColor
@@ -672,4 +580,6 @@ void
 QYamlHighlighter::setErrorColor(const QColor& errorColor)
 {
   m_errorColor = errorColor;
+  buildFormats();
+  rehighlight();
 }
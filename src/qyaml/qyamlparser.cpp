@@ -1,9 +1,41 @@
 #include "qyaml/qyamlparser.h"
+#include "qyaml/qyamlbuilder.h"
 #include "qyaml/qyamldocument.h"
 #include "qyaml/yamlnode.h"
+#include "qyaml/yamlboundaries.h"
+#include "qyaml/yamlcharclass.h"
+#include "qyaml/yamlscanner.h"
+#include "qyaml/yamltokens.h"
 #include "utilities/ContainerUtil.h"
 
-#include <JlCompress.h>
+#include <quazip.h>
+#include <quazipfile.h>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+// Returns true if a line whose indent ends at c can hold one of the
+// productions of the line parse, a directive, comment, anchor or document
+// marker. A tab can precede the '#' of a comment.
+bool
+startsProduction(QChar c)
+{
+  switch (c.unicode()) {
+    case u'%':
+    case u'#':
+    case u'-':
+    case u'.':
+    case u'&':
+    case u'\t':
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // namespace
 
 //====================================================================
 //=== QYamlParser
@@ -20,6 +52,11 @@ const QString QYamlParser::TAG = QStringLiteral("TAG");
 // QYamlParser::YAML_DIRECTIVE("%YAML\\s+1[.][0-3]\\s*"); const
 // QRegularExpression QYamlParser::TAG_DIRECTIVE("%TAG\\s+[!\\w\\s:.,]*");
 
+QYamlParser::QYamlParser(QObject* parent)
+  : QObject{ parent }
+{
+}
+
 QYamlParser::QYamlParser(QTextDocument* doc, QObject* parent)
   : QObject{ parent }
   , m_document(doc)
@@ -50,7 +87,7 @@ QYamlParser::prettyPrint() const
 }
 
 bool
-QYamlParser::getNextChar(QChar& c, const QString& text, int& i)
+QYamlParser::getNextChar(QChar& c, QStringView text, int& i)
 {
   i++;
   if (i < text.length()) {
@@ -62,7 +99,7 @@ QYamlParser::getNextChar(QChar& c, const QString& text, int& i)
 }
 
 int
-QYamlParser::getInitialSpaces(const QString& text,
+QYamlParser::getInitialSpaces(QStringView text,
                               int initialIndent,
                               int& i,
                               QChar& c)
@@ -82,7 +119,12 @@ QYamlParser::createDocIfNull(int start, SharedDocument& currentDoc)
 {
   if (!currentDoc) {
     currentDoc = SharedDocument(new QYamlDocument());
-    currentDoc->setStart(createCursor(start));
+    m_arena = currentDoc->arena();
+    m_arenaDocument = currentDoc.data();
+    currentDoc->setStart(start);
+    if (m_document)
+      currentDoc->setRevision(m_document->revision());
+    currentDoc->setStringPool(m_stringPool);
   }
 }
 
@@ -111,9 +153,9 @@ QYamlParser::storeNode(SharedDocument currentDoc,
                        int length)
 {
   if (node) {
-    node->setStart(createCursor(start));
+    node->setStart(start);
     start += length;
-    node->setEnd(createCursor(start));
+    node->setEnd(start);
     start++;
     currentDoc->addNode(node);
   }
@@ -122,12 +164,591 @@ QYamlParser::storeNode(SharedDocument currentDoc,
 bool
 QYamlParser::parse(const QString& text, int startPos, int length)
 {
-  m_text = text;
+  cancelAsync();
+  setSource(text);
+  m_documents.clear();
+  resetStringPool();
+
+  auto result = true;
+  if (m_backend == FYamlBackend && QYamlBuilder::isAvailable()) {
+    result = buildDocuments(m_text.toUtf8());
+  } else {
+    startPos = qBound(0, startPos, int(m_text.length()));
+    auto region = QStringView(m_text).mid(startPos, length);
+    if (m_threaded) {
+      result = parseRegions(
+        region, startPos, revision(), thread(), m_stringPool, m_documents);
+    } else {
+      result = parseDocuments(region, startPos, m_documents);
+    }
+  }
+
+  if (resolveAnchors()) {
+    // TODO errors
+  }
+
+  completeParse();
+
+  return result;
+}
+
+bool
+QYamlParser::parse(const QByteArray& utf8)
+{
+  if (!(m_backend == FYamlBackend && QYamlBuilder::isAvailable()))
+    return parse(QString::fromUtf8(utf8));
+
+  // libfyaml reads the UTF-8 directly, the text is only converted to
+  // UTF-16 if text() is called.
+  cancelAsync();
+  setSource(utf8);
+  resetStringPool();
+  auto result = buildDocuments(utf8);
+
+  if (resolveAnchors()) {
+    // TODO errors
+  }
+
+  completeParse();
+
+  return result;
+}
+
+bool
+QYamlParser::parse(QIODevice* device)
+{
+  if (!device)
+    return false;
+  if (!device->isOpen() && !device->open(QIODevice::ReadOnly))
+    return false;
+  return parse(device->readAll());
+}
+
+bool
+QYamlParser::buildDocuments(const QByteArray& utf8)
+{
+  // libfyaml marks are converted straight into node offsets, the text
+  // is not scanned a second time.
+  QYamlBuilder builder;
+  builder.setRevision(revision());
+  builder.setStringPool(m_stringPool);
+  auto result = builder.build(utf8);
+  m_documents = builder.documents();
+  return result;
+}
+
+void
+QYamlParser::feed(QByteArrayView data)
+{
+  if (!m_boundary)
+    m_boundary = QSharedPointer<YamlBoundaryScanner>::create();
+  m_pending.append(data);
+
+  // Only whole lines are checked for document markers, a line split across
+  // chunks is picked up when its line feed arrives. A line feed byte is
+  // never part of a multi byte UTF-8 character.
+  auto lineStart = m_scanned;
+  qsizetype lineEnd;
+  while ((lineEnd = m_pending.indexOf('\n', lineStart)) >= 0) {
+    auto line = QByteArrayView(m_pending).mid(lineStart, lineEnd - lineStart);
+    switch (m_boundary->addLine(line)) {
+      case YamlBoundaryScanner::StartDocument:
+        if (lineStart > 0) {
+          parseStreamRegion(lineStart - 1, lineStart);
+          lineEnd -= lineStart;
+        }
+        break;
+      case YamlBoundaryScanner::EndDocument:
+        parseStreamRegion(lineEnd, lineEnd + 1);
+        lineEnd = -1;
+        break;
+      case YamlBoundaryScanner::NoBoundary:
+        break;
+    }
+    lineStart = lineEnd + 1;
+  }
+  m_scanned = lineStart;
+}
+
+void
+QYamlParser::finish()
+{
+  if (m_boundary && m_scanned < m_pending.size()) {
+    // the last line has no line feed.
+    auto line = QByteArrayView(m_pending).mid(m_scanned);
+    if (m_boundary->addLine(line) == YamlBoundaryScanner::StartDocument &&
+        m_scanned > 0) {
+      parseStreamRegion(m_scanned - 1, m_scanned);
+    }
+  }
+  if (!m_pending.isEmpty())
+    parseStreamRegion(m_pending.size(), m_pending.size());
+
+  m_pending.clear();
+  m_scanned = 0;
+  m_streamOffset = 0;
+  m_boundary.reset();
+  resetStringPool();
+}
+
+qsizetype
+QYamlParser::pendingSize() const
+{
+  return m_pending.size();
+}
+
+void
+QYamlParser::parseStreamRegion(qsizetype regionEnd, qsizetype consumed)
+{
+  auto region = QByteArrayView(m_pending).first(regionEnd);
+  auto text = QString::fromUtf8(region);
+  // each document of a stream has its own pool, the strings of earlier
+  // documents are released with them.
+  resetStringPool();
+
+  QList<SharedDocument> documents;
+  if (m_backend == FYamlBackend && QYamlBuilder::isAvailable()) {
+    QYamlBuilder builder;
+    builder.setRevision(revision());
+    builder.setStringPool(m_stringPool);
+    builder.build(region.toByteArray());
+    documents = builder.documents();
+  } else {
+    parseDocuments(text, 0, documents);
+  }
+
+  // The stream can be longer than an int can count, so node positions
+  // are kept relative to their document and the document holds where it
+  // starts in the stream.
+  for (auto& doc : documents) {
+    auto start = qMax(doc->startPos(), 0);
+    doc->shift(-start);
+    doc->setBase(m_streamOffset + start);
+  }
+
+  // the bytes after the region are line feeds, one character each.
+  m_streamOffset += text.length() + (consumed - regionEnd);
+  m_pending.remove(0, consumed);
+  m_scanned = 0;
+
+  for (auto& doc : documents) {
+    doc->setTextDocument(m_document);
+    emit documentParsed(doc);
+  }
+}
+
+QTextDocument*
+QYamlParser::textDocument() const
+{
+  return m_document;
+}
+
+void
+QYamlParser::setTextDocument(QTextDocument* document)
+{
+  m_document = document;
+}
+
+bool
+QYamlParser::isStructuralLine(QStringView text, int from, int to)
+{
+  from = qBound(0, from, int(text.length()));
+  to = qBound(from, to, int(text.length()));
+  // check the whole of every line that the range touches.
+  auto lineStart = text.left(from).lastIndexOf(Characters::NEWLINE) + 1;
+  auto lineEnd = text.indexOf(Characters::NEWLINE, to);
+  if (lineEnd < 0)
+    lineEnd = text.length();
+  for (auto line :
+       qTokenize(text.mid(lineStart, lineEnd - lineStart), Characters::NEWLINE)) {
+    if (line.startsWith(u"---") || line.startsWith(u"...") ||
+        line.startsWith(u"%"))
+      return true;
+  }
+  return false;
+}
+
+bool
+QYamlParser::reparse(const QString& text,
+                     int position,
+                     int charsRemoved,
+                     int charsAdded)
+{
+  if (position < 0 || charsAdded < 0 ||
+      position + charsAdded > text.length() ||
+      text.length() != this->text().length() - charsRemoved + charsAdded) {
+    m_editPending = true;
+    m_editPosition = -1;
+    return parse(text);
+  }
+  return reparse(
+    position, charsRemoved, QStringView(text).mid(position, charsAdded));
+}
+
+bool
+QYamlParser::reparse(int position, int charsRemoved, QStringView added)
+{
+  // the UTF-8 source of the libfyaml backend is not edited in place.
+  if (!m_utf8.isNull())
+    setSource(text());
+  position = qBound(0, position, int(m_text.length()));
+  charsRemoved = qBound(0, charsRemoved, int(m_text.length()) - position);
+  auto charsAdded = int(added.length());
+
+  // a second edit made before the first is parsed cannot be mapped onto
+  // the previous tokens.
+  if (m_editPending) {
+    m_editPosition = -1;
+  } else {
+    m_editPosition = position;
+    m_editRemoved = charsRemoved;
+    m_editAdded = charsAdded;
+  }
+  m_editPending = true;
+
+  // A change to a document marker or directive can move every document
+  // boundary after it.
+  auto structural =
+    isStructuralLine(m_text, position, position + charsRemoved);
+  m_text.replace(position, charsRemoved, added.data(), charsAdded);
+  structural =
+    structural || isStructuralLine(m_text, position, position + charsAdded);
+
+  // an edit made while an asynchronous parse is running is picked up by
+  // parsing the new text from scratch.
+  if (isParsing()) {
+    parseAsync(m_text);
+    return true;
+  }
+
+  // Only the native parser can restart part way through the text.
+  if ((m_backend == FYamlBackend && QYamlBuilder::isAvailable()) ||
+      m_documents.isEmpty() || structural) {
+    return parse(m_text);
+  }
+
+  auto first = -1, last = -1;
+  auto removedEnd = position + charsRemoved;
+  for (auto i = 0; i < m_documents.size(); i++) {
+    auto doc = m_documents.at(i);
+    if (first < 0 && position <= doc->endPos()) {
+      if (position < doc->startPos())
+        break;
+      first = i;
+    }
+    if (first >= 0 && removedEnd <= doc->endPos()) {
+      last = i;
+      break;
+    }
+  }
+  if (first < 0 || last < 0)
+    return parse(m_text);
+
+  auto delta = charsAdded - charsRemoved;
+  auto result = true;
+  if (first == last) {
+    // Each production reads a single line so no node spans a line feed,
+    // only the lines that the edit touches are parsed again.
+    auto text = QStringView(m_text);
+    auto lineStart =
+      int(text.left(position).lastIndexOf(Characters::NEWLINE)) + 1;
+    auto lineEnd =
+      int(text.indexOf(Characters::NEWLINE, position + charsAdded));
+    if (lineEnd < 0)
+      lineEnd = text.length();
+    auto doc = m_documents.at(first);
+    doc->replaceRange(lineStart, lineEnd - delta, delta);
+    QList<SharedDocument> documents;
+    result = parseDocuments(
+      text.mid(lineStart, lineEnd - lineStart), lineStart, documents, doc);
+    doc->setRevision(revision());
+    m_reparsed.insert(doc.data());
+  } else {
+    auto regionStart = m_documents.at(first)->startPos();
+    auto regionEnd = qMin(m_documents.at(last)->endPos() + delta,
+                          int(m_text.length()));
+    if (last == m_documents.size() - 1)
+      regionEnd = m_text.length(); // trailing text belongs to the last document.
+
+    QList<SharedDocument> documents;
+    result = parseRegions(
+      QStringView(m_text).mid(regionStart, regionEnd - regionStart),
+      regionStart,
+      revision(),
+      thread(),
+      m_stringPool,
+      documents);
+    m_documents.remove(first, last - first + 1);
+    for (auto i = 0; i < documents.size(); i++) {
+      m_documents.insert(first + i, documents.at(i));
+    }
+    last = first + int(documents.size()) - 1;
+  }
+
+  for (auto i = last + 1; i < m_documents.size(); i++) {
+    auto doc = m_documents.at(i);
+    doc->shift(delta);
+    doc->setRevision(revision());
+  }
 
+  if (resolveAnchors()) {
+    // TODO errors
+  }
+
+  completeParse(true);
+
+  return result;
+}
+
+bool
+QYamlParser::parseRegions(QStringView text,
+                          int offset,
+                          int revision,
+                          QThread* owner,
+                          QSharedPointer<YamlStringPool> pool,
+                          QList<SharedDocument>& documents,
+                          QPromise<QList<SharedDocument>>* promise)
+{
+  struct Parsed
+  {
+    bool result = true;
+    QList<SharedDocument> documents;
+  };
+
+  // Each document is parsed by its own parser so that no parser state is
+  // shared between threads. Anchors and tags are held by the document so
+  // stay local to it, only the thread safe string pool is shared.
+  // The text is only scanned once, each region reads its own lines from
+  // the scan rather than scanning itself again.
+  auto structure = YamlScanner::scan(text);
+  auto parseRegion = [text, offset, owner, pool, &structure](
+                       const YamlRegion& region) {
+    Parsed parsed;
+    QYamlParser worker;
+    worker.setStringPool(pool);
+    YamlLines lines(structure,
+                    int(region.start),
+                    int(region.start + region.length));
+    parsed.result =
+      worker.parseDocuments(text.mid(region.start, region.length),
+                            offset + int(region.start),
+                            parsed.documents,
+                            nullptr,
+                            &lines);
+    for (auto& doc : parsed.documents) {
+      doc->moveToThread(owner);
+    }
+    return parsed;
+  };
+
+  auto regions = YamlBoundaryScanner::split(text, structure.newlines);
+  if (regions.isEmpty())
+    regions.append({ 0, text.length() });
+
+  // Regions are handed to the thread pool in batches so that progress can
+  // be reported and a cancel noticed part way through a large stream.
+  const qsizetype batchSize =
+    (promise ? qMax(1, QThread::idealThreadCount()) * 16 : regions.size());
+  if (promise)
+    promise->setProgressRange(0, int(regions.size()));
+
+  auto result = true;
+  for (qsizetype i = 0; i < regions.size(); i += batchSize) {
+    if (promise && promise->isCanceled())
+      return false;
+    auto batch = regions.mid(i, batchSize);
+    QList<Parsed> results;
+    if (batch.size() == 1)
+      results.append(parseRegion(batch.first()));
+    else
+      results = QtConcurrent::blockingMapped<QList<Parsed>>(batch, parseRegion);
+
+    for (auto& parsed : results) {
+      result &= parsed.result;
+      for (auto& doc : parsed.documents) {
+        doc->setRevision(revision);
+        documents.append(doc);
+      }
+    }
+    if (promise)
+      promise->setProgressValue(int(i + batch.size()));
+  }
+  return result;
+}
+
+void
+QYamlParser::completeParse(bool incremental)
+{
+  m_incremental = incremental;
+  for (auto& doc : m_documents) {
+    doc->setTextDocument(m_document);
+  }
+  emit parseComplete();
+
+  // only the documents that were parsed again have their nodes walked.
+  auto previous = (m_tokens ? *m_tokens : YamlTokens());
+  auto tokens = QSharedPointer<YamlTokens>::create(
+    YamlTokens::take(m_documents, previous, m_reparsed));
+  auto ranges = tokens->changedRanges(
+    previous, m_editPosition, m_editRemoved, m_editAdded);
+  m_tokens = tokens;
+  m_reparsed.clear();
+  m_editPending = false;
+  m_editPosition = -1;
+
+  if (!ranges.isEmpty())
+    emit tokensChanged(ranges);
+}
+
+void
+QYamlParser::updateRevision()
+{
+  auto rev = revision();
+  for (auto& doc : m_documents) {
+    doc->setRevision(rev);
+  }
+  completeParse();
+}
+
+bool
+QYamlParser::isIncremental() const
+{
+  return m_incremental;
+}
+
+int
+QYamlParser::revision() const
+{
+  return (m_document ? m_document->revision() : 0);
+}
+
+bool
+QYamlParser::isParsing() const
+{
+  return (m_watcher != nullptr);
+}
+
+void
+QYamlParser::cancelAsync()
+{
+  if (m_watcher) {
+    m_watcher->cancel();
+    m_watcher = nullptr;
+  }
+}
+
+QFuture<QList<SharedDocument>>
+QYamlParser::parseAsync(const QString& text)
+{
+  // later edits are applied to the text before the parse has finished.
+  setSource(text);
+  return startAsync([text](QString& result) {
+    result = text;
+    return true;
+  });
+}
+
+QFuture<QList<SharedDocument>>
+QYamlParser::loadFileAsync(const QString& filename)
+{
+  m_filename = filename;
+  return startAsync([filename](QString& result) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+      return false;
+    // decode straight from the mapped file rather than reading a copy of
+    // it first.
+    auto size = file.size();
+    auto data = (size > 0 ? file.map(0, size) : nullptr);
+    if (data) {
+      result = QString::fromUtf8(reinterpret_cast<const char*>(data), size);
+      file.unmap(data);
+    } else {
+      result = QString::fromUtf8(file.readAll());
+    }
+    return true;
+  });
+}
+
+QFuture<QList<SharedDocument>>
+QYamlParser::startAsync(std::function<bool(QString&)> read)
+{
+  cancelAsync();
+  resetStringPool();
+
+  // everything the worker needs is copied, it never touches the parser.
+  auto text = QSharedPointer<QString>::create();
+  auto owner = thread();
+  auto rev = revision();
+  auto pool = m_stringPool;
+  auto useBuilder = (m_backend == FYamlBackend && QYamlBuilder::isAvailable());
+
+  auto future = QtConcurrent::run(
+    [read, text, owner, rev, pool, useBuilder](
+      QPromise<QList<SharedDocument>>& promise) {
+      if (!read(*text))
+        return;
+      QList<SharedDocument> documents;
+      if (useBuilder) {
+        QYamlBuilder builder;
+        builder.setRevision(rev);
+        builder.setStringPool(pool);
+        builder.build(text->toUtf8());
+        documents = builder.documents();
+        for (auto& doc : documents) {
+          doc->moveToThread(owner);
+        }
+      } else {
+        parseRegions(*text, 0, rev, owner, pool, documents, &promise);
+      }
+      if (!promise.isCanceled())
+        promise.addResult(documents);
+    });
+
+  auto watcher = new QFutureWatcher<QList<SharedDocument>>(this);
+  m_watcher = watcher;
+  connect(watcher,
+          &QFutureWatcherBase::progressValueChanged,
+          this,
+          [this, watcher](int value) {
+            if (watcher == m_watcher)
+              emit parseProgress(value, watcher->progressMaximum());
+          });
+  connect(watcher,
+          &QFutureWatcherBase::finished,
+          this,
+          [this, watcher, text]() {
+            watcher->deleteLater();
+            // superseded by a later parse.
+            if (watcher != m_watcher)
+              return;
+            m_watcher = nullptr;
+            auto future = watcher->future();
+            if (future.isCanceled() || future.resultCount() == 0)
+              return;
+            setSource(*text);
+            m_documents = future.result();
+            if (resolveAnchors()) {
+              // TODO errors
+            }
+            completeParse();
+          });
+  watcher->setFuture(future);
+  return future;
+}
+
+bool
+QYamlParser::parseDocuments(QStringView text,
+                            int offset,
+                            QList<SharedDocument>& documents,
+                            SharedDocument into,
+                            const YamlLines* lines)
+{
   c_printable(Characters::NW_ARROW_BAR);
 
   auto row = 0;
-  auto pos = startPos;
+  auto pos = offset;
+  auto lineStart = offset;
   auto indent = 0;
   auto rowStart = 0;
   SharedNode node = nullptr;
@@ -137,15 +758,63 @@ QYamlParser::parse(const QString& text, int startPos, int length)
   auto isHyphen = false;
   auto isIndentComplete = false;
   auto hasYamlDirective = false;
-  SharedDocument currentDoc = nullptr;
+  // lines reparsed after an edit are added to the document they are in,
+  // their strings are interned in its pool for this parse only.
+  SharedDocument currentDoc = into;
+  auto parserPool = m_stringPool;
+  if (into) {
+    m_arena = into->arena();
+    m_arenaDocument = into.data();
+    if (into->stringPool())
+      m_stringPool = into->stringPool();
+  }
   bool directivesEnd = false;
 
   SharedNode sharednode = nullptr;
   SharedComment sharedcomment = nullptr;
 
-  auto lines = text.split(Characters::NEWLINE);
-  for (auto& line : lines) {
+  // The documents are split by the same YamlBoundaryScanner that splits
+  // the text into regions, so a serial parse finds the same documents as
+  // a parallel one.
+  YamlBoundaryScanner boundaries;
+
+  // Lines are views into the text, no per line copies are made. The
+  // productions do not all advance pos by the same amount so it is reset
+  // to the real line offset each time.
+  auto scanned = (lines ? YamlStructure() : YamlScanner::scan(text));
+  auto textLines =
+    (lines ? *lines : YamlLines(scanned, 0, int(text.length())));
+  // The indent ends found by the scan tell which lines can hold one of the
+  // productions below, most lines are skipped without testing them.
+  qsizetype indentIndex = 0;
+  for (auto i = 0; i <= textLines.size(); i++) {
+    auto lineEnd =
+      (i < textLines.size() ? textLines.at(i) : int(text.length()));
+    auto lineFrom = lineStart - offset;
+    auto line = text.mid(lineFrom, lineEnd - lineFrom);
+    pos = lineStart;
+    lineStart += line.length() + 1;
+    // the empty line after a last line feed does not start a document.
+    if (i == textLines.size() && line.isEmpty() && !currentDoc)
+      break;
+    if (boundaries.addLine(line) == YamlBoundaryScanner::StartDocument &&
+        currentDoc && currentDoc != into) {
+      // the previous document ends at the line feed before this line.
+      currentDoc->setEnd(pos - 1);
+      currentDoc->setImplicitEnd(true);
+      documents.append(currentDoc);
+      currentDoc = nullptr;
+      directivesEnd = false;
+      hasYamlDirective = false;
+    }
     createDocIfNull(pos, currentDoc);
+    while (indentIndex < textLines.indentCount() &&
+           textLines.indentAt(indentIndex) < lineFrom)
+      indentIndex++;
+    if (indentIndex == textLines.indentCount() ||
+        textLines.indentAt(indentIndex) >= lineEnd ||
+        !startsProduction(text.at(textLines.indentAt(indentIndex))))
+      continue; // blank or content only.
     if (l_directive(line, pos, sharednode, sharedcomment)) {
       pos++; // step past NL
       // TODO error no directives after directives end
@@ -177,7 +846,6 @@ QYamlParser::parse(const QString& text, int startPos, int length)
     }
 
     SharedAnchorBase property;
-    auto s = text.mid(pos);
     if (c_ns_anchor_property(line, property)) {
 
     }
@@ -185,7 +853,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
     if (c_directives_end(line, pos, sharednode)) { // ---
       pos++;                                       // step past NL
       if (sharednode) {
-        currentDoc->addNode(sharednode, true);
+        currentDoc->addNode(sharednode);
         sharednode = nullptr;
         directivesEnd = true;
       }
@@ -196,35 +864,43 @@ QYamlParser::parse(const QString& text, int startPos, int length)
           line, pos, sharednode, sharedcomment)) { //... plus optional comment
       pos++;                                       // step past NL
       if (sharednode) {
-        currentDoc->addNode(sharednode, true);
+        currentDoc->addNode(sharednode);
         sharednode = nullptr;
         if (sharedcomment) {
           currentDoc->addNode(sharedcomment);
           sharedcomment = nullptr;
         }
-        currentDoc->setEnd(createCursor(pos));
-        m_documents.append(currentDoc);
+        currentDoc->setEnd(lineStart - 1);
+        documents.append(currentDoc);
         currentDoc = nullptr;
         directivesEnd = false; // directives can start again.
+        hasYamlDirective = false;
       }
       continue;
     }
   }
 
-  if (currentDoc)
-    m_documents.append(currentDoc);
-
-  if (resolveAnchors()) {
-    // TODO errors
+  if (currentDoc && currentDoc != into) {
+    currentDoc->setEnd(offset + text.length());
+    currentDoc->setImplicitEnd(true);
+    documents.append(currentDoc);
   }
-
-  emit parseComplete();
+  // build the node tables on this thread rather than on first use.
+  for (auto& doc : documents) {
+    doc->nodeTable();
+  }
+  if (into)
+    into->nodeTable();
+  // the documents hold their arenas, the parser does not need to.
+  m_arena.reset();
+  m_arenaDocument = nullptr;
+  m_stringPool = parserPool;
 
   return true;
 }
 
 // void
-// QYamlParser::buildDocuments(const QString& text,
+// QYamlParser::buildDocuments(QStringView text,
 //                             QList<SharedNode> nodes,
 //                             QList<SharedNode> rootNodes)
 //{
@@ -246,7 +922,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //          // should't happen here - new document.
 //          node->setError(YamlError::TooManyYamlDirectivesError, true);
 //        }
-//        doc->setDirective(qSharedPointerDynamicCast<YamlYamlDirective>(node));
+//        doc->setDirective(yamlRefDynamicCast<YamlYamlDirective>(node));
 //        // if the document has a %YAML directive then set start to it's start.
 //        doc->setStart(node->start());
 //        continue;
@@ -343,7 +1019,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 // void
 // QYamlParser::parseFlowSequence(SharedSequence sequence,
 //                                int& i,
-//                                const QString& text)
+//                                QStringView text)
 //{
 //   QString t;
 
@@ -360,7 +1036,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //        t.clear();
 //      }
 //    } else if (c == Characters::OPEN_CURLY_BRACKET) { // start map flow
-//      auto subMap = QSharedPointer<YamlMap>(new YamlMap(this));
+//      auto subMap = YamlRef<YamlMap>(new YamlMap(this));
 //      subMap->setStart(createCursor(i));
 //      subMap->setFlowType(YamlNode::Flow);
 //      parseFlowMap(subMap, ++i, text);
@@ -397,9 +1073,9 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //}
 
 // void
-// QYamlParser::parseFlowMap(QSharedPointer<YamlMap> map,
+// QYamlParser::parseFlowMap(YamlRef<YamlMap> map,
 //                           int& i,
-//                           const QString& text)
+//                           QStringView text)
 //{
 //   QString t;
 //   QString key;
@@ -435,7 +1111,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //      // TODO maps & sequences at comma
 //      if (!t.isEmpty() && !key.isEmpty()) {
 //        auto scalar = parseFlowScalar(t, i);
-//        auto item = QSharedPointer<YamlMapItem>(new YamlMapItem(key, scalar));
+//        auto item = YamlRef<YamlMapItem>(new YamlMapItem(key, scalar));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(scalar->end());
 //        map->insert(key, item);
@@ -444,12 +1120,12 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //        keyStart = -1;
 //      }
 //    } else if (c == Characters::OPEN_CURLY_BRACKET) { // start sub map flow
-//      auto subMap = QSharedPointer<YamlMap>(new YamlMap());
+//      auto subMap = YamlRef<YamlMap>(new YamlMap());
 //      subMap->setStart(createCursor(i));
 //      subMap->setFlowType(YamlNode::Flow);
 //      parseFlowMap(subMap, ++i, text);
 //      if (!key.isEmpty()) {
-//        auto item = QSharedPointer<YamlMapItem>(new YamlMapItem(key, subMap));
+//        auto item = YamlRef<YamlMapItem>(new YamlMapItem(key, subMap));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(subMap->end());
 //        map->insert(key, item);
@@ -463,7 +1139,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //      map->setEnd(createCursor(i));
 //      if (!t.isEmpty() && !key.isEmpty()) { // only if missing final comma
 //        auto scalar = parseFlowScalar(t, i);
-//        auto item = QSharedPointer<YamlMapItem>(new YamlMapItem(key, scalar));
+//        auto item = YamlRef<YamlMapItem>(new YamlMapItem(key, scalar));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(createCursor(i));
 //        map->insert(key, item);
@@ -480,7 +1156,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //      parseFlowSequence(subSequence, ++i, text);
 //      if (!key.isEmpty()) {
 //        auto item =
-//          QSharedPointer<YamlMapItem>(new YamlMapItem(key, subSequence));
+//          YamlRef<YamlMapItem>(new YamlMapItem(key, subSequence));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(subSequence->end());
 //        map->insert(key, item);
@@ -499,9 +1175,9 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //        continue;
 //      }
 //      t += c;//void
-// QYamlParser::parseFlowMap(QSharedPointer<YamlMap> map,
+// QYamlParser::parseFlowMap(YamlRef<YamlMap> map,
 //                          int& i,
-//                          const QString& text)
+//                          QStringView text)
 //{
 //  QString t;
 //  QString key;
@@ -537,7 +1213,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //      // TODO maps & sequences at comma
 //      if (!t.isEmpty() && !key.isEmpty()) {
 //        auto scalar = parseFlowScalar(t, i);
-//        auto item = QSharedPointer<YamlMapItem>(new YamlMapItem(key, scalar));
+//        auto item = YamlRef<YamlMapItem>(new YamlMapItem(key, scalar));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(scalar->end());
 //        map->insert(key, item);
@@ -546,12 +1222,12 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //        keyStart = -1;
 //      }
 //    } else if (c == Characters::OPEN_CURLY_BRACKET) { // start sub map flow
-//      auto subMap = QSharedPointer<YamlMap>(new YamlMap());
+//      auto subMap = YamlRef<YamlMap>(new YamlMap());
 //      subMap->setStart(createCursor(i));
 //      subMap->setFlowType(YamlNode::Flow);
 //      parseFlowMap(subMap, ++i, text);
 //      if (!key.isEmpty()) {
-//        auto item = QSharedPointer<YamlMapItem>(new YamlMapItem(key, subMap));
+//        auto item = YamlRef<YamlMapItem>(new YamlMapItem(key, subMap));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(subMap->end());
 //        map->insert(key, item);
@@ -565,7 +1241,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //      map->setEnd(createCursor(i));
 //      if (!t.isEmpty() && !key.isEmpty()) { // only if missing final comma
 //        auto scalar = parseFlowScalar(t, i);
-//        auto item = QSharedPointer<YamlMapItem>(new YamlMapItem(key, scalar));
+//        auto item = YamlRef<YamlMapItem>(new YamlMapItem(key, scalar));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(createCursor(i));
 //        map->insert(key, item);
@@ -582,7 +1258,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //      parseFlowSequence(subSequence, ++i, text);
 //      if (!key.isEmpty()) {
 //        auto item =
-//          QSharedPointer<YamlMapItem>(new YamlMapItem(key, subSequence));
+//          YamlRef<YamlMapItem>(new YamlMapItem(key, subSequence));
 //        item->setStart(createCursor(keyStart));
 //        item->setEnd(subSequence->end());
 //        map->insert(key, item);
@@ -606,10 +1282,10 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //  }
 //}
 
-// QSharedPointer<YamlComment>
-// QYamlParser::parseComment(int& i, const QString& text)
+// YamlRef<YamlComment>
+// QYamlParser::parseComment(int& i, QStringView text)
 //{
-//   auto comment = QSharedPointer<YamlComment>(new YamlComment());
+//   auto comment = YamlRef<YamlComment>(new YamlComment());
 //   comment->setStart(createCursor(i));
 //   // todo set indent
 //   ++i;
@@ -626,8 +1302,8 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //   return nullptr;
 // }
 
-// QSharedPointer<YamlScalar>
-// QYamlParser::parseFlowScalar(const QString& text, int i)
+// YamlRef<YamlScalar>
+// QYamlParser::parseFlowScalar(QStringView text, int i)
 //{
 //   auto indent = 0, nl = 0;
 //   int textlength = text.length();
@@ -646,7 +1322,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //  auto firstChar = trimmed.at(0);  // TODO to at when working.
 //  auto secondChar = trimmed.at(1); // TODO to at when working.
 //  auto start = i - textlength + indent + nl;
-//  auto scalar = QSharedPointer<YamlScalar>(new YamlScalar(trimmed));
+//  auto scalar = YamlRef<YamlScalar>(new YamlScalar(trimmed));
 //  scalar->setStart(createCursor(start));
 //  scalar->setEnd(createCursor(i));
 
@@ -736,10 +1412,10 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //  }
 //}
 
-// QSharedPointer<YamlComment>
-// QYamlParser::parseComment(int& i, const QString& text)
+// YamlRef<YamlComment>
+// QYamlParser::parseComment(int& i, QStringView text)
 //{
-//   auto comment = QSharedPointer<YamlComment>(new YamlComment());
+//   auto comment = YamlRef<YamlComment>(new YamlComment());
 //   comment->setStart(createCursor(i));
 //   // todo set indent
 //   ++i;
@@ -756,8 +1432,8 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //   return nullptr;
 // }
 
-// QSharedPointer<YamlScalar>
-// QYamlParser::parseFlowScalar(const QString& text, int i)
+// YamlRef<YamlScalar>
+// QYamlParser::parseFlowScalar(QStringView text, int i)
 //{
 //   auto indent = 0, nl = 0;
 //   int textlength = text.length();
@@ -776,7 +1452,7 @@ QYamlParser::parse(const QString& text, int startPos, int length)
 //  auto firstChar = trimmed.at(0);  // TODO to at when working.
 //  auto secondChar = trimmed.at(1); // TODO to at when working.
 //  auto start = i - textlength + indent + nl;
-//  auto scalar = QSharedPointer<YamlScalar>(new YamlScalar(trimmed));
+//  auto scalar = YamlRef<YamlScalar>(new YamlScalar(trimmed));
 //  scalar->setStart(createCursor(start));
 //  scalar->setEnd(createCursor(i));
 
@@ -878,12 +1554,24 @@ bool
 QYamlParser::loadFile(const QString& filename)
 {
   m_filename = filename;
-  QFile file(m_filename);
-  if (file.open(QIODevice::ReadOnly)) {
-    QString text = file.readAll();
-    return parse(text);
-  }
-  return false;
+  auto file = QSharedPointer<QFile>::create(m_filename);
+  if (!file->open(QIODevice::ReadOnly))
+    return false;
+
+  // The file is mapped rather than read so that the UTF-8 is parsed in
+  // place, there is no copy of the whole file.
+  auto size = file->size();
+  auto data = (size > 0 ? file->map(0, size) : nullptr);
+  if (!data)
+    return parse(file.data());
+
+  auto result = parse(
+    QByteArray::fromRawData(reinterpret_cast<const char*>(data), size));
+  // the libfyaml backend keeps the UTF-8 as the source text, so the
+  // mapping must last until the next parse.
+  if (!m_utf8.isNull())
+    m_mappedFile = file;
+  return result;
 }
 
 bool
@@ -891,13 +1579,155 @@ QYamlParser::loadFromZip(const QString& zipFile, const QString& href)
 {
   m_filename = href;
   m_zipFile = zipFile;
-  auto fileName = JlCompress::extractFile(zipFile, href);
-  QFile file(fileName);
-  if (file.open(QIODevice::ReadOnly)) {
-    QString text = file.readAll();
-    return parse(text);
+  QuaZipFile file(zipFile, href);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  // The entry is never written to disk. It is decompressed a chunk at a
+  // time, each chunk being fed to the parser and kept as the source text.
+  cancelAsync();
+  m_documents.clear();
+  // Fed documents are relative to their start in the stream. The whole
+  // entry is kept as the source text, so they are moved back to where
+  // they are in it.
+  auto collect = connect(this,
+                         &QYamlParser::documentParsed,
+                         this,
+                         [this](SharedDocument document) {
+                           document->shift(int(document->base()));
+                           document->setBase(0);
+                           m_documents.append(document);
+                         });
+  QByteArray utf8;
+  utf8.reserve(qMax(file.usize(), qint64(0)));
+  while (!file.atEnd()) {
+    auto chunk = file.read(CHUNK_SIZE);
+    if (chunk.isEmpty())
+      break;
+    utf8.append(chunk);
+    feed(chunk);
   }
-  return false;
+  finish();
+  disconnect(collect);
+  auto result = (file.getZipError() == UNZ_OK);
+  file.close();
+  setSource(utf8);
+
+  if (resolveAnchors()) {
+    // TODO errors
+  }
+
+  completeParse();
+
+  return result;
+}
+
+QMap<QString, QList<SharedDocument>>
+QYamlParser::loadArchive(const QString& zipFile,
+                         const QStringList& hrefs,
+                         Backend backend)
+{
+  QMap<QString, QList<SharedDocument>> documents;
+  // the central directory is only read once, when the archive is opened.
+  QuaZip zip(zipFile);
+  if (!zip.open(QuaZip::mdUnzip))
+    return documents;
+
+  auto names = hrefs;
+  if (names.isEmpty()) {
+    for (auto& name : zip.getFileNameList()) {
+      if (name.endsWith(QStringLiteral(".yaml"), Qt::CaseInsensitive) ||
+          name.endsWith(QStringLiteral(".yml"), Qt::CaseInsensitive))
+        names.append(name);
+    }
+  }
+
+  // QuaZip can only decompress one entry at a time, each entry is parsed
+  // on the thread pool while the next one is decompressed.
+  auto owner = QThread::currentThread();
+  // the entries of an archive tend to share their keys.
+  auto pool = QSharedPointer<YamlStringPool>::create();
+  QList<QPair<QString, QFuture<QList<SharedDocument>>>> pending;
+  QuaZipFile file(&zip);
+  for (auto& name : names) {
+    if (!zip.setCurrentFile(name) || !file.open(QIODevice::ReadOnly))
+      continue;
+    auto data = file.readAll();
+    file.close();
+    pending.append({ name, QtConcurrent::run([data, backend, owner, pool]() {
+                       // Only the documents are wanted, so they are built
+                       // directly as parseRegions() does. parse() would
+                       // also keep the source text, take a tokens snapshot
+                       // and emit signals that nothing listens to.
+                       QList<SharedDocument> parsed;
+                       if (backend == FYamlBackend &&
+                           QYamlBuilder::isAvailable()) {
+                         QYamlBuilder builder;
+                         builder.setStringPool(pool);
+                         builder.build(data);
+                         parsed = builder.documents();
+                       } else {
+                         QYamlParser parser;
+                         parser.setStringPool(pool);
+                         parser.parseDocuments(
+                           QString::fromUtf8(data), 0, parsed);
+                       }
+                       for (auto& doc : parsed) {
+                         doc->moveToThread(owner);
+                       }
+                       return parsed;
+                     }) });
+  }
+
+  for (auto& [name, future] : pending) {
+    documents.insert(name, future.result());
+  }
+  return documents;
+}
+
+QSharedPointer<YamlStringPool>
+QYamlParser::stringPool() const
+{
+  return m_stringPool;
+}
+
+void
+QYamlParser::setStringPool(QSharedPointer<YamlStringPool> pool)
+{
+  Q_ASSERT(pool);
+  m_stringPool = pool;
+  m_sharedPool = true;
+}
+
+void
+QYamlParser::resetStringPool()
+{
+  if (!m_sharedPool)
+    m_stringPool = QSharedPointer<YamlStringPool>::create();
+}
+
+QYamlParser::Backend
+QYamlParser::backend() const
+{
+  return m_backend;
+}
+
+void
+QYamlParser::setBackend(Backend backend)
+{
+  m_backend = backend;
+}
+
+bool
+QYamlParser::isThreaded() const
+{
+  return m_threaded;
+}
+
+void
+QYamlParser::setThreaded(bool threaded)
+{
+  m_threaded = threaded;
 }
 
 QList<SharedDocument>
@@ -918,9 +1748,27 @@ QYamlParser::document(int index)
 QString
 QYamlParser::text() const
 {
+  if (m_text.isNull() && !m_utf8.isNull())
+    m_text = QString::fromUtf8(m_utf8);
   return m_text;
 }
 
+void
+QYamlParser::setSource(const QString& text)
+{
+  m_text = text;
+  m_utf8.clear();
+  m_mappedFile.reset();
+}
+
+void
+QYamlParser::setSource(const QByteArray& utf8)
+{
+  m_text.clear();
+  m_utf8 = utf8;
+  m_mappedFile.reset();
+}
+
 void
 QYamlParser::setDocuments(QList<SharedDocument> root)
 {
@@ -942,79 +1790,28 @@ QYamlParser::isMultiDocument()
 SharedNode
 QYamlParser::nodeAt(QTextCursor cursor)
 {
-  for (auto doc : m_documents) {
-    for (auto node : doc->nodes()) {
-      SharedNode n;
-      if ((n = nodeOrRecurse(cursor, node))) {
-        return n;
-      }
-    }
-  }
-  return nullptr;
+  return nodeAt(cursor.position());
 }
 
 SharedNode
-QYamlParser::nodeInSequence(QTextCursor cursor, SharedSequence seq)
-{
-  if (!seq->data().isEmpty()) {
-    for (auto node : seq->data()) {
-      SharedNode n;
-      if ((n = nodeOrRecurse(cursor, node))) {
-        return n;
-      }
-    }
-  }
-
-  return seq;
-}
-
-SharedNode
-QYamlParser::nodeInMap(QTextCursor cursor, QSharedPointer<YamlMap> map)
-{
-  if (!map->data().isEmpty()) {
-    for (auto node : map->data()) {
-      SharedNode n;
-      if ((n = nodeOrRecurse(cursor, node))) {
-        return n;
-      }
-      break;
-    }
-  }
-  return map;
-}
-
-SharedNode
-QYamlParser::nodeOrRecurse(QTextCursor cursor, SharedNode node)
-{
-  if (cursor >= node->start() && cursor < node->end()) {
-    switch (node->type()) {
-      case YamlNode::Undefined:
-        // should never happen.
-        break;
-      case YamlNode::YamlDirective:
-      case YamlNode::TagDirective:
-      case YamlNode::Directive:
-      case YamlNode::ReservedDirective:
-      case YamlNode::Start:
-      case YamlNode::End:
-      case YamlNode::MapItem:
-      case YamlNode::Comment:
-      case YamlNode::Anchor:
-        return node;
-      case YamlNode::Scalar:
-        return node;
-      case YamlNode::Sequence:
-        return nodeInSequence(cursor,
-                              qSharedPointerDynamicCast<YamlSequence>(node));
-      case YamlNode::Map:
-        return nodeInMap(cursor, qSharedPointerDynamicCast<YamlMap>(node));
-    }
-  }
-  return nullptr;
+QYamlParser::nodeAt(int position)
+{
+  // the documents are in position order, only the last one starting at
+  // or before position can hold it.
+  auto it = std::upper_bound(
+    m_documents.constBegin(),
+    m_documents.constEnd(),
+    position,
+    [](int pos, const SharedDocument& doc) { return pos < doc->startPos(); });
+  if (it == m_documents.constBegin())
+    return nullptr;
+  auto& table = (*(it - 1))->nodeTable();
+  auto row = table.rowAt(position);
+  return (row == YamlNodeTable::NoIndex ? nullptr : table.node(row));
 }
 
 QString
-QYamlParser::lookahead(int& index, const QString& text, QChar endof)
+QYamlParser::lookahead(int& index, QStringView text, QChar endof)
 {
   auto c = text.at(index);
   QString result;
@@ -1027,7 +1824,7 @@ QYamlParser::lookahead(int& index, const QString& text, QChar endof)
 }
 
 bool
-QYamlParser::l_directive(const QString& line,
+QYamlParser::l_directive(QStringView line,
                          int& start,
                          SharedNode& d,
                          SharedComment& c)
@@ -1050,7 +1847,7 @@ QYamlParser::l_directive(const QString& line,
 }
 
 void
-QYamlParser::bypassTextAndUpdatePos(QString& s, int& pos, QString result)
+QYamlParser::bypassTextAndUpdatePos(QStringView& s, int& pos, QStringView result)
 {
   auto len = result.length();
   pos += len;
@@ -1058,7 +1855,7 @@ QYamlParser::bypassTextAndUpdatePos(QString& s, int& pos, QString result)
 }
 
 void
-QYamlParser::bypassWhitespaceAndUpdatePos(QString& s, int& pos)
+QYamlParser::bypassWhitespaceAndUpdatePos(QStringView& s, int& pos)
 {
   auto len = initial_whitespace(s);
   pos += len;
@@ -1066,7 +1863,7 @@ QYamlParser::bypassWhitespaceAndUpdatePos(QString& s, int& pos)
 }
 
 bool
-QYamlParser::ns_reserved_directive(const QString& line,
+QYamlParser::ns_reserved_directive(QStringView line,
                                    int& start,
                                    SharedNode& sharednode,
                                    SharedComment& sharedcomment)
@@ -1084,14 +1881,14 @@ QYamlParser::ns_reserved_directive(const QString& line,
   pos += len;
   s = s.mid(len);
 
-  sharednode.reset(new YamlReservedDirective());
-  auto directive = qSharedPointerDynamicCast<YamlReservedDirective>(sharednode);
-  directive->setStart(createCursor(start));
+  sharednode = createNode<YamlReservedDirective>();
+  auto directive = yamlRefDynamicCast<YamlReservedDirective>(sharednode);
+  directive->setStart(start);
   if (invalidSpace)
     directive->setWarning(InvalidSpaceWarning, true);
 
   if (ns_directive_name(s, result)) {
-    directive->setNameStart(createCursor(pos));
+    directive->setNameStart(pos);
     directive->setName(result);
 
     bypassTextAndUpdatePos(s, pos, result);
@@ -1104,10 +1901,10 @@ QYamlParser::ns_reserved_directive(const QString& line,
       if (result == Characters::HASH) {
         break;
       }
-      directive->addParameter(createCursor(pos), result);
+      directive->addParameter(pos, result);
 
       bypassTextAndUpdatePos(s, pos, result);
-      sharednode->setEnd(createCursor(pos));
+      sharednode->setEnd(pos);
       bypassWhitespaceAndUpdatePos(s, pos);
     }
   }
@@ -1117,8 +1914,8 @@ QYamlParser::ns_reserved_directive(const QString& line,
     bypassWhitespaceAndUpdatePos(s, pos);
     s_l_comments(s, p, sharedcomment);
     if (sharedcomment) {
-      sharedcomment->setStart(createCursor(pos));
-      sharedcomment->setEnd(createCursor(pos + p));
+      sharedcomment->setStart(pos);
+      sharedcomment->setEnd(pos + p);
       start = sharedcomment->endPos();
       return true;
     }
@@ -1129,19 +1926,19 @@ QYamlParser::ns_reserved_directive(const QString& line,
 }
 
 bool
-QYamlParser::ns_directive_parameter(const QString& s, QString& param)
+QYamlParser::ns_directive_parameter(QStringView s, QString& param)
 {
   return ns_char_plus(s, param);
 }
 
 bool
-QYamlParser::ns_directive_name(const QString& s, QString& name)
+QYamlParser::ns_directive_name(QStringView s, QString& name)
 {
   return ns_char_plus(s, name);
 }
 
 bool
-QYamlParser::ns_tag_directive(const QString& line,
+QYamlParser::ns_tag_directive(QStringView line,
                               int& start,
                               SharedNode& sharednode,
                               SharedComment& sharedcomment)
@@ -1163,13 +1960,13 @@ QYamlParser::ns_tag_directive(const QString& line,
     return false;
 
   YamlTagDirective::TagHandleType type = YamlTagDirective::NoTagType;
-  sharednode.reset(new YamlTagDirective());
-  auto directive = qSharedPointerDynamicCast<YamlTagDirective>(sharednode);
+  sharednode = createNode<YamlTagDirective>();
+  auto directive = yamlRefDynamicCast<YamlTagDirective>(sharednode);
   if (invalidSpace)
     directive->setWarning(InvalidSpaceWarning, true);
-  directive->setStart(createCursor(start));
+  directive->setStart(start);
   directive->setName(TAG);
-  directive->setNameStart(createCursor(pos));
+  directive->setNameStart(pos);
   bypassTextAndUpdatePos(s, pos, TAG);
 
   bypassWhitespaceAndUpdatePos(s, pos);
@@ -1178,11 +1975,12 @@ QYamlParser::ns_tag_directive(const QString& line,
   c_tag_handle(s, result, type);
 
   if (type == YamlTagDirective::Named) {
-    directive->setHandleStart(createCursor(pos + 1));
+    directive->setHandleStart(pos + 1);
     len = result.length() + 2;
     pos += len;
     s = s.mid(len);
-    directive->setHandle(result); // only Named has a handle
+    auto handle = m_stringPool->intern(result);
+    directive->setHandle(handle.text, handle.id); // only Named has a handle
   } else if (type == YamlTagDirective::Secondary) {
     s = s.mid(2);
     pos += 2;
@@ -1194,11 +1992,11 @@ QYamlParser::ns_tag_directive(const QString& line,
   bypassWhitespaceAndUpdatePos(s, pos);
 
   if (!s.isEmpty()) {
-    directive->setValueStart(createCursor(pos));
+    directive->setValueStart(pos);
     ns_directive_parameter(s, result);
     directive->setValue(result);
     bypassTextAndUpdatePos(s, pos, result);
-    directive->setEnd(createCursor(pos));
+    directive->setEnd(pos);
   } else {
     // TODO error  no value.
   }
@@ -1208,8 +2006,8 @@ QYamlParser::ns_tag_directive(const QString& line,
     auto p = 0;
     s_l_comments(s, p, sharedcomment);
     if (sharedcomment) {
-      sharedcomment->setStart(createCursor(pos));
-      sharedcomment->setEnd(createCursor(pos + p));
+      sharedcomment->setStart(pos);
+      sharedcomment->setEnd(pos + p);
       start = sharedcomment->endPos();
       return true;
     }
@@ -1220,7 +2018,7 @@ QYamlParser::ns_tag_directive(const QString& line,
 }
 
 bool
-QYamlParser::ns_yaml_directive(const QString& line,
+QYamlParser::ns_yaml_directive(QStringView line,
                                int& start,
                                SharedNode& sharednode,
                                SharedComment& sharedcomment)
@@ -1242,18 +2040,18 @@ QYamlParser::ns_yaml_directive(const QString& line,
   if (!s.startsWith(YAML))
     return false;
 
-  sharednode.reset(new YamlYamlDirective());
-  auto directive = qSharedPointerDynamicCast<YamlYamlDirective>(sharednode);
-  directive->setStart(createCursor(start));
+  sharednode = createNode<YamlYamlDirective>();
+  auto directive = yamlRefDynamicCast<YamlYamlDirective>(sharednode);
+  directive->setStart(start);
   directive->setName(YAML);
-  directive->setNameStart(createCursor(pos));
+  directive->setNameStart(pos);
   if (invalidSpace)
     directive->setWarning(InvalidSpaceWarning, true);
   pos += 4;
   s = s.mid(4);
 
   bypassWhitespaceAndUpdatePos(s, pos);
-  directive->setVersionStart(createCursor(pos));
+  directive->setVersionStart(pos);
 
   auto ch = s.at(0);
   pos++;
@@ -1288,16 +2086,16 @@ QYamlParser::ns_yaml_directive(const QString& line,
   } else {
     directive->setError(YamlError::BadYamlDirective, true);
   }
-  directive->setEnd(createCursor(pos));
+  directive->setEnd(pos);
 
   if (!s.isEmpty()) {
     bypassWhitespaceAndUpdatePos(s, pos);
     auto p = 0;
     s_l_comments(s, p, sharedcomment);
     if (sharedcomment) {
-      sharedcomment->setStart(createCursor(pos));
+      sharedcomment->setStart(pos);
       sharedcomment->setIndent(pos);
-      sharedcomment->setEnd(createCursor(pos + p));
+      sharedcomment->setEnd(pos + p);
       start = sharedcomment->endPos();
       return true;
     }
@@ -1308,13 +2106,13 @@ QYamlParser::ns_yaml_directive(const QString& line,
 }
 
 bool
-QYamlParser::c_directives_end(const QString& line, int& start, SharedNode& node)
+QYamlParser::c_directives_end(QStringView line, int& start, SharedNode& node)
 {
-  if (line == "---") {
-    node = SharedStart(new YamlStart);
-    node->setStart(createCursor(start));
+  if (YamlBoundaryScanner::isDirectivesEnd(line)) {
+    node = createNode<YamlStart>();
+    node->setStart(start);
     start += 3;
-    node->setEnd(createCursor(start));
+    node->setEnd(start);
     start++;
     return true;
   }
@@ -1322,13 +2120,13 @@ QYamlParser::c_directives_end(const QString& line, int& start, SharedNode& node)
 }
 
 bool
-QYamlParser::c_document_end(const QString& line, int& start, SharedNode& node)
+QYamlParser::c_document_end(QStringView line, int& start, SharedNode& node)
 {
-  if (line.startsWith("...")) {
-    node = SharedEnd(new YamlEnd);
-    node->setStart(createCursor(start));
+  if (YamlBoundaryScanner::isDocumentEnd(line)) {
+    node = createNode<YamlEnd>();
+    node->setStart(start);
     start += 3;
-    node->setEnd(createCursor(start));
+    node->setEnd(start);
     start++;
     return true;
   }
@@ -1336,7 +2134,7 @@ QYamlParser::c_document_end(const QString& line, int& start, SharedNode& node)
 }
 
 bool
-QYamlParser::l_document_suffix(const QString& line,
+QYamlParser::l_document_suffix(QStringView line,
                                int& start,
                                SharedNode& n,
                                SharedComment& c)
@@ -1367,19 +2165,13 @@ QYamlParser::count()
 bool
 QYamlParser::c_indicator(QChar c)
 {
-  return (c_sequence_entry(c) || c_mapping_key(c) || c_mapping_value(c) ||
-          c_collect_entry(c) || c_sequence_start(c) || c_sequence_end(c) ||
-          c_mapping_start(c) || c_mapping_end(c) | c_comment(c) ||
-          c_anchor(c) || c_alias(c) || c_tag(c) || c_literal(c) ||
-          c_folded(c) || c_single_quote(c) || c_double_quote(c) ||
-          c_directive(c) || c_reserved(c));
+  return YamlCharClass::is(c, YamlCharClass::Indicator);
 }
 
 bool
 QYamlParser::c_flow_indicator(QChar c)
 {
-  return (c_collect_entry(c) || c_sequence_start(c) || c_sequence_end(c) ||
-          c_mapping_start(c) || c_mapping_end(c));
+  return YamlCharClass::is(c, YamlCharClass::FlowIndicator);
 }
 
 bool
@@ -1445,7 +2237,7 @@ QYamlParser::c_comment(QChar c)
 }
 
 bool
-QYamlParser::b_comment(const QString& line)
+QYamlParser::b_comment(QStringView line)
 {
   if (line.isEmpty())
     return false;
@@ -1456,13 +2248,13 @@ QYamlParser::b_comment(const QString& line)
 }
 
 bool
-QYamlParser::s_b_comment(const QString& line,
+QYamlParser::s_b_comment(QStringView line,
                          int& start,
                          SharedComment& sharedcomment)
 {
   QString comment;
   if (s_b_comment(line.mid(start), comment)) {
-    sharedcomment = SharedComment(new YamlComment(comment));
+    sharedcomment = createNode<YamlComment>(comment);
     start = comment.length();
     return true;
   }
@@ -1470,7 +2262,7 @@ QYamlParser::s_b_comment(const QString& line,
 }
 
 bool
-QYamlParser::s_b_comment(const QString& s, QString& comment)
+QYamlParser::s_b_comment(QStringView s, QString& comment)
 {
   if (s.isEmpty())
     return false;
@@ -1483,7 +2275,7 @@ QYamlParser::s_b_comment(const QString& s, QString& comment)
 }
 
 bool
-QYamlParser::l_comment(const QString& s,
+QYamlParser::l_comment(QStringView s,
                        int& start,
                        SharedComment& sharedcomment)
 {
@@ -1494,7 +2286,7 @@ QYamlParser::l_comment(const QString& s,
   text = text.mid(len);
   QString comment;
   if (c_nb_comment_text(text, comment)) {
-    sharedcomment = SharedComment(new YamlComment(comment));
+    sharedcomment = createNode<YamlComment>(comment);
     start = comment.length();
     return true;
   }
@@ -1502,7 +2294,7 @@ QYamlParser::l_comment(const QString& s,
 }
 
 bool
-QYamlParser::s_l_comments(const QString& text,
+QYamlParser::s_l_comments(QStringView text,
                           int& start,
                           SharedComment& sharedcomment)
 {
@@ -1525,35 +2317,29 @@ QYamlParser::s_l_comments(const QString& text,
   if (!sharedcomment) {
     return false;
   }
-  sharedcomment->setStart(createCursor(start + indent));
-  sharedcomment->setEnd(createCursor(start + indent + p));
+  sharedcomment->setStart(start + indent);
+  sharedcomment->setEnd(start + indent + p);
   sharedcomment->setIndent(indent);
   start = start + indent + p;
   return true;
 }
 
 bool
-QYamlParser::c_nb_comment_text(const QString& line, QString& comment)
+QYamlParser::c_nb_comment_text(QStringView line, QString& comment)
 {
   if (line.isEmpty())
     return false;
   auto indent = s_indent(line);
-  auto text = line;
-  auto c = line.at(indent);
-  text = text.mid(indent);
-  if (c_comment(c)) {
-    comment = c;
-    text = text.mid(1);
-    c = text.at(0);
-    while (nb_char(c)) {
-      comment += c;
-      text = text.mid(1);
-      if (text.isEmpty())
-        return true;
-      c = text.at(0);
-    }
-  }
-  return false;
+  if (indent >= line.length() || !c_comment(line.at(indent)))
+    return false;
+  auto end = indent + 1;
+  while (end < line.length() && nb_char(line.at(end)))
+    end++;
+  if (end < line.length())
+    return false;
+  // only a single copy of the comment text is made.
+  comment = line.mid(indent, end - indent).toString();
+  return true;
 }
 
 bool
@@ -1626,18 +2412,18 @@ bool
 QYamlParser::b_char(QChar c, int version)
 {
   if (version == 11)
-    if (b_line_feed(c) || b_carriage_return(c) || c == Characters::NEXTLINE ||
-        c == Characters::LINESEPERATOR || c == Characters::PARASEPERATOR)
-      return true;
+    return (YamlCharClass::is(c, YamlCharClass::Break) ||
+            c == Characters::NEXTLINE || c == Characters::LINESEPERATOR ||
+            c == Characters::PARASEPERATOR);
   if (version == 12)
-    return (b_line_feed(c) || b_carriage_return(c));
+    return YamlCharClass::is(c, YamlCharClass::Break);
   return false;
 }
 
 bool
 QYamlParser::nb_char(QChar c, int version)
 {
-  return (c_printable(c) && !(b_char(c, version) || c_byte_order_mark(c)));
+  return YamlCharClass::isNbChar(c, version);
 }
 
 bool
@@ -1655,13 +2441,13 @@ QYamlParser::s_tab(QChar c)
 bool
 QYamlParser::s_white(QChar c)
 {
-  return (s_space(c) || s_tab(c));
+  return YamlCharClass::is(c, YamlCharClass::White);
 }
 
 bool
 QYamlParser::ns_char(QChar c)
 {
-  return (nb_char(c, MAX_VERSION) && !s_white(c));
+  return YamlCharClass::isNsChar(c);
 }
 
 bool
@@ -1705,29 +2491,11 @@ QYamlParser::b_non_content(QChar& c)
 bool
 QYamlParser::c_printable(QChar c)
 {
-  if (c.isPrint())
-    return true;
-
-  auto lower = c.cell();
-  auto higher = c.row();
-
-  if (c == Characters::HORIZONTALTABSYMBOL)
-    return true;
-  else if (nb_char(c, MAX_VERSION))
-    return true;
-  else if (lower >= 0x20 && lower <= 0x7E)
-    return true;
-  else if (lower == 0x85)
-    return true;
-  else if ((lower >= 0xA0 && lower <= 0xFF) && higher == 0)
-    return true;
-  else if (higher >= 0x00 && higher <= 0xD7)
-    return true;
-  return false;
+  return YamlCharClass::is(c, YamlCharClass::Printable);
 }
 
 bool
-QYamlParser::c_ns_properties(const QString s,
+QYamlParser::c_ns_properties(QStringView s,
                              int& start,
                              QString& result,
                              YamlNode::TagHandleType& type)
@@ -1742,7 +2510,7 @@ QYamlParser::c_ns_properties(const QString s,
 }
 
 bool
-QYamlParser::c_ns_tag_property(const QString& text,
+QYamlParser::c_ns_tag_property(QStringView text,
                                SharedAnchorBase& base,
                                YamlNode::TagHandleType& type)
 {
@@ -1753,7 +2521,7 @@ QYamlParser::c_ns_tag_property(const QString& text,
   QString tag;
 
   if (c_verbatim_tag(text, tag)) {
-    base.reset(new YamlAlias());
+    base = createNode<YamlAlias>();
 
     return true;
   } else if (c_ns_shorthand_tag(text, tag, type)) {
@@ -1767,35 +2535,24 @@ QYamlParser::c_ns_tag_property(const QString& text,
 }
 
 bool
-QYamlParser::c_verbatim_tag(const QString& line, QString& uri)
+QYamlParser::c_verbatim_tag(QStringView line, QString& uri)
 {
-  if (line.isEmpty())
+  if (line.length() < 2 || line.at(0) != Characters::LT ||
+      !c_folded(line.at(1)))
     return false;
-  auto value = line;
-  QString result;
-  auto c = value.at(0);
-  if (c == Characters::LT) { // !
-    value = value.mid(1);
-    c = value.at(0);
-    if (c_folded(c)) { // <
-      value = value.mid(1);
-      c = value.at(0);
-      while (ns_uri_char(c)) {
-        result += c;
-      }
-      value = value.mid(1);
-      c = value.at(0);
-      if (c == Characters::GT) {
-        uri = result;
-        return true;
-      }
-    }
+  // the uri is only copied once its end is found.
+  qsizetype end = 2;
+  while (end < line.length() && ns_uri_char(line.mid(end, 1)))
+    end++;
+  if (end < line.length() && line.at(end) == Characters::GT) {
+    uri = line.mid(2, end - 2).toString();
+    return true;
   }
   return false;
 }
 
 bool
-QYamlParser::c_ns_shorthand_tag(const QString& line,
+QYamlParser::c_ns_shorthand_tag(QStringView line,
                                 QString& tag,
                                 YamlNode::TagHandleType& type)
 {
@@ -1806,7 +2563,7 @@ QYamlParser::c_ns_shorthand_tag(const QString& line,
 }
 
 bool
-QYamlParser::c_tag_handle(const QString& line,
+QYamlParser::c_tag_handle(QStringView line,
                           QString& tag,
                           YamlNode::TagHandleType& type)
 {
@@ -1823,7 +2580,7 @@ QYamlParser::c_tag_handle(const QString& line,
 }
 
 bool
-QYamlParser::c_primary_tag_handle(const QString& line)
+QYamlParser::c_primary_tag_handle(QStringView line)
 {
   if (line.isEmpty())
     return false;
@@ -1837,7 +2594,7 @@ QYamlParser::c_primary_tag_handle(const QString& line)
 }
 
 bool
-QYamlParser::c_secondary_tag_handle(const QString& line)
+QYamlParser::c_secondary_tag_handle(QStringView line)
 {
   if (line.isEmpty())
     return false;
@@ -1855,31 +2612,23 @@ QYamlParser::c_secondary_tag_handle(const QString& line)
 }
 
 bool
-QYamlParser::c_named_tag_handle(const QString& line, QString& tag)
+QYamlParser::c_named_tag_handle(QStringView line, QString& tag)
 {
-  if (line.isEmpty())
+  if (line.isEmpty() || !c_tag(line.at(0)))
     return false;
-  auto value = line;
-  QString result;
-  auto c = value.at(0);
-  if (c_tag(c)) {
-    value = value.mid(1);
-    c = value.at(0);
-    while (ns_word_char(c)) {
-      result += c;
-      value = value.mid(1);
-      c = value.at(0);
-    }
-    if (c_tag(c)) {
-      tag = result;
-      return true;
-    }
+  // the handle is only copied once its closing '!' is found.
+  qsizetype end = 1;
+  while (end < line.length() && ns_word_char(line.at(end)))
+    end++;
+  if (end < line.length() && c_tag(line.at(end))) {
+    tag = line.mid(1, end - 1).toString();
+    return true;
   }
   return false;
 }
 
 bool
-QYamlParser::c_ns_anchor_property(const QString& text,
+QYamlParser::c_ns_anchor_property(QStringView text,
                                  SharedAnchorBase& base)
 {
   if (text.isEmpty())
@@ -1892,9 +2641,10 @@ QYamlParser::c_ns_anchor_property(const QString& text,
   value = value.mid(1);
   QString name;
   if (ns_anchor_name(value, name)) {
-    base.reset(new YamlAnchor());
-    base->setName(name);
-    base->setNameStart(createCursor(pos));
+    base = createNode<YamlAnchor>();
+    auto entry = m_stringPool->intern(name);
+    base->setName(entry.text, entry.id);
+    base->setNameStart(pos);
     return true;
   }
   return false;
@@ -1904,64 +2654,41 @@ bool
 QYamlParser::ns_dec_digit(QChar c)
 {
   // YAML ns-dec-digit
-  return (c.isDigit());
+  return YamlCharClass::is(c, YamlCharClass::DecDigit);
 }
 
 bool
 QYamlParser::ns_hex_digit(QChar c)
 {
   // YAML ns-hex-digit
-  auto lower = c.cell();
-  auto higher = c.row();
-  return (higher == 0 && ((lower >= 0x41 && lower <= 0x46) ||
-                          (lower >= 0x61 && lower <= 0x66)));
+  return YamlCharClass::is(c, YamlCharClass::HexDigit);
 }
 
 bool
 QYamlParser::ns_ascii_char(QChar c)
 {
-  auto lower = c.cell();
-  auto higher = c.row();
-  return (higher == 0 && ((lower >= 0x41 && lower <= 0x5A) ||
-                          (lower >= 0x61 && lower <= 0x7A)));
+  return YamlCharClass::is(c, YamlCharClass::AsciiLetter);
 }
 
 bool
 QYamlParser::ns_word_char(QChar c)
 {
-  return (ns_dec_digit(c) || ns_ascii_char(c) || c == Characters::HYPHEN);
+  return YamlCharClass::is(c, YamlCharClass::WordChar);
 }
 
 bool
-QYamlParser::ns_uri_char(const QString& line)
+QYamlParser::ns_uri_char(QStringView line)
 {
   if (line.isEmpty())
     return false;
   auto value = line;
   auto c = value.at(0);
-  if (ns_word_char(c) || c == Characters::HASH || c == Characters::SEMICOLON ||
-      c == Characters::FORWARDSLASH || c == Characters::QUESTIONMARK ||
-      c == Characters::COLON || c == Characters::COMMERCIAL_AT ||
-      c == Characters::AMPERSAND || c == Characters::EQUALS ||
-      c == Characters::PLUS || c == Characters::DOLLAR ||
-      c == Characters::COMMA || c == Characters::LOWLINE ||
-      c == Characters::STOP || c == Characters::EXCLAMATIONMARK ||
-      c == Characters::TILDE || c == Characters::ASTERISK ||
-      c == Characters::SINGLEQUOTE || c == Characters::OPEN_ROUND_BRACKET ||
-      c == Characters::CLOSE_ROUND_BRACKET ||
-      c == Characters::OPEN_SQUARE_BRACKET ||
-      c == Characters::CLOSE_SQUARE_BRACKET) {
+  if (YamlCharClass::is(c, YamlCharClass::UriChar)) {
     return true;
   } else if (c == Characters::PERCENT) {
-    value = value.mid(1);
-    c = value.at(0);
-    if (ns_hex_digit(c)) {
-      value = value.mid(1);
-      c = value.at(0);
-      if (ns_hex_digit(c)) {
-        return true;
-      }
-    }
+    // %XX escape.
+    return (value.length() >= 3 && ns_hex_digit(value.at(1)) &&
+            ns_hex_digit(value.at(2)));
   }
   return false;
 }
@@ -1969,9 +2696,11 @@ QYamlParser::ns_uri_char(const QString& line)
 bool
 QYamlParser::ns_tag_char(QChar c)
 {
-  // TODO
-  //  return ns_uri_char()
-  return false;
+  // ns-uri-char minus '!' and c-flow-indicator, % escapes are checked by
+  // ns_uri_char(QStringView).
+  return (YamlCharClass::is(c, YamlCharClass::UriChar) &&
+          !YamlCharClass::is(c, YamlCharClass::FlowIndicator) &&
+          c != Characters::EXCLAMATIONMARK);
 }
 
 bool
@@ -2157,7 +2886,7 @@ QYamlParser::ns_esc_paragraph_seperator(QChar& c)
 }
 
 bool
-QYamlParser::ns_esc_8_bit(const QString& line)
+QYamlParser::ns_esc_8_bit(QStringView line)
 {
   if (line.length() == 4 && c_ns_esc_char(line.at(0)) && line.at(1) == 'x' &&
       ns_hex_digit(line.at(2)) && ns_hex_digit(line.at(3)))
@@ -2166,7 +2895,7 @@ QYamlParser::ns_esc_8_bit(const QString& line)
 }
 
 bool
-QYamlParser::ns_esc_16_bit(const QString& line)
+QYamlParser::ns_esc_16_bit(QStringView line)
 {
   if (line.length() == 6 && c_ns_esc_char(line.at(0)) && line.at(1) == 'u' &&
       ns_hex_digit(line.at(2)) && ns_hex_digit(line.at(3)) &&
@@ -2176,14 +2905,14 @@ QYamlParser::ns_esc_16_bit(const QString& line)
 }
 
 bool
-QYamlParser::ns_esc_32_bit(const QString& line)
+QYamlParser::ns_esc_32_bit(QStringView line)
 {
   // TODO 32 bit utf
   return false;
 }
 
 bool
-QYamlParser::c_ns_esc_char(const QString& line)
+QYamlParser::c_ns_esc_char(QStringView line)
 {
   auto good = false;
   auto l = line.length();
@@ -2200,8 +2929,10 @@ QYamlParser::c_ns_esc_char(const QString& line)
             ns_esc_carriage_return(c) || ns_esc_escape(c) || ns_esc_space(c) ||
             ns_esc_double_quote(c) || ns_esc_slash(c) || ns_esc_next_line(c) ||
             ns_esc_nb_space(c) || ns_esc_line_seperator(c) ||
-            ns_esc_paragraph_seperator(c) || ns_esc_8_bit(c) ||
-            ns_esc_16_bit(c) || ns_esc_32_bit(c)) {
+            ns_esc_paragraph_seperator(c) ||
+            ns_esc_8_bit(QStringView(&c, 1)) ||
+            ns_esc_16_bit(QStringView(&c, 1)) ||
+            ns_esc_32_bit(QStringView(&c, 1))) {
         }
       }
     }
@@ -2210,21 +2941,16 @@ QYamlParser::c_ns_esc_char(const QString& line)
 }
 
 int
-QYamlParser::s_indent(const QString& line)
+QYamlParser::s_indent(QStringView line)
 {
-  if (line.isEmpty())
-    return 0;
   auto indent = 0;
-  auto c = line.at(indent);
-  while (s_space(c)) {
+  while (indent < line.length() && s_space(line.at(indent)))
     indent++;
-    c = line.at(indent);
-  }
   return indent;
 }
 
 bool
-QYamlParser::s_indent_less_than(int value, const QString& s)
+QYamlParser::s_indent_less_than(int value, QStringView s)
 {
   int indent = s_indent(s);
   if (indent < value)
@@ -2233,7 +2959,7 @@ QYamlParser::s_indent_less_than(int value, const QString& s)
 }
 
 bool
-QYamlParser::s_indent_less_or_equal(int value, const QString& s)
+QYamlParser::s_indent_less_or_equal(int value, QStringView s)
 {
   int indent = s_indent(s);
   if (indent <= value)
@@ -2248,7 +2974,7 @@ QYamlParser::b_as_space(QChar c)
 }
 
 int
-QYamlParser::initial_whitespace(const QString& s)
+QYamlParser::initial_whitespace(QStringView s)
 {
   //  for (auto c : s) {
   //    if (!s_white(c))
@@ -2266,16 +2992,14 @@ QYamlParser::initial_whitespace(const QString& s)
 bool
 QYamlParser::ns_anchor_char(QChar c)
 {
-  return (ns_char(c) && !c_flow_indicator(c));
+  return (YamlCharClass::isNsChar(c) &&
+          !YamlCharClass::is(c, YamlCharClass::FlowIndicator));
 }
 
 bool
 QYamlParser::nb_json(QChar c)
 {
-  auto lower = c.cell();
-  auto higher = c.row();
-  return (c == Characters::TAB ||
-          (higher == 0 && lower >= 0x20 && lower <= 0xFF) || higher >= 0x1);
+  return YamlCharClass::is(c, YamlCharClass::Json);
 }
 
 QList<SharedDocument>::iterator
@@ -2305,8 +3029,12 @@ QYamlParser::constEnd()
 QTextCursor
 QYamlParser::createCursor(int position)
 {
+  if (!m_document)
+    return QTextCursor();
+  // setPosition() places the cursor directly, rather than walking the text
+  // one character at a time with movePosition().
   auto cursor = QTextCursor(m_document);
-  cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, position);
+  cursor.setPosition(qBound(0, position, m_document->characterCount() - 1));
   return cursor;
 }
 
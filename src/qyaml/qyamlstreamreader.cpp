@@ -0,0 +1,95 @@
+#include "qyaml/qyamlstreamreader.h"
+
+//====================================================================
+//=== QYamlStreamReader
+//====================================================================
+QYamlStreamReader::QYamlStreamReader(QIODevice* device,
+                                     QYamlParser::Backend backend)
+  : m_device(device)
+  , m_parser(new QYamlParser())
+{
+  m_parser->setBackend(backend);
+  QObject::connect(m_parser,
+                   &QYamlParser::documentParsed,
+                   m_parser,
+                   [this](SharedDocument document) {
+                     m_ready.append(document);
+                   });
+  if (!m_device ||
+      (!m_device->isOpen() && !m_device->open(QIODevice::ReadOnly))) {
+    m_finished = true;
+  }
+}
+
+QYamlStreamReader::~QYamlStreamReader()
+{
+  delete m_parser;
+}
+
+SharedDocument
+QYamlStreamReader::next()
+{
+  while (m_ready.isEmpty() && !m_finished) {
+    auto chunk = m_device->read(CHUNK_SIZE);
+    if (!chunk.isEmpty()) {
+      m_parser->feed(chunk);
+      continue;
+    }
+    if (m_device->isSequential() && m_device->waitForReadyRead(-1))
+      continue;
+    m_parser->finish();
+    m_finished = true;
+  }
+  if (m_ready.isEmpty())
+    return nullptr;
+  return m_ready.takeFirst();
+}
+
+bool
+QYamlStreamReader::atEnd() const
+{
+  return (m_finished && m_ready.isEmpty());
+}
+
+qsizetype
+QYamlStreamReader::readyCount() const
+{
+  return m_ready.size();
+}
+
+qsizetype
+QYamlStreamReader::pendingSize() const
+{
+  return m_parser->pendingSize();
+}
+
+QYamlStreamReader::iterator
+QYamlStreamReader::begin()
+{
+  return iterator(this);
+}
+
+QYamlStreamReader::iterator
+QYamlStreamReader::end()
+{
+  return iterator();
+}
+
+//====================================================================
+//=== QYamlStreamReader::iterator
+//====================================================================
+QYamlStreamReader::iterator::iterator(QYamlStreamReader* reader)
+  : m_reader(reader)
+{
+  ++(*this);
+}
+
+QYamlStreamReader::iterator&
+QYamlStreamReader::iterator::operator++()
+{
+  // the previous document is released here unless the caller holds it.
+  m_document = (m_reader ? m_reader->next() : nullptr);
+  if (!m_document)
+    m_reader = nullptr;
+  return *this;
+}
@@ -0,0 +1,127 @@
+#include "qyaml/yamlarena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace {
+std::atomic<bool> arenaEnabled{ true };
+// the arena running the destructors of its objects on this thread.
+thread_local const YamlArena* destroyingArena = nullptr;
+}
+
+//====================================================================
+//=== YamlRefCounted
+//====================================================================
+bool
+YamlRefCounted::isBeingDestroyed(const void* object)
+{
+  return (destroyingArena && destroyingArena->owns(object));
+}
+
+//====================================================================
+//=== YamlArena
+//====================================================================
+YamlArena::YamlArena(qsizetype blockSize)
+  : m_blockSize(blockSize)
+{
+}
+
+YamlArena::~YamlArena()
+{
+  // The objects hold handles to each other, in no order that the
+  // destructors could follow, so a handle can be released after the
+  // object it points to has been destroyed. While the destructors run the
+  // handles to objects of this arena leave them alone.
+  auto outer = std::exchange(destroyingArena, this);
+  auto record = m_destructors;
+  while (record) {
+    auto next = record->next;
+    record->destroy(record);
+    record = next;
+  }
+  destroyingArena = outer;
+
+  // the memory of the objects is released with the blocks.
+  for (auto& block : m_blocks) {
+    ::operator delete[](block.data,
+                        std::align_val_t(alignof(std::max_align_t)));
+  }
+}
+
+void*
+YamlArena::allocate(qsizetype size, qsizetype alignment)
+{
+  auto padding = qsizetype(-reinterpret_cast<quintptr>(m_current) &
+                           quintptr(alignment - 1));
+  if (!m_current || padding + size > m_remaining) {
+    // oversized requests get a block of their own.
+    auto blockSize = qMax(m_blockSize, size + alignment);
+    m_current = static_cast<char*>(::operator new[](
+      blockSize, std::align_val_t(alignof(std::max_align_t))));
+    // the blocks are kept in address order for owns().
+    auto it = std::upper_bound(m_blocks.begin(),
+                               m_blocks.end(),
+                               quintptr(m_current),
+                               [](quintptr v, const Block& block) {
+                                 return v < quintptr(block.data);
+                               });
+    m_blocks.insert(it, { m_current, blockSize });
+    m_remaining = blockSize;
+    padding = qsizetype(-reinterpret_cast<quintptr>(m_current) &
+                        quintptr(alignment - 1));
+  }
+  auto memory = m_current + padding;
+  m_current += padding + size;
+  m_remaining -= padding + size;
+  m_allocations++;
+  m_bytes += size;
+  return memory;
+}
+
+bool
+YamlArena::isEnabled()
+{
+  return arenaEnabled.load(std::memory_order_relaxed);
+}
+
+void
+YamlArena::setEnabled(bool enabled)
+{
+  arenaEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+qsizetype
+YamlArena::allocationCount() const
+{
+  return m_allocations;
+}
+
+qsizetype
+YamlArena::bytesAllocated() const
+{
+  return m_bytes;
+}
+
+qsizetype
+YamlArena::blockCount() const
+{
+  return m_blocks.size();
+}
+
+bool
+YamlArena::owns(const void* address) const
+{
+  auto value = quintptr(address);
+  auto it = std::upper_bound(m_blocks.cbegin(),
+                             m_blocks.cend(),
+                             value,
+                             [](quintptr v, const Block& block) {
+                               return v < quintptr(block.data);
+                             });
+  if (it == m_blocks.cbegin())
+    return false;
+  --it;
+  return (value - quintptr(it->data) < quintptr(it->size));
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QList>
+#include <QStringView>
+
+//! A region of text holding a single YAML document.
+struct YamlRegion
+{
+  qsizetype start = 0;
+  qsizetype length = 0;
+};
+
+//! Finds YAML document boundaries one line at a time.
+//!
+//! A document ends after a '...' line. A '---' line starts a new document
+//! unless it is the directives end marker of the current document, that
+//! is only directives, comments or blank lines precede it. A directive
+//! after document content also starts a new document.
+//!
+//! Lines can be either QStringView or QByteArrayView so that both text and
+//! UTF-8 input can be split without converting it first.
+class YamlBoundaryScanner
+{
+public:
+  enum Boundary
+  {
+    NoBoundary,    //!< The line is part of the current document.
+    StartDocument, //!< The line is the first line of a new document.
+    EndDocument,   //!< The line is the last line of the current document.
+  };
+
+  //! Adds the next line, without its line feed, and returns whether it is
+  //! a document boundary.
+  template<typename View>
+  Boundary addLine(View line)
+  {
+    if (isDocumentEnd(line)) {
+      reset();
+      return EndDocument;
+    }
+
+    auto boundary = NoBoundary;
+    if (isDirectivesEnd(line)) {
+      if (m_hasContent || m_hasDirectivesEnd) {
+        boundary = StartDocument;
+        m_hasContent = false;
+      }
+      m_hasDirectivesEnd = true;
+      // content can follow the marker on the same line.
+      if (!isBlankOrComment(line.mid(3)))
+        m_hasContent = true;
+    } else if (!line.isEmpty() && charAt(line, 0) == u'%') {
+      if (m_hasContent || m_hasDirectivesEnd) {
+        boundary = StartDocument;
+        reset();
+      }
+    } else if (!isBlankOrComment(line)) {
+      m_hasContent = true;
+    }
+    return boundary;
+  }
+
+  //! Returns true if line is a directives end marker, '---' on its own or
+  //! followed by a space, tab or carriage return.
+  //!
+  //! The native parser uses the same test so that it agrees with the
+  //! boundaries found here.
+  template<typename View>
+  static bool isDirectivesEnd(View line)
+  {
+    return isMarker(line, u'-');
+  }
+
+  //! Returns true if line is a document end marker, '...' on its own or
+  //! followed by a space, tab or carriage return.
+  template<typename View>
+  static bool isDocumentEnd(View line)
+  {
+    return isMarker(line, u'.');
+  }
+
+  //! Clears the state ready for a new document.
+  void reset()
+  {
+    m_hasContent = false;
+    m_hasDirectivesEnd = false;
+  }
+
+  //! Splits text into one region per document.
+  //!
+  //! Regions do not include the line feed that separates them from the
+  //! next document.
+  template<typename View>
+  static QList<YamlRegion> split(View text)
+  {
+    QList<qsizetype> newlines;
+    for (qsizetype i = 0; i < text.size(); i++) {
+      if (charAt(text, i) == u'\n')
+        newlines.append(i);
+    }
+    return split(text, newlines);
+  }
+
+  //! Splits text into one region per document using the already known
+  //! offsets of its line feeds.
+  template<typename View, typename Positions>
+  static QList<YamlRegion> split(View text, const Positions& newlines)
+  {
+    QList<YamlRegion> regions;
+    YamlBoundaryScanner scanner;
+    qsizetype regionStart = 0;
+    qsizetype lineStart = 0;
+    const auto size = text.size();
+    for (qsizetype i = 0; i <= newlines.size(); i++) {
+      qsizetype lineEnd = (i < newlines.size() ? newlines.at(i) : size);
+      auto line = text.mid(lineStart, lineEnd - lineStart);
+
+      switch (scanner.addLine(line)) {
+        case StartDocument:
+          if (lineStart > regionStart)
+            regions.append({ regionStart, lineStart - 1 - regionStart });
+          regionStart = lineStart;
+          break;
+        case EndDocument:
+          regions.append({ regionStart, lineEnd - regionStart });
+          regionStart = lineEnd + 1;
+          break;
+        case NoBoundary:
+          break;
+      }
+      lineStart = lineEnd + 1;
+    }
+    if (regionStart < size)
+      regions.append({ regionStart, size - regionStart });
+    return regions;
+  }
+
+private:
+  bool m_hasContent = false;
+  bool m_hasDirectivesEnd = false;
+
+  static char16_t charAt(QStringView text, qsizetype i)
+  {
+    return text.at(i).unicode();
+  }
+  static char16_t charAt(QByteArrayView text, qsizetype i)
+  {
+    return uchar(text.at(i));
+  }
+
+  template<typename View>
+  static bool isMarker(View line, char16_t c)
+  {
+    if (line.size() < 3 || charAt(line, 0) != c || charAt(line, 1) != c ||
+        charAt(line, 2) != c)
+      return false;
+    if (line.size() == 3)
+      return true;
+    auto next = charAt(line, 3);
+    return (next == u' ' || next == u'\t' || next == u'\r');
+  }
+
+  template<typename View>
+  static bool isBlankOrComment(View line)
+  {
+    for (qsizetype i = 0; i < line.size(); i++) {
+      auto c = charAt(line, i);
+      if (c == u' ' || c == u'\t' || c == u'\r')
+        continue;
+      return (c == u'#');
+    }
+    return true;
+  }
+};
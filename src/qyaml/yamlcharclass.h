@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QChar>
+
+#include <array>
+
+//! Character classes used by the YAML 1.2 grammar productions.
+//!
+//! The ASCII range is classified by a table built at compile time, each
+//! entry holding a set of Flags. Only non-ASCII code units take the slow
+//! path. Code units are classified individually, a surrogate half is
+//! treated as printable as it is part of a printable supplementary
+//! character.
+namespace YamlCharClass {
+
+enum Flag : quint16
+{
+  Indicator = 0x0001,     //!< c-indicator
+  FlowIndicator = 0x0002, //!< c-flow-indicator
+  Printable = 0x0004,     //!< c-printable
+  Break = 0x0008,         //!< b-char
+  White = 0x0010,         //!< s-white
+  DecDigit = 0x0020,      //!< ns-dec-digit
+  HexDigit = 0x0040,      //!< ns-hex-digit
+  AsciiLetter = 0x0080,   //!< ns-ascii-letter
+  WordChar = 0x0100,      //!< ns-word-char
+  UriChar = 0x0200,       //!< ns-uri-char, excluding % escapes
+  Json = 0x0400,          //!< nb-json
+};
+
+constexpr quint16 classify(char16_t c)
+{
+  quint16 flags = 0;
+  switch (c) {
+    case u'-':
+    case u'?':
+    case u':':
+    case u'#':
+    case u'&':
+    case u'*':
+    case u'!':
+    case u'|':
+    case u'>':
+    case u'\'':
+    case u'"':
+    case u'%':
+    case u'@':
+    case u'`':
+      flags |= Indicator;
+      break;
+    case u',':
+    case u'[':
+    case u']':
+    case u'{':
+    case u'}':
+      flags |= Indicator | FlowIndicator;
+      break;
+    default:
+      break;
+  }
+
+  if (c == u'\t' || c == u'\n' || c == u'\r' || (c >= 0x20 && c <= 0x7E))
+    flags |= Printable;
+  if (c == u'\n' || c == u'\r')
+    flags |= Break;
+  if (c == u' ' || c == u'\t')
+    flags |= White;
+  if (c == u'\t' || c >= 0x20)
+    flags |= Json;
+
+  auto digit = (c >= u'0' && c <= u'9');
+  auto letter = ((c >= u'A' && c <= u'Z') || (c >= u'a' && c <= u'z'));
+  if (digit)
+    flags |= DecDigit;
+  if (digit || (c >= u'A' && c <= u'F') || (c >= u'a' && c <= u'f'))
+    flags |= HexDigit;
+  if (letter)
+    flags |= AsciiLetter;
+  if (digit || letter || c == u'-')
+    flags |= WordChar | UriChar;
+
+  switch (c) {
+    case u'#':
+    case u';':
+    case u'/':
+    case u'?':
+    case u':':
+    case u'@':
+    case u'&':
+    case u'=':
+    case u'+':
+    case u'$':
+    case u',':
+    case u'_':
+    case u'.':
+    case u'!':
+    case u'~':
+    case u'*':
+    case u'\'':
+    case u'(':
+    case u')':
+    case u'[':
+    case u']':
+      flags |= UriChar;
+      break;
+    default:
+      break;
+  }
+  return flags;
+}
+
+constexpr std::array<quint16, 128> buildTable()
+{
+  std::array<quint16, 128> table{};
+  for (char16_t c = 0; c < 128; c++) {
+    table[c] = classify(c);
+  }
+  return table;
+}
+
+//! The classes of the ASCII code units, built at compile time.
+inline constexpr std::array<quint16, 128> TABLE = buildTable();
+
+inline quint16 nonAscii(char16_t u)
+{
+  quint16 flags = Json;
+  if (u == 0x85 || (u >= 0xA0 && u <= 0xFFFD))
+    flags |= Printable;
+  return flags;
+}
+
+//! Returns true if c has any of the flags.
+inline bool is(QChar c, quint16 flags)
+{
+  auto u = c.unicode();
+  if (u < 0x80)
+    return (TABLE[u] & flags);
+  return (nonAscii(u) & flags);
+}
+
+//! nb-char, c-printable minus b-char and the byte order mark.
+inline bool isNbChar(QChar c, int version = 12)
+{
+  auto u = c.unicode();
+  if (u < 0x80)
+    return ((TABLE[u] & (Printable | Break)) == Printable);
+  if (u == 0xFEFF)
+    return false;
+  // YAML 1.1 also treats NEL, LS and PS as line breaks.
+  if (version == 11 && (u == 0x85 || u == 0x2028 || u == 0x2029))
+    return false;
+  return (nonAscii(u) & Printable);
+}
+
+//! ns-char, nb-char minus s-white.
+inline bool isNsChar(QChar c)
+{
+  auto u = c.unicode();
+  if (u < 0x80)
+    return ((TABLE[u] & (Printable | Break | White)) == Printable);
+  return isNbChar(c);
+}
+
+} // namespace YamlCharClass
@@ -0,0 +1,425 @@
+#include "qyaml/yamlformatter.h"
+#include "qyaml/yamlnode.h"
+#include "utilities/ContainerUtil.h"
+
+#include <algorithm>
+
+//====================================================================
+//=== YamlFormatter
+//====================================================================
+YamlFormatter::YamlFormatter(const QList<QTextCharFormat>& formats)
+  : m_formats(formats)
+{
+  Q_ASSERT(m_formats.size() == FormatKindCount * MarkingCount);
+}
+
+const QList<QTextLayout::FormatRange>&
+YamlFormatter::formatBlock(const QList<SharedDocument>& documents,
+                           int blockStart,
+                           int textLength)
+{
+  m_ranges.clear();
+  if (textLength == 0)
+    return m_ranges;
+  auto blockEnd = blockStart + textLength;
+
+  // Only the documents and nodes that overlap the block are visited, they
+  // are found through the position index of each document's node table
+  // so a full rehighlight is roughly linear in the size of the text.
+  auto it = std::upper_bound(
+    documents.constBegin(),
+    documents.constEnd(),
+    blockStart,
+    [](int pos, const SharedDocument& doc) { return pos < doc->startPos(); });
+  if (it != documents.constBegin())
+    --it;
+
+  for (; it != documents.constEnd(); ++it) {
+    auto doc = *it;
+    if (!doc)
+      break;
+
+    // doc is completely outside block
+    if (doc->startPos() > blockEnd)
+      break;
+    if (doc->endPos() < blockStart)
+      continue;
+
+    auto& table = doc->nodeTable();
+    for (auto row : table.rowsInRange(blockStart, blockEnd)) {
+      auto node = table.node(row);
+      switch (table.type(row)) {
+        case YamlNode::Scalar: {
+          //          if (node->hasErrors() &&
+          //              node->errors().testFlag(YamlError::EmptyFlowValue)) {
+          //            setScalarFormat(node, blockStart, text.length());
+          //            continue;
+          //          }
+          setScalarFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::Map: {
+          setMapFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::MapItem: {
+          auto n = yamlRefDynamicCast<YamlMapItem>(node);
+          //          auto type = n->data()->type();
+          if (n) {
+            setMapItemFormat(n, blockStart, textLength);
+          }
+          break;
+        }
+        case YamlNode::Sequence: {
+          setSequenceFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::Comment: {
+          setCommentFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::YamlDirective: {
+          setDirectiveFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::TagDirective: {
+          setTagFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::ReservedDirective: {
+          setReservedFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::Anchor:
+          // TODO
+          break;
+        case YamlNode::Start: {
+          setStartTagFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::End: {
+          setEndTagFormat(node, blockStart, textLength);
+          break;
+        }
+        case YamlNode::Directive:
+        case YamlNode::Undefined:
+          // never happen
+          break;
+      }
+    }
+  }
+
+  return m_ranges;
+}
+
+YamlBlockFormats
+YamlFormatter::formatText(const QList<SharedDocument>& documents,
+                          const QList<QPair<int, int>>& blocks,
+                          int revision,
+                          QPromise<YamlBlockFormats>* promise)
+{
+  YamlBlockFormats result;
+  result.revision = revision;
+  result.blocks.reserve(blocks.size());
+  for (auto& [position, length] : blocks) {
+    if (promise && promise->isCanceled())
+      return { revision, {} };
+    result.blocks.append(formatBlock(documents, position, length));
+  }
+  return result;
+}
+
+void
+YamlFormatter::addFormat(int start,
+                         int length,
+                         FormatKind kind,
+                         Marking marking)
+{
+  // the range shares the table format, it is only copied by reference.
+  QTextLayout::FormatRange range;
+  range.start = start;
+  range.length = length;
+  range.format = m_formats.at(kind * MarkingCount + marking);
+  m_ranges.append(range);
+}
+
+void
+YamlFormatter::setScalarFormat(SharedNode node, int blockStart, int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlScalar>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      if (n->errors().testFlag(IllegalFirstCharacter)) {
+        addFormat(
+          formatable.start, formatable.length, ScalarFormat, ErrorMarking);
+      } else if (n->errors().testFlag(EmptyFlowValue)) {
+        addFormat(formatable.start, 1, ScalarFormat, ErrorMarking);
+      } else if (n->hasDodgyChar()) {
+        auto dodgy = n->dodgyChars();
+        addFormat(formatable.start, formatable.length, ScalarFormat);
+        for (auto [key, warning] : asKeyValueRange(dodgy)) {
+          addFormat(key - blockStart, 1, ScalarFormat, WarningMarking);
+        }
+      } else
+        addFormat(formatable.start, formatable.length, ScalarFormat);
+    }
+  }
+}
+
+void
+YamlFormatter::setKeyFormat(YamlRef<YamlMapItem> node,
+                            int blockStart,
+                            int nodeLength)
+{
+  FormatSize formatable;
+  if (node) {
+    if (isFormatable(node->startPos(),
+                     node->keyLength(),
+                     blockStart,
+                     nodeLength,
+                     formatable)) {
+      addFormat(formatable.start, formatable.length, MapKeyFormat);
+    }
+  }
+}
+
+void
+YamlFormatter::setCommentFormat(SharedNode node, int blockStart, int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlComment>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      if (n->warnings().testFlag(YamlWarning::InvalidSpaceWarning) ||
+          n->warnings().testFlag(YamlWarning::IllegalCommentPosition) ||
+          n->warnings().testFlag(
+            YamlWarning::InvalidMinorVersionWarning)) { // errors override
+                                                        // warnings
+        addFormat(
+          formatable.start, formatable.length, CommentFormat, WarningMarking);
+      } else {
+        addFormat(formatable.start, formatable.length, CommentFormat);
+      }
+    }
+  }
+}
+
+void
+YamlFormatter::setDirectiveFormat(SharedNode node,
+                                  int blockStart,
+                                  int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlYamlDirective>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      if (n->errors().testFlag(YamlError::TooManyYamlDirectivesError)) {
+        addFormat(
+          formatable.start, formatable.length, DirectiveFormat, ErrorMarking);
+      } else if (n->warnings().testFlag(YamlWarning::InvalidSpaceWarning) ||
+                 n->warnings().testFlag(
+                   YamlWarning::
+                     InvalidMinorVersionWarning)) { // errors override warnings
+        addFormat(formatable.start,
+                  formatable.length,
+                  DirectiveFormat,
+                  WarningMarking);
+      } else {
+        addFormat(formatable.start, formatable.length, DirectiveFormat);
+      }
+    }
+  }
+}
+
+void
+YamlFormatter::setTagFormat(SharedNode node, int blockStart, int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlTagDirective>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      if (n->warnings().testFlag(InvalidSpaceWarning) ||
+          n->warnings().testFlag(YamlWarning::IllegalCommentPosition)) {
+        addFormat(
+          formatable.start, formatable.length, TagFormat, WarningMarking);
+      } else {
+        addFormat(formatable.start, formatable.length, TagFormat);
+      }
+    }
+  }
+}
+
+void
+YamlFormatter::setReservedFormat(SharedNode node,
+                                 int blockStart,
+                                 int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlReservedDirective>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      if (n->warnings().testFlag(ReservedDirectiveWarning) ||
+          n->warnings().testFlag(InvalidSpaceWarning)) {
+        addFormat(
+          formatable.start, formatable.length, ReservedFormat, WarningMarking);
+      } else {
+        addFormat(formatable.start, formatable.length, ReservedFormat);
+      }
+    }
+  }
+}
+
+void
+YamlFormatter::setStartTagFormat(SharedNode node,
+                                 int blockStart,
+                                 int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlStart>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      addFormat(formatable.start, formatable.length, DocStartFormat);
+    }
+  }
+}
+
+void
+YamlFormatter::setEndTagFormat(SharedNode node, int blockStart, int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlEnd>(node);
+  if (n) {
+    if (isFormatable(
+          n->startPos(), n->length(), blockStart, textLength, formatable)) {
+      addFormat(formatable.start, formatable.length, DocEndFormat);
+    }
+  }
+}
+
+void
+YamlFormatter::setMapFormat(SharedNode node, int blockStart, int textLength)
+{
+
+  auto n = yamlRefDynamicCast<YamlMap>(node);
+  if (n) {
+    switch (n->flowType()) {
+      case YamlNode::Flow: {
+        auto start = n->startPos() - blockStart;
+        auto end = n->endPos() - blockStart;
+        if (start >= 0 && start < textLength) {
+          addFormat(start, 1, MapFormat);
+        }
+        if (end >= 0 && end < textLength) {
+          addFormat(end, 1, MapFormat);
+        }
+        break;
+      }
+      default:
+        // a block collection has no brackets, only its items are
+        // formatted.
+        break;
+    }
+  }
+}
+
+void
+YamlFormatter::setMapItemFormat(YamlRef<YamlMapItem> node,
+                                int blockStart,
+                                int textLength)
+{
+  if (node) {
+    auto n = node->data();
+    switch (n->type()) {
+      case YamlNode::Scalar: {
+        setKeyFormat(node, blockStart, textLength);
+        setScalarFormat(n, blockStart, textLength);
+        break;
+      }
+      case YamlNode::Map: {
+        setKeyFormat(node, blockStart, textLength);
+        setMapFormat(n, blockStart, textLength);
+        break;
+      }
+      case YamlNode::MapItem: { // should never happen
+        setMapItemFormat(
+          yamlRefDynamicCast<YamlMapItem>(n), blockStart, textLength);
+        break;
+      }
+      case YamlNode::Sequence: {
+        setKeyFormat(node, blockStart, textLength);
+        setSequenceFormat(n, blockStart, textLength);
+        break;
+      }
+      case YamlNode::Comment: { // should never happen
+        setCommentFormat(n, blockStart, textLength);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+void
+YamlFormatter::setSequenceFormat(SharedNode node,
+                                 int blockStart,
+                                 int textLength)
+{
+  FormatSize formatable;
+  auto n = yamlRefDynamicCast<YamlSequence>(node);
+  if (n) {
+    switch (n->flowType()) {
+      case YamlNode::Flow: {
+        auto start = n->startPos() - blockStart;
+        auto end = n->endPos() - blockStart;
+        if (start >= 0 && start < textLength) {
+          addFormat(start, 1, SeqFormat);
+        }
+        if (end >= 0 && end < textLength) {
+          addFormat(end, 1, SeqFormat);
+        }
+        break;
+      }
+      default:
+        // a block collection has no brackets, only its items are
+        // formatted.
+        break;
+    }
+  }
+}
+
+bool
+YamlFormatter::isFormatable(int nodeStart,
+                            int nodeLength,
+                            int blockStart,
+                            int textLength,
+                            FormatSize& result)
+{
+  //  auto offsetstart = start + blockStart;
+  auto end = nodeStart + nodeLength;
+  auto textend = blockStart + textLength;
+
+  if (end < blockStart || nodeStart > textend)
+    return false;
+
+  if (nodeStart < blockStart)
+    result.start = 0;
+  else {
+    result.start = nodeStart - blockStart;
+    result.start = (result.start < 0 ? 0 : result.start);
+  }
+
+  if (end > textend)
+    result.length = textLength;
+  else
+    result.length = nodeLength;
+
+  return true;
+}
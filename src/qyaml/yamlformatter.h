@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QPromise>
+#include <QTextLayout>
+
+#include "qyaml/qyamldocument.h"
+
+class YamlMapItem;
+
+//! The format ranges of each block of a text, one list per block.
+struct YamlBlockFormats
+{
+  //! The QTextDocument revision of the parse the ranges were computed
+  //! from.
+  int revision = -1;
+  //! The ranges of each block, relative to the start of the block.
+  QList<QList<QTextLayout::FormatRange>> blocks;
+};
+
+//! Decides the formats of the tokens of a parse result.
+//!
+//! A formatter only reads the documents and is given its formats when it
+//! is constructed, so a worker thread can format the whole text with its
+//! own formatter while QYamlHighlighter formats single blocks with
+//! another. The documents must not be changed while either is in use.
+class YamlFormatter
+{
+public:
+  //! The kinds of token that have their own colour.
+  enum FormatKind
+  {
+    TextFormat,
+    MapFormat,
+    MapKeyFormat,
+    MapValueFormat,
+    SeqFormat,
+    SeqValueFormat,
+    CommentFormat,
+    ScalarFormat,
+    DirectiveFormat,
+    TagFormat,
+    ReservedFormat,
+    DocStartFormat,
+    DocEndFormat,
+    FormatKindCount,
+  };
+
+  //! How a token is marked as well as its colour.
+  enum Marking
+  {
+    NoMarking,
+    ErrorMarking,   //!< Wave underlined in the error colour.
+    WarningMarking, //!< Wave underlined in the warning colour.
+    MarkingCount,
+  };
+
+  //! Constructs a formatter using formats, which holds MarkingCount
+  //! formats for each FormatKind in turn.
+  explicit YamlFormatter(const QList<QTextCharFormat>& formats);
+
+  //! Returns the format ranges of the block of textLength characters at
+  //! blockStart, relative to the start of the block.
+  //!
+  //! The list is reused by the next call.
+  const QList<QTextLayout::FormatRange>& formatBlock(
+    const QList<SharedDocument>& documents,
+    int blockStart,
+    int textLength);
+
+  //! Returns the format ranges of each of blocks, stamped with revision.
+  //!
+  //! The blocks are the (position, length) of each QTextBlock of the text,
+  //! without its separator. They are taken from the QTextDocument rather
+  //! than found by splitting the text, which can disagree on where a
+  //! block ends.
+  //!
+  //! If promise is canceled the formatting stops and the result has no
+  //! blocks.
+  YamlBlockFormats formatText(const QList<SharedDocument>& documents,
+                              const QList<QPair<int, int>>& blocks,
+                              int revision,
+                              QPromise<YamlBlockFormats>* promise = nullptr);
+
+private:
+  struct FormatSize
+  {
+    int start = -1;
+    int length = 0;
+  };
+
+  QList<QTextCharFormat> m_formats;
+  QList<QTextLayout::FormatRange> m_ranges;
+
+  void addFormat(int start,
+                 int length,
+                 FormatKind kind,
+                 Marking marking = NoMarking);
+  static bool isFormatable(int nodeStart,
+                           int nodeLength,
+                           int blockStart,
+                           int textLength,
+                           FormatSize& result);
+  void setScalarFormat(SharedNode node, int blockStart, int textLength);
+  void setKeyFormat(YamlRef<YamlMapItem> node,
+                    int blockStart,
+                    int nodeLength);
+  void setCommentFormat(SharedNode node, int blockStart, int textLength);
+  void setDirectiveFormat(SharedNode node, int blockStart, int textLength);
+  void setTagFormat(SharedNode node, int blockStart, int textLength);
+  void setReservedFormat(SharedNode node, int blockStart, int textLength);
+  void setMapFormat(SharedNode node, int blockStart, int textLength);
+  void setMapItemFormat(YamlRef<YamlMapItem> node,
+                        int blockStart,
+                        int textLength);
+  void setSequenceFormat(SharedNode node, int blockStart, int textLength);
+  void setStartTagFormat(SharedNode node, int blockStart, int textLength);
+  void setEndTagFormat(SharedNode node, int blockStart, int textLength);
+};
@@ -1,12 +1,15 @@
 #include "qyaml/yamlnode.h"
+#include "qyaml/qyamldocument.h"
+#include "utilities/ContainerUtil.h"
 #include "utilities/characters.h"
 
+#include <QTextDocument>
+
 //====================================================================
 //=== YamlNode
 //====================================================================
-YamlNode::YamlNode(QObject* parent)
-  : QObject(parent)
-  , m_type(Undefined)
+YamlNode::YamlNode()
+  : m_type(Undefined)
 {
 }
 
@@ -58,20 +61,42 @@ YamlNode::setColumn(int column)
   this->m_column = column;
 }
 
-const QTextCursor&
+QYamlDocument*
+YamlNode::document() const
+{
+  return m_document;
+}
+
+void
+YamlNode::setDocument(QYamlDocument* document)
+{
+  m_document = document;
+}
+
+QTextCursor
 YamlNode::start() const
 {
-  return m_start;
+  return start(m_document ? m_document->textDocument() : nullptr);
+}
+
+QTextCursor
+YamlNode::start(QTextDocument* document) const
+{
+  if (!document || m_start < 0 || m_start >= document->characterCount())
+    return QTextCursor();
+  QTextCursor cursor(document);
+  cursor.setPosition(m_start);
+  return cursor;
 }
 
 int
 YamlNode::startPos() const
 {
-  return m_start.position();
+  return m_start;
 }
 
 void
-YamlNode::setStart(const QTextCursor& newStart)
+YamlNode::setStart(int newStart)
 {
   m_start = newStart;
 }
@@ -84,6 +109,22 @@ YamlNode::length() const
 
 // void YamlNode::setLength(int newLength) { m_length = newLength; }
 
+void
+YamlNode::shift(int delta)
+{
+  if (m_start >= 0)
+    m_start += delta;
+  if (m_end >= 0)
+    m_end += delta;
+  if (!m_dodgyChars.isEmpty()) {
+    QMap<int, YamlWarning> dodgyChars;
+    for (auto [pos, warning] : asKeyValueRange(m_dodgyChars)) {
+      dodgyChars.insert(pos + delta, warning);
+    }
+    m_dodgyChars = dodgyChars;
+  }
+}
+
 const YamlErrors&
 YamlNode::errors() const
 {
@@ -103,7 +144,7 @@ YamlNode::setErrors(const YamlErrors& newErrors)
 }
 
 bool
-YamlNode::hasErrors()
+YamlNode::hasErrors() const
 {
   return m_errors != YamlError::NoErrors;
 }
@@ -140,14 +181,14 @@ YamlNode::hasDodgyChar()
   return false;
 }
 
-QMap<QTextCursor, YamlWarning>
+QMap<int, YamlWarning>
 YamlNode::dodgyChars() const
 {
   return m_dodgyChars;
 }
 
 void
-YamlNode::addDodgyChar(QTextCursor pos, YamlWarning warning)
+YamlNode::addDodgyChar(int pos, YamlWarning warning)
 {
   if (warning == YamlWarning::TabCharsDiscouraged) {
     m_dodgyChars.insert(pos, warning);
@@ -155,8 +196,8 @@ YamlNode::addDodgyChar(QTextCursor pos, YamlWarning warning)
   }
 }
 
-QMap<QTextCursor, YamlWarning>::size_type
-YamlNode::removeDodgyChar(QTextCursor pos)
+QMap<int, YamlWarning>::size_type
+YamlNode::removeDodgyChar(int pos)
 {
   if (m_dodgyChars.size() == 1)
     m_warnings.setFlag(YamlWarning::TabCharsDiscouraged, false);
@@ -187,20 +228,30 @@ YamlNode::toString(const QString& text, FlowType override)
   return text.mid(startPos(), length());
 }
 
-const QTextCursor&
+QTextCursor
 YamlNode::end() const
 {
-  return m_end;
+  return end(m_document ? m_document->textDocument() : nullptr);
+}
+
+QTextCursor
+YamlNode::end(QTextDocument* document) const
+{
+  if (!document || m_end < 0 || m_end >= document->characterCount())
+    return QTextCursor();
+  QTextCursor cursor(document);
+  cursor.setPosition(m_end);
+  return cursor;
 }
 
 int
 YamlNode::endPos() const
 {
-  return m_end.position();
+  return m_end;
 }
 
 void
-YamlNode::setEnd(const QTextCursor& end)
+YamlNode::setEnd(int end)
 {
   m_end = end;
 }
@@ -208,38 +259,43 @@ YamlNode::setEnd(const QTextCursor& end)
 //====================================================================
 //=== YamlMap
 //====================================================================
-YamlMap::YamlMap(QObject* parent)
-  : YamlNode(parent)
+YamlMap::YamlMap()
 {
   m_type = Map;
 }
 
-YamlMap::YamlMap(QMap<QString, QSharedPointer<YamlMapItem>> data,
-                 QObject* parent)
-  : YamlNode(parent)
-  , m_data(data)
+YamlMap::YamlMap(QMap<QString, YamlRef<YamlMapItem>> data)
 {
   m_type = Map;
+  setData(data);
 }
 
-QMap<QString, QSharedPointer<YamlMapItem>>
+QMap<QString, YamlRef<YamlMapItem>>
 YamlMap::data() const
 {
   return m_data;
 }
 
 void
-YamlMap::setData(QMap<QString, QSharedPointer<YamlMapItem>> data)
+YamlMap::setData(QMap<QString, YamlRef<YamlMapItem>> data)
 {
   m_data = data;
+  m_keyIds.clear();
+  for (auto& item : m_data) {
+    indexKey(item);
+  }
 }
 
 bool
-YamlMap::insert(const QString& key, QSharedPointer<YamlMapItem> data)
+YamlMap::insert(const QString& key, YamlRef<YamlMapItem> data)
 {
   if (data) {
     //    if (!m_data.contains(key)) {
+    auto previous = m_data.value(key);
+    if (previous)
+      m_keyIds.remove(previous->keyId());
     m_data.insert(key, data);
+    indexKey(data);
     return true;
     //    }
   }
@@ -249,15 +305,31 @@ YamlMap::insert(const QString& key, QSharedPointer<YamlMapItem> data)
 int
 YamlMap::remove(const QString& key)
 {
+  auto item = m_data.value(key);
+  if (item)
+    m_keyIds.remove(item->keyId());
   return m_data.remove(key);
 }
 
-QSharedPointer<YamlMapItem>
+YamlRef<YamlMapItem>
 YamlMap::value(const QString& key)
 {
   return m_data.value(key);
 }
 
+YamlRef<YamlMapItem>
+YamlMap::value(int keyId) const
+{
+  return m_keyIds.value(keyId);
+}
+
+void
+YamlMap::indexKey(const YamlRef<YamlMapItem>& item)
+{
+  if (item && item->keyId() != YamlStringPool::NoId)
+    m_keyIds.insert(item->keyId(), item);
+}
+
 bool
 YamlMap::contains(const QString& key)
 {
@@ -275,15 +347,13 @@ YamlMap::toString(const QString& text, FlowType override)
 //====================================================================
 //=== YamlMapItem
 //====================================================================
-YamlMapItem::YamlMapItem(QObject* parent)
-  : YamlNode(parent)
+YamlMapItem::YamlMapItem()
 {
   m_type = MapItem;
 }
 
-YamlMapItem::YamlMapItem(const QString& key, SharedNode data, QObject* parent)
-  : YamlNode(parent)
-  , m_key{ key }
+YamlMapItem::YamlMapItem(const QString& key, SharedNode data)
+  : m_key{ key }
   , m_data{ data }
 {
   m_type = MapItem;
@@ -296,9 +366,16 @@ YamlMapItem::key() const
 }
 
 void
-YamlMapItem::setKey(const QString& key)
+YamlMapItem::setKey(const QString& key, int keyId)
 {
   m_key = key;
+  m_keyId = keyId;
+}
+
+int
+YamlMapItem::keyId() const
+{
+  return m_keyId;
 }
 
 int
@@ -356,15 +433,13 @@ YamlMapItem::toString(const QString& text, FlowType override)
 //====================================================================
 //=== YamlSequence
 //====================================================================
-YamlSequence::YamlSequence(QObject* parent)
-  : YamlNode(parent)
+YamlSequence::YamlSequence()
 {
   m_type = Sequence;
 }
 
-YamlSequence::YamlSequence(QVector<SharedNode> sequence, QObject* parent)
-  : YamlNode(parent)
-  , m_data(sequence)
+YamlSequence::YamlSequence(QVector<SharedNode> sequence)
+  : m_data(sequence)
 {
   m_type = Sequence;
 }
@@ -411,7 +486,7 @@ YamlSequence::toString(const QString& text, FlowType override)
   return result;
 }
 
-// void YamlSequence::setEnd(const QTextCursor &end)
+// void YamlSequence::setEnd(int end)
 //{
 
 //}
@@ -419,14 +494,12 @@ YamlSequence::toString(const QString& text, FlowType override)
 //====================================================================
 //=== YamlScalar
 //====================================================================
-YamlScalar::YamlScalar(QObject* parent)
-  : YamlNode(parent)
+YamlScalar::YamlScalar()
 {
   m_type = Scalar;
 }
 
-YamlScalar::YamlScalar(QString value, QObject* parent)
-  : YamlNode(parent)
+YamlScalar::YamlScalar(QString value)
 {
   m_type = Scalar;
   setData(value);
@@ -564,15 +637,13 @@ YamlScalar::data() const
 //====================================================================
 //=== YamlComment
 //====================================================================
-YamlComment::YamlComment(QObject* parent)
-  : YamlNode(parent)
+YamlComment::YamlComment()
 {
   m_type = Comment;
 }
 
-YamlComment::YamlComment(QString value, QObject* parent)
-  : YamlNode(parent)
-  , m_data(value)
+YamlComment::YamlComment(QString value)
+  : m_data(value)
 {
   m_type = Comment;
 }
@@ -612,15 +683,13 @@ YamlComment::data() const
 //====================================================================
 //=== YamlYamlDirective
 //====================================================================
-YamlYamlDirective::YamlYamlDirective(QObject* parent)
-  : YamlDirective(parent)
+YamlYamlDirective::YamlYamlDirective()
 {
   m_type = YamlNode::YamlDirective;
 }
 
-YamlYamlDirective::YamlYamlDirective(int major, int minor, QObject* parent)
-  : YamlDirective(parent)
-  , m_major(major)
+YamlYamlDirective::YamlYamlDirective(int major, int minor)
+  : m_major(major)
   , m_minor(minor)
 {
   m_type = YamlNode::YamlDirective;
@@ -656,20 +725,22 @@ YamlYamlDirective::isValid()
   return (m_major == 1 && (m_minor >= 0 && m_minor <= 3));
 }
 
-QTextCursor
-YamlYamlDirective::versionStart() const
+void
+YamlYamlDirective::shift(int delta)
 {
-  return m_versionStart;
+  YamlDirective::shift(delta);
+  if (m_versionStart >= 0)
+    m_versionStart += delta;
 }
 
 int
 YamlYamlDirective::versionStartPos() const
 {
-  return m_versionStart.position();
+  return m_versionStart;
 }
 
 void
-YamlYamlDirective::setVersionStart(const QTextCursor& versionStart)
+YamlYamlDirective::setVersionStart(int versionStart)
 {
   m_versionStart = versionStart;
 }
@@ -677,17 +748,13 @@ YamlYamlDirective::setVersionStart(const QTextCursor& versionStart)
 //====================================================================
 //=== YamlTagDirective
 //====================================================================
-YamlTagDirective::YamlTagDirective(QObject* parent)
-  : YamlDirective(parent)
+YamlTagDirective::YamlTagDirective()
 {
   m_type = TagDirective;
 }
 
-YamlTagDirective::YamlTagDirective(const QString& handle,
-                                   const QString& value,
-                                   QObject* parent)
-  : YamlDirective(parent)
-  , m_value(value)
+YamlTagDirective::YamlTagDirective(const QString& handle, const QString& value)
+  : m_value(value)
   , m_handle(handle)
 {
   m_type = TagDirective;
@@ -714,21 +781,15 @@ YamlTagDirective::setValue(const QString& value)
 }
 
 void
-YamlTagDirective::setValueStart(QTextCursor cursor)
-{
-  m_valueStart = cursor;
-}
-
-QTextCursor
-YamlTagDirective::valueStart()
+YamlTagDirective::setValueStart(int position)
 {
-  return m_valueStart;
+  m_valueStart = position;
 }
 
 int
 YamlTagDirective::valueStartPos()
 {
-  return m_valueStart.position();
+  return m_valueStart;
 }
 
 QString
@@ -738,27 +799,38 @@ YamlTagDirective::handle() const
 }
 
 void
-YamlTagDirective::setHandle(const QString& id)
+YamlTagDirective::setHandle(const QString& id, int handleId)
 {
   m_handle = id;
+  m_handleId = handleId;
 }
 
-void
-YamlTagDirective::setHandleStart(QTextCursor cursor)
+int
+YamlTagDirective::handleId() const
 {
-  m_handleStart = cursor;
+  return m_handleId;
 }
 
-QTextCursor
-YamlTagDirective::handleStart()
+void
+YamlTagDirective::setHandleStart(int position)
 {
-  return m_handleStart;
+  m_handleStart = position;
 }
 
 int
 YamlTagDirective::handleStartPos()
 {
-  return m_handleStart.position();
+  return m_handleStart;
+}
+
+void
+YamlTagDirective::shift(int delta)
+{
+  YamlDirective::shift(delta);
+  if (m_handleStart >= 0)
+    m_handleStart += delta;
+  if (m_valueStart >= 0)
+    m_valueStart += delta;
 }
 
 YamlTagDirective::TagHandleType
@@ -776,50 +848,67 @@ YamlTagDirective::setHandleType(TagHandleType handleType)
 //====================================================================
 //=== YamlReserveDirective
 //====================================================================
-YamlReservedDirective::YamlReservedDirective(QObject* parent)
-  : YamlDirective(parent)
+YamlReservedDirective::YamlReservedDirective()
 {
   m_type = ReservedDirective;
 }
 
 void
-YamlReservedDirective::addParameter(QTextCursor cursor, const QString& param)
+YamlReservedDirective::addParameter(int position, const QString& param)
 {
-  m_parameters.insert(cursor, param);
+  m_parameters.insert(position, param);
 }
 
 QString
-YamlReservedDirective::parameter(QTextCursor cursor)
+YamlReservedDirective::parameter(int position)
 {
-  return m_parameters.value(cursor, QString());
+  return m_parameters.value(position, QString());
 }
 
-QMap<QTextCursor, QString>
+QMap<int, QString>
 YamlReservedDirective::parameters()
 {
   return m_parameters;
 }
 
+void
+YamlReservedDirective::shift(int delta)
+{
+  YamlDirective::shift(delta);
+  QMap<int, QString> parameters;
+  for (auto [pos, param] : asKeyValueRange(m_parameters)) {
+    parameters.insert(pos + delta, param);
+  }
+  m_parameters = parameters;
+}
+
 //====================================================================
 //=== YamlDirective
 //====================================================================
-YamlDirective::YamlDirective(QObject* parent)
-  : YamlNode(parent)
+YamlDirective::YamlDirective()
 {
 }
 
-QTextCursor
+int
 YamlDirective::nameStart() const
 {
   return m_nameStart;
 }
 
 void
-YamlDirective::setNameStart(const QTextCursor& nameStart)
+YamlDirective::setNameStart(int nameStart)
 {
   m_nameStart = nameStart;
 }
 
+void
+YamlDirective::shift(int delta)
+{
+  YamlNode::shift(delta);
+  if (m_nameStart >= 0)
+    m_nameStart += delta;
+}
+
 QString
 YamlDirective::name() const
 {
@@ -835,8 +924,7 @@ YamlDirective::setName(const QString& name)
 //====================================================================
 //=== YamlStart
 //====================================================================
-YamlStart::YamlStart(QObject* parent)
-  : YamlNode(parent)
+YamlStart::YamlStart()
 {
   m_type = Start;
 }
@@ -844,8 +932,7 @@ YamlStart::YamlStart(QObject* parent)
 //====================================================================
 //=== YamlEnd
 //====================================================================
-YamlEnd::YamlEnd(QObject* parent)
-  : YamlNode(parent)
+YamlEnd::YamlEnd()
 {
   m_type = End;
 }
@@ -853,8 +940,7 @@ YamlEnd::YamlEnd(QObject* parent)
 //====================================================================
 //=== YamlAnchorBase
 //====================================================================
-YamlAnchorBase::YamlAnchorBase(QObject* parent)
-  : YamlNode(parent)
+YamlAnchorBase::YamlAnchorBase()
 {
   m_type = Anchor;
 }
@@ -866,35 +952,48 @@ YamlAnchorBase::name() const
 }
 
 void
-YamlAnchorBase::setName(const QString& name)
+YamlAnchorBase::setName(const QString& name, int nameId)
 {
   m_name = name;
+  m_nameId = nameId;
 }
 
-QTextCursor
+int
+YamlAnchorBase::nameId() const
+{
+  return m_nameId;
+}
+
+int
 YamlAnchorBase::nameStart() const
 {
   return m_nameStart;
 }
 
 void
-YamlAnchorBase::setNameStart(const QTextCursor& nameStart)
+YamlAnchorBase::setNameStart(int nameStart)
 {
   m_nameStart = nameStart;
 }
 
+void
+YamlAnchorBase::shift(int delta)
+{
+  YamlNode::shift(delta);
+  if (m_nameStart >= 0)
+    m_nameStart += delta;
+}
+
 //====================================================================
 //=== YamlAnchor
 //====================================================================
-YamlAnchor::YamlAnchor(QObject* parent)
-  : YamlAnchorBase(parent)
+YamlAnchor::YamlAnchor()
 {
 }
 
 //====================================================================
 //=== YamlAlias
 //====================================================================
-YamlAlias::YamlAlias(QObject* parent)
-  : YamlAnchorBase(parent)
+YamlAlias::YamlAlias()
 {
 }
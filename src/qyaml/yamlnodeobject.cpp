@@ -0,0 +1,48 @@
+#include "qyaml/yamlnodeobject.h"
+#include "qyaml/qyamldocument.h"
+
+//====================================================================
+//=== YamlNodeObject
+//====================================================================
+YamlNodeObject::YamlNodeObject(SharedNode node, QObject* parent)
+  : QObject(parent)
+  , m_arena(node && node->document() ? node->document()->arena() : nullptr)
+  , m_node(node)
+{
+}
+
+SharedNode
+YamlNodeObject::node() const
+{
+  return m_node;
+}
+
+int
+YamlNodeObject::type() const
+{
+  return (m_node ? int(m_node->type()) : int(YamlNode::Undefined));
+}
+
+int
+YamlNodeObject::startPos() const
+{
+  return (m_node ? m_node->startPos() : -1);
+}
+
+int
+YamlNodeObject::endPos() const
+{
+  return (m_node ? m_node->endPos() : -1);
+}
+
+int
+YamlNodeObject::length() const
+{
+  return (m_node ? m_node->length() : 0);
+}
+
+bool
+YamlNodeObject::hasErrors() const
+{
+  return (m_node && m_node->hasErrors());
+}
@@ -0,0 +1,360 @@
+#include "qyaml/yamlnodetable.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+namespace {
+
+bool
+startsBefore(const SharedNode& a, const SharedNode& b)
+{
+  return a->startPos() < b->startPos();
+}
+
+} // namespace
+
+//====================================================================
+//=== YamlNodeTable
+//====================================================================
+void
+YamlNodeTable::build(const QList<SharedNode>& nodes)
+{
+  clear();
+
+  // find every node below the given ones so that only the true roots
+  // start a subtree.
+  QSet<YamlNode*> seen;
+  QSet<YamlNode*> nested;
+  QList<SharedNode> pending;
+  for (auto& node : nodes) {
+    if (node)
+      pending.append(node);
+  }
+  QList<SharedNode> topLevel;
+  while (!pending.isEmpty()) {
+    auto node = pending.takeLast();
+    if (seen.contains(node.data()))
+      continue;
+    seen.insert(node.data());
+    topLevel.append(node);
+    for (auto& child : children(node)) {
+      nested.insert(child.data());
+      pending.append(child);
+    }
+  }
+  topLevel.removeIf(
+    [&nested](const SharedNode& node) { return nested.contains(node.data()); });
+  std::stable_sort(topLevel.begin(), topLevel.end(), startsBefore);
+
+  m_types.reserve(seen.size());
+  m_starts.reserve(seen.size());
+  m_lengths.reserve(seen.size());
+  m_parents.reserve(seen.size());
+  m_firstChildren.reserve(seen.size());
+  m_nextSiblings.reserve(seen.size());
+  m_dataIndexes.reserve(seen.size());
+  m_nodes.reserve(seen.size());
+  m_rows.reserve(seen.size());
+
+  auto previous = int(NoIndex);
+  for (auto& node : topLevel) {
+    auto row = size();
+    addSubtree(node, NoIndex);
+    if (previous != NoIndex)
+      m_nextSiblings[previous] = row;
+    m_roots.append(row);
+    previous = row;
+  }
+  buildPositionIndex();
+}
+
+void
+YamlNodeTable::build()
+{
+  // build() clears the rows it is given, so they are copied first.
+  auto nodes = m_nodes;
+  nodes.append(m_added);
+  build(nodes);
+}
+
+void
+YamlNodeTable::add(const SharedNode& node)
+{
+  if (node)
+    m_added.append(node);
+}
+
+void
+YamlNodeTable::clear()
+{
+  m_types.clear();
+  m_starts.clear();
+  m_lengths.clear();
+  m_parents.clear();
+  m_firstChildren.clear();
+  m_nextSiblings.clear();
+  m_dataIndexes.clear();
+  m_data.clear();
+  m_nodes.clear();
+  m_added.clear();
+  m_rows.clear();
+  m_roots.clear();
+  m_sortedRows.clear();
+  m_sortedStarts.clear();
+  m_enclosing.clear();
+}
+
+int
+YamlNodeTable::size() const
+{
+  return int(m_types.size());
+}
+
+bool
+YamlNodeTable::isEmpty() const
+{
+  return m_types.isEmpty();
+}
+
+YamlNode::Type
+YamlNodeTable::type(int index) const
+{
+  return YamlNode::Type(m_types.at(index));
+}
+
+int
+YamlNodeTable::startPos(int index) const
+{
+  return m_starts.at(index);
+}
+
+int
+YamlNodeTable::length(int index) const
+{
+  return m_lengths.at(index);
+}
+
+int
+YamlNodeTable::endPos(int index) const
+{
+  return m_starts.at(index) + m_lengths.at(index);
+}
+
+int
+YamlNodeTable::parent(int index) const
+{
+  return m_parents.at(index);
+}
+
+int
+YamlNodeTable::firstChild(int index) const
+{
+  return m_firstChildren.at(index);
+}
+
+int
+YamlNodeTable::nextSibling(int index) const
+{
+  return m_nextSiblings.at(index);
+}
+
+const QList<int>&
+YamlNodeTable::roots() const
+{
+  return m_roots;
+}
+
+QString
+YamlNodeTable::data(int index) const
+{
+  auto dataIndex = m_dataIndexes.at(index);
+  return (dataIndex == NoIndex ? QString() : m_data.at(dataIndex));
+}
+
+SharedNode
+YamlNodeTable::node(int index) const
+{
+  return m_nodes.at(index);
+}
+
+int
+YamlNodeTable::rowAt(int position) const
+{
+  // the last row starting at or before position, then out through the
+  // rows enclosing it until one also ends after position.
+  auto it = std::upper_bound(
+    m_sortedStarts.constBegin(), m_sortedStarts.constEnd(), position);
+  if (it == m_sortedStarts.constBegin())
+    return NoIndex;
+  auto index = std::distance(m_sortedStarts.constBegin(), it) - 1;
+  auto row = m_sortedRows.at(index);
+  while (row != NoIndex && position >= endPos(row)) {
+    row = m_enclosing.at(row);
+  }
+  return row;
+}
+
+QList<int>
+YamlNodeTable::rowsInRange(int from, int to) const
+{
+  QList<int> rows;
+  auto begin = m_sortedStarts.constBegin();
+  auto first = std::lower_bound(begin, m_sortedStarts.constEnd(), from);
+  auto last = std::upper_bound(first, m_sortedStarts.constEnd(), to);
+
+  // rows that start before the range can only reach into it if they
+  // enclose the last row to start before it.
+  if (first != begin) {
+    auto row = m_sortedRows.at(std::distance(begin, first) - 1);
+    for (; row != NoIndex; row = m_enclosing.at(row)) {
+      if (endPos(row) > from)
+        rows.prepend(row);
+    }
+  }
+  for (auto it = first; it != last; ++it) {
+    rows.append(m_sortedRows.at(std::distance(begin, it)));
+  }
+  return rows;
+}
+
+const QList<int>&
+YamlNodeTable::rowsByPosition() const
+{
+  return m_sortedRows;
+}
+
+int
+YamlNodeTable::indexOf(const SharedNode& node) const
+{
+  return m_rows.value(node.data(), NoIndex);
+}
+
+void
+YamlNodeTable::shift(int delta)
+{
+  for (auto& start : m_starts) {
+    if (start >= 0)
+      start += delta;
+  }
+  for (auto& start : m_sortedStarts) {
+    start += delta;
+  }
+}
+
+int
+YamlNodeTable::addRow(const SharedNode& node, int parent)
+{
+  auto row = size();
+  m_types.append(quint8(node->type()));
+  m_starts.append(node->startPos());
+  m_lengths.append(node->length());
+  m_parents.append(parent);
+  m_firstChildren.append(NoIndex);
+  m_nextSiblings.append(NoIndex);
+
+  auto dataIndex = int(NoIndex);
+  switch (node->type()) {
+    case YamlNode::Scalar:
+      dataIndex = int(m_data.size());
+      m_data.append(yamlRefCast<YamlScalar>(node)->data());
+      break;
+    case YamlNode::Comment:
+      dataIndex = int(m_data.size());
+      m_data.append(yamlRefCast<YamlComment>(node)->data());
+      break;
+    default:
+      break;
+  }
+  m_dataIndexes.append(dataIndex);
+
+  m_nodes.append(node);
+  m_rows.insert(node.data(), row);
+  return row;
+}
+
+void
+YamlNodeTable::addSubtree(const SharedNode& node, int parent)
+{
+  auto row = addRow(node, parent);
+  auto previous = int(NoIndex);
+  for (auto& child : children(node)) {
+    if (m_rows.contains(child.data()))
+      continue;
+    auto childRow = size();
+    addSubtree(child, row);
+    if (previous == NoIndex)
+      m_firstChildren[row] = childRow;
+    else
+      m_nextSiblings[previous] = childRow;
+    previous = childRow;
+  }
+}
+
+void
+YamlNodeTable::buildPositionIndex()
+{
+  m_sortedRows.reserve(size());
+  for (auto row = 0; row < size(); row++) {
+    if (m_starts.at(row) >= 0)
+      m_sortedRows.append(row);
+  }
+  // the rows are already almost in order, depth first with the children
+  // in position order. Where two rows start together the longer one
+  // encloses the other so goes first.
+  std::stable_sort(
+    m_sortedRows.begin(), m_sortedRows.end(), [this](int a, int b) {
+      if (m_starts.at(a) != m_starts.at(b))
+        return m_starts.at(a) < m_starts.at(b);
+      return m_lengths.at(a) > m_lengths.at(b);
+    });
+
+  // Not every row is enclosed by its tree parent, anchors and comments
+  // for instance are held by the document rather than the collection
+  // they sit in, so the enclosing rows are found from the spans.
+  m_enclosing.fill(NoIndex, size());
+  m_sortedStarts.reserve(m_sortedRows.size());
+  QList<int> open;
+  for (auto row : m_sortedRows) {
+    auto start = m_starts.at(row);
+    while (!open.isEmpty() && endPos(open.last()) <= start) {
+      open.removeLast();
+    }
+    if (!open.isEmpty())
+      m_enclosing[row] = open.last();
+    open.append(row);
+    m_sortedStarts.append(start);
+  }
+}
+
+QList<SharedNode>
+YamlNodeTable::children(const SharedNode& node)
+{
+  QList<SharedNode> result;
+  switch (node->type()) {
+    case YamlNode::Sequence:
+      for (auto& child : yamlRefCast<YamlSequence>(node)->data()) {
+        if (child)
+          result.append(child);
+      }
+      break;
+    case YamlNode::Map: {
+      // map items are held by key, put them back in position order.
+      for (auto& item : yamlRefCast<YamlMap>(node)->data()) {
+        if (item)
+          result.append(item);
+      }
+      std::stable_sort(result.begin(), result.end(), startsBefore);
+      break;
+    }
+    case YamlNode::MapItem: {
+      auto data = yamlRefCast<YamlMapItem>(node)->data();
+      if (data)
+        result.append(data);
+      break;
+    }
+    default:
+      break;
+  }
+  return result;
+}
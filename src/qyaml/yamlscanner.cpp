@@ -0,0 +1,268 @@
+#include "qyaml/yamlscanner.h"
+
+#include <QtAlgorithms>
+
+#if defined(Q_PROCESSOR_X86) && defined(__SSE2__)
+#define QYAML_SCANNER_SSE2
+#include <immintrin.h>
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+#define QYAML_SCANNER_AVX2
+#endif
+#endif
+
+namespace {
+
+bool
+isIndicator(char16_t c)
+{
+  switch (c) {
+    case u'#':
+    case u':':
+    case u'-':
+    case u'\'':
+    case u'"':
+    case u'[':
+    case u']':
+    case u'{':
+    case u'}':
+    case u',':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Appends base plus the offset of each set bit of bits.
+void
+addBits(int base, quint64 bits, QList<int>& positions)
+{
+  for (; bits; bits &= bits - 1) {
+    positions.append(base + qCountTrailingZeroBits(bits));
+  }
+}
+
+// Adds a block of width characters starting at base, given one bit per
+// character for the line feeds, spaces and indicators. inIndent is true
+// if the first character of the block is still in the indent of its
+// line, and is updated for the next block.
+void
+addBlock(int base,
+         int width,
+         quint64 newlines,
+         quint64 spaces,
+         quint64 indicators,
+         bool& inIndent,
+         YamlStructure& structure)
+{
+  const auto mask = (quint64(1) << width) - 1;
+  // the first character of each line, a line feed in the last character
+  // starts a line in the next block.
+  const auto starts = (newlines << 1) | quint64(inIndent);
+  // adding a start to the run of spaces it begins carries into the
+  // character after the run, the indent end. A line that starts with
+  // something other than a space is its own indent end.
+  const auto sum = spaces + (starts & spaces);
+  const auto ends = ((sum & ~spaces) | (starts & ~spaces)) & ~newlines & mask;
+  // a carry out of the block means the indent runs on into the next one.
+  inIndent = ((sum | starts) >> width) & 1;
+
+  addBits(base, newlines, structure.newlines);
+  addBits(base, ends, structure.indents);
+  addBits(base, indicators, structure.indicators);
+}
+
+// Scans the characters from pos to the end of text one at a time.
+void
+scanTail(QStringView text, int pos, bool inIndent, YamlStructure& structure)
+{
+  for (; pos < text.size(); pos++) {
+    auto c = text.at(pos).unicode();
+    if (c == u'\n') {
+      structure.newlines.append(pos);
+      inIndent = true;
+    } else if (inIndent && c != u' ') {
+      structure.indents.append(pos);
+      inIndent = false;
+    }
+    if (isIndicator(c))
+      structure.indicators.append(pos);
+  }
+}
+
+#ifdef QYAML_SCANNER_SSE2
+
+// One bit per character for two vectors of eight characters.
+quint64
+sse2Bits(__m128i low, __m128i high)
+{
+  return quint16(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+}
+
+__m128i
+sse2Indicators(__m128i chars)
+{
+  auto is = [chars](char16_t c) {
+    return _mm_cmpeq_epi16(chars, _mm_set1_epi16(short(c)));
+  };
+  return _mm_or_si128(
+    _mm_or_si128(_mm_or_si128(is(u'#'), is(u':')),
+                 _mm_or_si128(is(u'-'), is(u'\''))),
+    _mm_or_si128(
+      _mm_or_si128(_mm_or_si128(is(u'"'), is(u',')),
+                   _mm_or_si128(is(u'['), is(u']'))),
+      _mm_or_si128(is(u'{'), is(u'}'))));
+}
+
+int
+scanSse2(QStringView text, bool& inIndent, YamlStructure& structure)
+{
+  auto data = reinterpret_cast<const __m128i*>(text.utf16());
+  const auto newline = _mm_set1_epi16('\n');
+  const auto space = _mm_set1_epi16(' ');
+  auto pos = 0;
+  for (; pos + 16 <= text.size(); pos += 16, data += 2) {
+    auto low = _mm_loadu_si128(data);
+    auto high = _mm_loadu_si128(data + 1);
+    addBlock(pos,
+             16,
+             sse2Bits(_mm_cmpeq_epi16(low, newline),
+                      _mm_cmpeq_epi16(high, newline)),
+             sse2Bits(_mm_cmpeq_epi16(low, space),
+                      _mm_cmpeq_epi16(high, space)),
+             sse2Bits(sse2Indicators(low), sse2Indicators(high)),
+             inIndent,
+             structure);
+  }
+  return pos;
+}
+
+#endif
+
+#ifdef QYAML_SCANNER_AVX2
+
+// One bit per character for two vectors of sixteen characters. packs
+// works within each 128 bit lane so the quarters are put back in order
+// first.
+__attribute__((target("avx2"))) quint64
+avx2Bits(__m256i low, __m256i high)
+{
+  auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+  return quint32(_mm256_movemask_epi8(packed));
+}
+
+__attribute__((target("avx2"))) __m256i
+avx2Is(__m256i chars, char16_t c)
+{
+  return _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(short(c)));
+}
+
+__attribute__((target("avx2"))) __m256i
+avx2Indicators(__m256i chars)
+{
+  return _mm256_or_si256(
+    _mm256_or_si256(
+      _mm256_or_si256(avx2Is(chars, u'#'), avx2Is(chars, u':')),
+      _mm256_or_si256(avx2Is(chars, u'-'), avx2Is(chars, u'\''))),
+    _mm256_or_si256(
+      _mm256_or_si256(
+        _mm256_or_si256(avx2Is(chars, u'"'), avx2Is(chars, u',')),
+        _mm256_or_si256(avx2Is(chars, u'['), avx2Is(chars, u']'))),
+      _mm256_or_si256(avx2Is(chars, u'{'), avx2Is(chars, u'}'))));
+}
+
+__attribute__((target("avx2"))) int
+scanAvx2(QStringView text, bool& inIndent, YamlStructure& structure)
+{
+  auto data = reinterpret_cast<const __m256i*>(text.utf16());
+  const auto newline = _mm256_set1_epi16('\n');
+  const auto space = _mm256_set1_epi16(' ');
+  auto pos = 0;
+  for (; pos + 32 <= text.size(); pos += 32, data += 2) {
+    auto low = _mm256_loadu_si256(data);
+    auto high = _mm256_loadu_si256(data + 1);
+    addBlock(pos,
+             32,
+             avx2Bits(_mm256_cmpeq_epi16(low, newline),
+                      _mm256_cmpeq_epi16(high, newline)),
+             avx2Bits(_mm256_cmpeq_epi16(low, space),
+                      _mm256_cmpeq_epi16(high, space)),
+             avx2Bits(avx2Indicators(low), avx2Indicators(high)),
+             inIndent,
+             structure);
+  }
+  return pos;
+}
+
+bool
+hasAvx2()
+{
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+}
+
+#endif
+
+} // namespace
+
+YamlStructure
+YamlScanner::scan(QStringView text)
+{
+  auto structure = scan(text, bestKernel());
+  Q_ASSERT(structure == scan(text, Scalar));
+  return structure;
+}
+
+YamlStructure
+YamlScanner::scan(QStringView text, Kernel kernel)
+{
+  Q_ASSERT(isSupported(kernel));
+  YamlStructure structure;
+  // the text starts a line.
+  auto inIndent = true;
+  auto pos = 0;
+  switch (kernel) {
+#ifdef QYAML_SCANNER_SSE2
+    case Sse2:
+      pos = scanSse2(text, inIndent, structure);
+      break;
+#endif
+#ifdef QYAML_SCANNER_AVX2
+    case Avx2:
+      pos = scanAvx2(text, inIndent, structure);
+      break;
+#endif
+    default:
+      break;
+  }
+  scanTail(text, pos, inIndent, structure);
+  return structure;
+}
+
+bool
+YamlScanner::isSupported(Kernel kernel)
+{
+  switch (kernel) {
+    case Scalar:
+      return true;
+#ifdef QYAML_SCANNER_SSE2
+    case Sse2:
+      return true;
+#endif
+#ifdef QYAML_SCANNER_AVX2
+    case Avx2:
+      return hasAvx2();
+#endif
+    default:
+      return false;
+  }
+}
+
+YamlScanner::Kernel
+YamlScanner::bestKernel()
+{
+  if (isSupported(Avx2))
+    return Avx2;
+  if (isSupported(Sse2))
+    return Sse2;
+  return Scalar;
+}
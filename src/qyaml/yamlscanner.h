@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QList>
+#include <QStringView>
+
+#include <algorithm>
+
+//! The structural characters of a text, as sorted offsets into it.
+struct YamlStructure
+{
+  //! The line feeds.
+  QList<int> newlines;
+  //! The indent ends, the first character of each line that is not a
+  //! space, unless it is the line feed that ends a blank line.
+  QList<int> indents;
+  //! The indicators, '#', ':', '-', quotes and flow indicators.
+  QList<int> indicators;
+
+  bool operator==(const YamlStructure& other) const
+  {
+    return newlines == other.newlines && indents == other.indents &&
+           indicators == other.indicators;
+  }
+};
+
+//! Finds the structural characters of YAML text in one pass.
+//!
+//! On x86 the text is scanned 16 characters at a time with SSE2, or 32 at
+//! a time with AVX2 if the CPU supports it, the choice being made at run
+//! time. Other processors use the scalar scan. Each vector block gives a
+//! bit mask per kind of character, the indent ends being found from the
+//! masks of the spaces and line feeds with the state of the previous
+//! block carried into the next. Every kernel produces the same offsets,
+//! in debug builds the result is checked against the scalar one.
+class YamlScanner
+{
+public:
+  enum Kernel
+  {
+    Scalar, //!< One character at a time, on every processor.
+    Sse2,   //!< 16 characters at a time.
+    Avx2,   //!< 32 characters at a time.
+  };
+
+  //! Returns the structure of text using the fastest kernel the CPU
+  //! supports.
+  static YamlStructure scan(QStringView text);
+
+  //! Returns the structure of text using kernel, which must be supported.
+  static YamlStructure scan(QStringView text, Kernel kernel);
+
+  //! Returns true if kernel is built in and the CPU supports it.
+  static bool isSupported(Kernel kernel);
+
+  //! Returns the fastest kernel the CPU supports.
+  static Kernel bestKernel();
+};
+
+//! The line feeds and indent ends of part of a text already scanned by
+//! YamlScanner.
+//!
+//! A parse of one region of the text reads its lines from the scan of the
+//! whole text rather than scanning the region again.
+class YamlLines
+{
+public:
+  //! The line feeds and indent ends in structure that are within
+  //! [from, to), as offsets from from.
+  YamlLines(const YamlStructure& structure, int from, int to)
+    : m_begin(lowerBound(structure.newlines, from))
+    , m_end(std::lower_bound(m_begin, structure.newlines.constEnd(), to))
+    , m_indentBegin(lowerBound(structure.indents, from))
+    , m_indentEnd(
+        std::lower_bound(m_indentBegin, structure.indents.constEnd(), to))
+    , m_base(from)
+  {
+  }
+
+  //! The number of line feeds.
+  qsizetype size() const { return m_end - m_begin; }
+  //! Returns the offset of line feed i.
+  int at(qsizetype i) const { return m_begin[i] - m_base; }
+
+  //! The number of indent ends.
+  qsizetype indentCount() const { return m_indentEnd - m_indentBegin; }
+  //! Returns the offset of indent end i.
+  int indentAt(qsizetype i) const { return m_indentBegin[i] - m_base; }
+
+private:
+  QList<int>::const_iterator m_begin;
+  QList<int>::const_iterator m_end;
+  QList<int>::const_iterator m_indentBegin;
+  QList<int>::const_iterator m_indentEnd;
+  int m_base;
+
+  static QList<int>::const_iterator lowerBound(const QList<int>& positions,
+                                               int value)
+  {
+    return std::lower_bound(
+      positions.constBegin(), positions.constEnd(), value);
+  }
+};
@@ -0,0 +1,58 @@
+#include "qyaml/yamlstringpool.h"
+
+//====================================================================
+//=== YamlStringPool
+//====================================================================
+YamlStringPool::Entry
+YamlStringPool::intern(const QString& text)
+{
+  {
+    QReadLocker locker(&m_lock);
+    auto it = m_ids.constFind(text);
+    if (it != m_ids.constEnd()) {
+      m_reused.ref();
+      return { it.value(), m_strings.at(it.value()) };
+    }
+  }
+
+  QWriteLocker locker(&m_lock);
+  // another thread may have added it between the locks.
+  auto it = m_ids.constFind(text);
+  if (it != m_ids.constEnd()) {
+    m_reused.ref();
+    return { it.value(), m_strings.at(it.value()) };
+  }
+  auto id = int(m_strings.size());
+  m_strings.append(text);
+  m_ids.insert(text, id);
+  return { id, text };
+}
+
+int
+YamlStringPool::id(const QString& text) const
+{
+  QReadLocker locker(&m_lock);
+  return m_ids.value(text, NoId);
+}
+
+QString
+YamlStringPool::string(int id) const
+{
+  QReadLocker locker(&m_lock);
+  if (id < 0 || id >= m_strings.size())
+    return QString();
+  return m_strings.at(id);
+}
+
+int
+YamlStringPool::size() const
+{
+  QReadLocker locker(&m_lock);
+  return int(m_strings.size());
+}
+
+qsizetype
+YamlStringPool::reuseCount() const
+{
+  return m_reused.loadRelaxed();
+}
@@ -0,0 +1,204 @@
+#include "qyaml/yamltokens.h"
+
+#include <QHash>
+#include <QHashFunctions>
+
+#include <algorithm>
+
+namespace {
+
+bool
+tokenBefore(const YamlTokens::Token& a, const YamlTokens::Token& b)
+{
+  if (a.start != b.start)
+    return a.start < b.start;
+  if (a.length != b.length)
+    return a.length > b.length;
+  return a.type < b.type;
+}
+
+} // namespace
+
+//====================================================================
+//=== YamlTokens
+//====================================================================
+YamlTokens
+YamlTokens::take(const QList<SharedDocument>& documents,
+                 const YamlTokens& previous,
+                 const QSet<const QYamlDocument*>& reparsed)
+{
+  QHash<const QYamlDocument*, qsizetype> previousIndexes;
+  for (qsizetype i = 0; i < previous.m_documents.size(); i++) {
+    previousIndexes.insert(previous.m_documents.at(i).key, i);
+  }
+
+  YamlTokens tokens;
+  tokens.m_documents.reserve(documents.size());
+  for (auto& doc : documents) {
+    if (!doc)
+      continue;
+    auto index = previousIndexes.value(doc.data(), -1);
+    if (index >= 0 && !reparsed.contains(doc.data())) {
+      auto& old = previous.m_documents.at(index);
+      // the address of a deleted document can be reused by a new one.
+      if (old.document.toStrongRef() == doc) {
+        // the tokens are relative to the document, so they are still
+        // right wherever the document has moved to.
+        auto reused = old;
+        reused.start = qMax(doc->startPos(), 0);
+        reused.reused = true;
+        tokens.m_documents.append(reused);
+        continue;
+      }
+    }
+    tokens.m_documents.append(takeDocument(doc));
+  }
+  return tokens;
+}
+
+QList<QPair<int, int>>
+YamlTokens::changedRanges(const YamlTokens& previous,
+                          int position,
+                          int charsRemoved,
+                          int charsAdded) const
+{
+  // Only the documents that were taken again can differ, they are
+  // compared with every previous document that was not reused.
+  QSet<const QYamlDocument*> reused;
+  for (auto& doc : m_documents) {
+    if (doc.reused)
+      reused.insert(doc.key);
+  }
+  auto current = tokensExcept(reused);
+  auto old = previous.tokensExcept(reused);
+  if (position >= 0) {
+    auto removedEnd = position + charsRemoved;
+    auto delta = charsAdded - charsRemoved;
+    for (auto& token : old) {
+      if (token.start >= removedEnd)
+        token.start += delta;
+    }
+    std::sort(old.begin(), old.end(), tokenBefore);
+  }
+
+  QList<QPair<int, int>> changed;
+  auto markChanged = [&changed](const Token& token) {
+    changed.append({ token.start, token.length });
+  };
+  qsizetype i = 0, j = 0;
+  while (i < old.size() || j < current.size()) {
+    if (i == old.size()) {
+      markChanged(current.at(j++));
+    } else if (j == current.size()) {
+      markChanged(old.at(i++));
+    } else if (old.at(i) == current.at(j)) {
+      i++;
+      j++;
+    } else if (tokenBefore(old.at(i), current.at(j))) {
+      markChanged(old.at(i++));
+    } else if (tokenBefore(current.at(j), old.at(i))) {
+      markChanged(current.at(j++));
+    } else {
+      // same span, different state.
+      markChanged(current.at(j++));
+      i++;
+    }
+  }
+  if (position >= 0)
+    changed.append({ position, charsAdded });
+
+  // the ranges are in order, join those that overlap or touch.
+  std::sort(changed.begin(), changed.end());
+  QList<QPair<int, int>> merged;
+  for (auto& [start, length] : changed) {
+    if (!merged.isEmpty()) {
+      auto& last = merged.last();
+      if (start <= last.first + last.second) {
+        last.second = qMax(last.second, start + length - last.first);
+        continue;
+      }
+    }
+    merged.append({ start, length });
+  }
+  return merged;
+}
+
+bool
+YamlTokens::isEmpty() const
+{
+  for (auto& doc : m_documents) {
+    if (!doc.tokens.isEmpty())
+      return false;
+  }
+  return true;
+}
+
+int
+YamlTokens::reusedCount() const
+{
+  return int(std::count_if(
+    m_documents.constBegin(),
+    m_documents.constEnd(),
+    [](const DocumentTokens& doc) { return doc.reused; }));
+}
+
+YamlTokens::DocumentTokens
+YamlTokens::takeDocument(const SharedDocument& document)
+{
+  DocumentTokens result;
+  result.key = document.data();
+  result.document = document;
+  result.start = qMax(document->startPos(), 0);
+
+  auto add = [&result](int start, int length, int type, size_t state) {
+    if (start >= 0)
+      result.tokens.append({ start - result.start, length, type, state });
+  };
+  auto& table = document->nodeTable();
+  for (auto row : table.rowsByPosition()) {
+    auto node = table.node(row);
+    auto type = table.type(row);
+    auto state = qHashMulti(0,
+                            node->errors().toInt(),
+                            node->warnings().toInt(),
+                            int(node->flowType()),
+                            node->dodgyChars().keys());
+    switch (type) {
+      case YamlNode::Map:
+      case YamlNode::Sequence:
+        // only the brackets of a flow collection are formatted.
+        if (node->flowType() == YamlNode::Flow) {
+          add(table.startPos(row), 1, type, state);
+          add(table.endPos(row), 1, type, state);
+        }
+        break;
+      case YamlNode::MapItem: {
+        auto item = yamlRefCast<YamlMapItem>(node);
+        add(table.startPos(row), item->keyLength(), type, state);
+        break;
+      }
+      default:
+        add(table.startPos(row), table.length(row), type, state);
+        break;
+    }
+  }
+  std::sort(result.tokens.begin(), result.tokens.end(), tokenBefore);
+  return result;
+}
+
+QList<YamlTokens::Token>
+YamlTokens::tokensExcept(const QSet<const QYamlDocument*>& skip) const
+{
+  QList<Token> tokens;
+  for (auto& doc : m_documents) {
+    if (skip.contains(doc.key))
+      continue;
+    for (auto token : doc.tokens) {
+      token.start += doc.start;
+      tokens.append(token);
+    }
+  }
+  // documents can be out of order while an edit is being applied.
+  std::sort(tokens.begin(), tokens.end(), tokenBefore);
+  return tokens;
+}
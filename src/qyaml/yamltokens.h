@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QWeakPointer>
+
+#include "qyaml/qyamldocument.h"
+
+//! A snapshot of the spans that QYamlHighlighter formats.
+//!
+//! Comparing the snapshots of two parses gives the ranges of text whose
+//! highlighting can have changed, so that only the blocks within them
+//! need to be rehighlighted. A token is the part of a node that is
+//! formatted, collections only contribute their flow brackets and map
+//! items only their keys, so an edit within a scalar does not mark the
+//! whole of the collections around it as changed.
+//!
+//! The tokens are held per document, relative to the start of the
+//! document, so the tokens of a document that was not reparsed are
+//! carried over from the previous snapshot as they are, even if the
+//! document has moved.
+class YamlTokens
+{
+public:
+  struct Token
+  {
+    int start = 0;
+    int length = 0;
+    int type = 0;
+    //! A hash of everything else that affects the format of the token,
+    //! its errors and warnings for instance.
+    size_t state = 0;
+
+    bool operator==(const Token& other) const
+    {
+      return (start == other.start && length == other.length &&
+              type == other.type && state == other.state);
+    }
+  };
+
+  //! Takes the tokens of documents.
+  //!
+  //! The tokens of a document that is in previous and not in reparsed are
+  //! reused, only the other documents have their nodes walked.
+  static YamlTokens take(const QList<SharedDocument>& documents,
+                         const YamlTokens& previous = YamlTokens(),
+                         const QSet<const QYamlDocument*>& reparsed = {});
+
+  //! Returns the (position, length) ranges of the text where the tokens
+  //! differ from previous, sorted and merged. previous must be the tokens
+  //! these were taken against, only the documents whose tokens were not
+  //! reused are compared.
+  //!
+  //! If the text was edited since previous, charsRemoved characters at
+  //! position being replaced by charsAdded, the previous tokens after the
+  //! edit are moved to where that text is now before comparing, and the
+  //! edited text is always one of the ranges. QSyntaxHighlighter formats
+  //! the edited blocks as soon as the text changes, before the edit is
+  //! parsed, so they have to be formatted again. A position of -1 means
+  //! the edit is not known.
+  QList<QPair<int, int>> changedRanges(const YamlTokens& previous,
+                                       int position = -1,
+                                       int charsRemoved = 0,
+                                       int charsAdded = 0) const;
+
+  bool isEmpty() const;
+
+  //! Returns the number of documents whose tokens were reused from the
+  //! previous snapshot rather than taken again.
+  int reusedCount() const;
+
+private:
+  struct DocumentTokens
+  {
+    //! A snapshot does not keep its documents alive, the weak pointer
+    //! tells whether key still names the same document.
+    const QYamlDocument* key = nullptr;
+    QWeakPointer<QYamlDocument> document;
+    //! The start of the document when the snapshot was made.
+    int start = 0;
+    //! The tokens, relative to start and sorted.
+    QList<Token> tokens;
+    bool reused = false;
+  };
+  QList<DocumentTokens> m_documents;
+
+  static DocumentTokens takeDocument(const SharedDocument& document);
+  //! Returns the tokens of the documents not in skip at their positions
+  //! in the text, sorted.
+  QList<Token> tokensExcept(const QSet<const QYamlDocument*>& skip) const;
+};
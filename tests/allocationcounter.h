@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+//! Counts the heap allocations made while it exists.
+//!
+//! With glibc malloc(), calloc() and realloc() are replaced by versions
+//! that count the call and forward to the C library, so operator new and
+//! the allocations of QString and QList are all counted. The replacement
+//! affects the whole executable, so this header is only included by the
+//! one source file of a test. Elsewhere isAvailable() returns false and
+//! nothing is counted.
+class AllocationCounter
+{
+public:
+  AllocationCounter()
+    : m_count(s_count.load(std::memory_order_relaxed))
+    , m_bytes(s_bytes.load(std::memory_order_relaxed))
+  {
+  }
+
+  static bool isAvailable()
+  {
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  //! Returns the number of allocations since the counter was made.
+  qint64 count() const
+  {
+    return s_count.load(std::memory_order_relaxed) - m_count;
+  }
+
+  //! Returns the number of bytes asked for since the counter was made.
+  qint64 bytes() const
+  {
+    return s_bytes.load(std::memory_order_relaxed) - m_bytes;
+  }
+
+  static void add(std::size_t size)
+  {
+    s_count.fetch_add(1, std::memory_order_relaxed);
+    s_bytes.fetch_add(qint64(size), std::memory_order_relaxed);
+  }
+
+private:
+  static inline std::atomic<qint64> s_count{ 0 };
+  static inline std::atomic<qint64> s_bytes{ 0 };
+  qint64 m_count;
+  qint64 m_bytes;
+};
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+  void* __libc_malloc(std::size_t size) noexcept;
+  void* __libc_calloc(std::size_t count, std::size_t size) noexcept;
+  void* __libc_realloc(void* memory, std::size_t size) noexcept;
+
+  void* malloc(std::size_t size) noexcept
+  {
+    AllocationCounter::add(size);
+    return __libc_malloc(size);
+  }
+
+  void* calloc(std::size_t count, std::size_t size) noexcept
+  {
+    AllocationCounter::add(count * size);
+    return __libc_calloc(count, size);
+  }
+
+  void* realloc(void* memory, std::size_t size) noexcept
+  {
+    AllocationCounter::add(size);
+    return __libc_realloc(memory, size);
+  }
+}
+
+#endif
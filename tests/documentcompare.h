@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QTest>
+
+#include "qyaml/qyamldocument.h"
+
+//! Compares two parses of the same text, document by document and then
+//! row by row through their node tables in position order.
+//!
+//! Positions are compared after adding the base of their document, so a
+//! streamed document compares equal to the same document parsed from the
+//! whole text.
+inline void
+compareDocuments(const QList<SharedDocument>& actual,
+                 const QList<SharedDocument>& expected)
+{
+  QCOMPARE(actual.size(), expected.size());
+  for (auto i = 0; i < actual.size(); i++) {
+    auto doc = actual.at(i);
+    auto expectedDoc = expected.at(i);
+    auto base = doc->base();
+    auto expectedBase = expectedDoc->base();
+    QCOMPARE(base + doc->startPos(), expectedBase + expectedDoc->startPos());
+    QCOMPARE(base + doc->endPos(), expectedBase + expectedDoc->endPos());
+    QCOMPARE(doc->implicitEnd(), expectedDoc->implicitEnd());
+
+    auto& table = doc->nodeTable();
+    auto& expectedTable = expectedDoc->nodeTable();
+    auto& rows = table.rowsByPosition();
+    auto& expectedRows = expectedTable.rowsByPosition();
+    QCOMPARE(rows.size(), expectedRows.size());
+    for (auto j = 0; j < rows.size(); j++) {
+      auto row = rows.at(j);
+      auto expectedRow = expectedRows.at(j);
+      QCOMPARE(table.type(row), expectedTable.type(expectedRow));
+      QCOMPARE(base + table.startPos(row),
+               expectedBase + expectedTable.startPos(expectedRow));
+      QCOMPARE(table.length(row), expectedTable.length(expectedRow));
+      QCOMPARE(table.data(row), expectedTable.data(expectedRow));
+    }
+  }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QString>
+
+//! Returns a stream of count manifest like documents for the benchmarks.
+//!
+//! Every document repeats the same keys and has comments, quoted scalars
+//! and flow collections, as the configuration files the library is used
+//! on do.
+inline QString
+manifestText(int count)
+{
+  QString text = QStringLiteral("%YAML 1.2\n");
+  for (auto i = 0; i < count; i++) {
+    text += QStringLiteral("---\n"
+                           "# manifest %1\n"
+                           "name: service-%1\n"
+                           "image: \"registry/app:%1\"\n"
+                           "env:\n"
+                           "  - name: LEVEL\n"
+                           "    value: '%1'\n"
+                           "  - { name: MODE, value: fast }\n"
+                           "ports: [ 80, 443 ]\n")
+              .arg(i);
+  }
+  return text;
+}
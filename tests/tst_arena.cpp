@@ -0,0 +1,236 @@
+#include <QElapsedTimer>
+#include <QTest>
+
+#include "documentcompare.h"
+#include "qyaml/qyamlparser.h"
+#include "qyaml/yamlarena.h"
+#include "sampletext.h"
+
+namespace {
+
+//! Counts its destructions, to see when handles and arenas release it.
+struct Counted : public YamlRefCounted
+{
+  explicit Counted(int* destroyed)
+    : m_destroyed(destroyed)
+  {
+  }
+  ~Counted() { ++*m_destroyed; }
+
+  int* m_destroyed;
+};
+
+//! Holds handles to other objects, as the nodes of a document do.
+struct Linked : public Counted
+{
+  using Counted::Counted;
+
+  QList<YamlRef<Linked>> m_links;
+};
+
+QString
+sampleText()
+{
+  QString text;
+  for (auto i = 0; i < 200; i++) {
+    text += QStringLiteral("%YAML 1.2\n---\n# document %1\n...\n").arg(i);
+  }
+  return text;
+}
+
+} // namespace
+
+//! Checks that nodes allocated from an arena are owned by it, and that
+//! parsing gives the same documents with and without the arena.
+class TestArena : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void cleanup();
+  void heapHandlesShare();
+  void arenaOwnsObjects();
+  void nodesInArena();
+  void arenaMatchesHeap();
+  void linkedTeardown();
+  void parseAndTeardown_data();
+  void parseAndTeardown();
+};
+
+void
+TestArena::cleanup()
+{
+  YamlArena::setEnabled(true);
+}
+
+void
+TestArena::heapHandlesShare()
+{
+  auto destroyed = 0;
+  {
+    auto first = YamlArena::create<Counted>(nullptr, &destroyed);
+    QVERIFY(!first->isArenaOwned());
+    auto second = first;
+    first.reset();
+    QCOMPARE(destroyed, 0);
+    QVERIFY(second);
+  }
+  QCOMPARE(destroyed, 1);
+}
+
+void
+TestArena::arenaOwnsObjects()
+{
+  auto destroyed = 0;
+  YamlRef<Counted> kept;
+  {
+    YamlArena arena;
+    for (auto i = 0; i < 1000; i++) {
+      auto counted = YamlArena::create<Counted>(&arena, &destroyed);
+      QVERIFY(counted->isArenaOwned());
+      kept = counted;
+    }
+    // the handles do not own the objects.
+    QCOMPARE(destroyed, 0);
+    QCOMPARE(arena.allocationCount(), 1000);
+    QVERIFY(arena.blockCount() < arena.allocationCount());
+    kept.reset();
+    QCOMPARE(destroyed, 0);
+  }
+  QCOMPARE(destroyed, 1000);
+}
+
+void
+TestArena::nodesInArena()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(sampleText());
+
+  for (auto& doc : parser.documents()) {
+    QVERIFY(doc->arena());
+    auto& table = doc->nodeTable();
+    QVERIFY(table.size() > 0);
+    QVERIFY(doc->arena()->allocationCount() >= table.size());
+    for (auto row = 0; row < table.size(); row++) {
+      QVERIFY(table.node(row)->isArenaOwned());
+    }
+  }
+}
+
+void
+TestArena::arenaMatchesHeap()
+{
+  auto text = sampleText();
+
+  QYamlParser arenaParser;
+  arenaParser.setThreaded(false);
+  arenaParser.parse(text);
+
+  YamlArena::setEnabled(false);
+  QYamlParser heapParser;
+  heapParser.setThreaded(false);
+  heapParser.parse(text);
+
+  for (auto& doc : heapParser.documents()) {
+    QVERIFY(!doc->arena());
+    auto& table = doc->nodeTable();
+    for (auto row = 0; row < table.size(); row++) {
+      QVERIFY(!table.node(row)->isArenaOwned());
+    }
+  }
+  compareDocuments(heapParser.documents(), arenaParser.documents());
+}
+
+void
+TestArena::linkedTeardown()
+{
+  auto destroyed = 0;
+  {
+    YamlArena arena;
+    auto root = YamlArena::create<Linked>(&arena, &destroyed);
+    QVERIFY(arena.owns(root.data()));
+    QVERIFY(!arena.owns(&destroyed));
+    for (auto i = 0; i < 1000; i++) {
+      // links both ways, so whatever the order of the destructors some
+      // handles outlive the objects they point to.
+      auto child = YamlArena::create<Linked>(&arena, &destroyed);
+      child->m_links.append(root);
+      root->m_links.append(child);
+    }
+    // a heap object held by an arena object is still released.
+    root->m_links.append(YamlArena::create<Linked>(nullptr, &destroyed));
+  }
+  QCOMPARE(destroyed, 1002);
+}
+
+void
+TestArena::parseAndTeardown_data()
+{
+  QTest::addColumn<bool>("useArena");
+  QTest::addColumn<bool>("teardown");
+
+  QTest::newRow("arena parse") << true << false;
+  QTest::newRow("arena teardown") << true << true;
+  QTest::newRow("heap parse") << false << false;
+  QTest::newRow("heap teardown") << false << true;
+}
+
+void
+TestArena::parseAndTeardown()
+{
+  QFETCH(bool, useArena);
+  QFETCH(bool, teardown);
+
+  // Each parse is timed apart from the destruction of its documents, so
+  // QBENCHMARK, which times the whole of its body, is not used.
+  auto text = manifestText(1000);
+  YamlArena::setEnabled(useArena);
+  const auto repeats = 10;
+  qint64 elapsed = 0;
+  qsizetype nodes = 0;
+  qsizetype allocations = 0;
+  qsizetype blocks = 0;
+  for (auto i = 0; i < repeats; i++) {
+    QElapsedTimer timer;
+    QList<SharedDocument> documents;
+    {
+      QYamlParser parser;
+      parser.setThreaded(false);
+      timer.start();
+      parser.parse(text);
+      if (!teardown)
+        elapsed += timer.nsecsElapsed();
+      documents = parser.documents();
+    }
+
+    nodes = allocations = blocks = 0;
+    for (auto& doc : documents) {
+      nodes += doc->nodeTable().size();
+      if (doc->arena()) {
+        allocations += doc->arena()->allocationCount();
+        blocks += doc->arena()->blockCount();
+      }
+    }
+
+    // the documents are only held here, so this destroys them.
+    timer.start();
+    documents.clear();
+    if (teardown)
+      elapsed += timer.nsecsElapsed();
+  }
+
+  if (useArena) {
+    qInfo("%lld nodes, %lld arena allocations from %lld blocks",
+          qint64(nodes),
+          qint64(allocations),
+          qint64(blocks));
+  } else {
+    qInfo("%lld nodes, each a heap allocation", qint64(nodes));
+  }
+  QTest::setBenchmarkResult(qreal(elapsed) / 1e6 / repeats,
+                            QTest::WalltimeMilliseconds);
+}
+
+QTEST_GUILESS_MAIN(TestArena)
+#include "tst_arena.moc"
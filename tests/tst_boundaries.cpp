@@ -0,0 +1,84 @@
+#include <QTest>
+
+#include "documentcompare.h"
+#include "qyaml/qyamlparser.h"
+#include "qyaml/yamlboundaries.h"
+
+//! Checks that splitting the text at its document boundaries and parsing
+//! the documents in parallel finds the same documents as one serial pass.
+class TestBoundaries : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void markers();
+  void serialMatchesParallel_data();
+  void serialMatchesParallel();
+};
+
+void
+TestBoundaries::markers()
+{
+  QVERIFY(YamlBoundaryScanner::isDirectivesEnd(QStringView(u"---")));
+  QVERIFY(YamlBoundaryScanner::isDirectivesEnd(QStringView(u"--- a")));
+  QVERIFY(YamlBoundaryScanner::isDirectivesEnd(QStringView(u"---\ta")));
+  QVERIFY(YamlBoundaryScanner::isDirectivesEnd(QStringView(u"---\r")));
+  QVERIFY(!YamlBoundaryScanner::isDirectivesEnd(QStringView(u"---a")));
+  QVERIFY(!YamlBoundaryScanner::isDirectivesEnd(QStringView(u"--")));
+  QVERIFY(!YamlBoundaryScanner::isDirectivesEnd(QStringView(u" ---")));
+  QVERIFY(YamlBoundaryScanner::isDocumentEnd(QStringView(u"...")));
+  QVERIFY(YamlBoundaryScanner::isDocumentEnd(QStringView(u"... # end")));
+  QVERIFY(!YamlBoundaryScanner::isDocumentEnd(QStringView(u"....")));
+  QVERIFY(YamlBoundaryScanner::isDirectivesEnd(QByteArrayView("---\r")));
+  QVERIFY(!YamlBoundaryScanner::isDocumentEnd(QByteArrayView("...a")));
+}
+
+void
+TestBoundaries::serialMatchesParallel_data()
+{
+  QTest::addColumn<QString>("text");
+
+  QTest::newRow("explicit documents")
+    << QStringLiteral("%YAML 1.2\n---\n# first\na: 1\n...\n"
+                      "# between\n--- # second\nb: 2\n...\n");
+  QTest::newRow("marker followed by content")
+    << QStringLiteral("---\ta: 1\n--- b: 2\n---\n");
+  QTest::newRow("not a marker") << QStringLiteral("---a\n...b\n# c\n");
+  QTest::newRow("directive after content")
+    << QStringLiteral("a: 1\n%YAML 1.2\n---\nb: 2\n%TAG ! tag:a,2000:\n");
+  QTest::newRow("carriage returns")
+    << QStringLiteral("---\r\na: 1\r\n...\r\n---\r\n# b\r\n");
+  QTest::newRow("document end at the end") << QStringLiteral("a\n...\n");
+  QTest::newRow("document end with comment")
+    << QStringLiteral("a\n... # done\n\n# after\n");
+
+  // enough documents for the regions to be parsed on several threads.
+  QString many;
+  for (auto i = 0; i < 500; i++) {
+    many += QStringLiteral("# doc %1\n---%2key: %1\n").arg(i).arg(
+      i % 3 == 0 ? QStringLiteral("\t") : QStringLiteral("\n"));
+    if (i % 7 == 0)
+      many += QStringLiteral("... # end\n");
+    if (i % 11 == 0)
+      many += QStringLiteral("%YAML 1.2\n");
+  }
+  QTest::newRow("many documents") << many;
+}
+
+void
+TestBoundaries::serialMatchesParallel()
+{
+  QFETCH(QString, text);
+
+  QYamlParser serial;
+  serial.setThreaded(false);
+  serial.parse(text);
+
+  QYamlParser parallel;
+  parallel.parse(text);
+
+  compareDocuments(parallel.documents(), serial.documents());
+}
+
+QTEST_GUILESS_MAIN(TestBoundaries)
+#include "tst_boundaries.moc"
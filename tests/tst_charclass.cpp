@@ -0,0 +1,231 @@
+#include <QTest>
+
+#include <algorithm>
+#include <iterator>
+
+#include "qyaml/yamlcharclass.h"
+#include "sampletext.h"
+
+namespace {
+
+using Predicate = bool (*)(QChar);
+
+// The productions as the YAML 1.2 specification words them, one
+// comparison after another, as the parser tested characters before the
+// table.
+bool
+chainedIndicator(QChar c)
+{
+  auto u = c.unicode();
+  return (u == u'-' || u == u'?' || u == u':' || u == u',' || u == u'[' ||
+          u == u']' || u == u'{' || u == u'}' || u == u'#' || u == u'&' ||
+          u == u'*' || u == u'!' || u == u'|' || u == u'>' || u == u'\'' ||
+          u == u'"' || u == u'%' || u == u'@' || u == u'`');
+}
+
+bool
+chainedFlowIndicator(QChar c)
+{
+  auto u = c.unicode();
+  return (u == u',' || u == u'[' || u == u']' || u == u'{' || u == u'}');
+}
+
+bool
+chainedPrintable(QChar c)
+{
+  // a surrogate half is printable as part of its supplementary character.
+  auto u = c.unicode();
+  return (u == 0x09 || u == 0x0A || u == 0x0D || (u >= 0x20 && u <= 0x7E) ||
+          u == 0x85 || (u >= 0xA0 && u <= 0xFFFD));
+}
+
+bool
+chainedBreak(QChar c)
+{
+  return (c == u'\n' || c == u'\r');
+}
+
+bool
+chainedWhite(QChar c)
+{
+  return (c == u' ' || c == u'\t');
+}
+
+bool
+chainedDecDigit(QChar c)
+{
+  return (c >= u'0' && c <= u'9');
+}
+
+bool
+chainedHexDigit(QChar c)
+{
+  return (chainedDecDigit(c) || (c >= u'A' && c <= u'F') ||
+          (c >= u'a' && c <= u'f'));
+}
+
+bool
+chainedAsciiLetter(QChar c)
+{
+  return ((c >= u'A' && c <= u'Z') || (c >= u'a' && c <= u'z'));
+}
+
+bool
+chainedWordChar(QChar c)
+{
+  return (chainedDecDigit(c) || chainedAsciiLetter(c) || c == u'-');
+}
+
+bool
+chainedUriChar(QChar c)
+{
+  auto u = c.unicode();
+  return (chainedWordChar(c) || u == u'#' || u == u';' || u == u'/' ||
+          u == u'?' || u == u':' || u == u'@' || u == u'&' || u == u'=' ||
+          u == u'+' || u == u'$' || u == u',' || u == u'_' || u == u'.' ||
+          u == u'!' || u == u'~' || u == u'*' || u == u'\'' || u == u'(' ||
+          u == u')' || u == u'[' || u == u']');
+}
+
+bool
+chainedJson(QChar c)
+{
+  return (c == u'\t' || c.unicode() >= 0x20);
+}
+
+bool
+chainedNbChar(QChar c)
+{
+  return (chainedPrintable(c) && !chainedBreak(c) && c.unicode() != 0xFEFF);
+}
+
+bool
+chainedNsChar(QChar c)
+{
+  return (chainedNbChar(c) && !chainedWhite(c));
+}
+
+template<quint16 flags>
+bool
+tableIs(QChar c)
+{
+  return YamlCharClass::is(c, flags);
+}
+
+bool
+tableNbChar(QChar c)
+{
+  return YamlCharClass::isNbChar(c);
+}
+
+bool
+tableNsChar(QChar c)
+{
+  return YamlCharClass::isNsChar(c);
+}
+
+struct Predicates
+{
+  const char* name;
+  Predicate table;
+  Predicate chained;
+};
+
+const Predicates PREDICATES[] = {
+  { "c-indicator", tableIs<YamlCharClass::Indicator>, chainedIndicator },
+  { "c-flow-indicator",
+    tableIs<YamlCharClass::FlowIndicator>,
+    chainedFlowIndicator },
+  { "c-printable", tableIs<YamlCharClass::Printable>, chainedPrintable },
+  { "b-char", tableIs<YamlCharClass::Break>, chainedBreak },
+  { "s-white", tableIs<YamlCharClass::White>, chainedWhite },
+  { "ns-dec-digit", tableIs<YamlCharClass::DecDigit>, chainedDecDigit },
+  { "ns-hex-digit", tableIs<YamlCharClass::HexDigit>, chainedHexDigit },
+  { "ns-ascii-letter",
+    tableIs<YamlCharClass::AsciiLetter>,
+    chainedAsciiLetter },
+  { "ns-word-char", tableIs<YamlCharClass::WordChar>, chainedWordChar },
+  { "ns-uri-char", tableIs<YamlCharClass::UriChar>, chainedUriChar },
+  { "nb-json", tableIs<YamlCharClass::Json>, chainedJson },
+  { "nb-char", tableNbChar, chainedNbChar },
+  { "ns-char", tableNsChar, chainedNsChar },
+};
+
+} // namespace
+
+//! Checks that the character class table agrees with the productions as
+//! the specification words them, and measures each predicate both ways.
+class TestCharClass : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void tableMatchesChained_data();
+  void tableMatchesChained();
+  void predicate_data();
+  void predicate();
+};
+
+void
+TestCharClass::tableMatchesChained_data()
+{
+  QTest::addColumn<int>("index");
+
+  for (auto i = 0; i < int(std::size(PREDICATES)); i++) {
+    QTest::newRow(PREDICATES[i].name) << i;
+  }
+}
+
+void
+TestCharClass::tableMatchesChained()
+{
+  QFETCH(int, index);
+
+  auto& predicates = PREDICATES[index];
+  for (auto u = 0; u <= 0xFFFF; u++) {
+    auto c = QChar(char16_t(u));
+    if (predicates.table(c) != predicates.chained(c))
+      QFAIL(qPrintable(QStringLiteral("differs at U+%1")
+                         .arg(u, 4, 16, QLatin1Char('0'))));
+  }
+}
+
+void
+TestCharClass::predicate_data()
+{
+  QTest::addColumn<int>("index");
+  QTest::addColumn<bool>("useTable");
+
+  for (auto i = 0; i < int(std::size(PREDICATES)); i++) {
+    QTest::addRow("%s table", PREDICATES[i].name) << i << true;
+    QTest::addRow("%s chained", PREDICATES[i].name) << i << false;
+  }
+}
+
+void
+TestCharClass::predicate()
+{
+  QFETCH(int, index);
+  QFETCH(bool, useTable);
+
+  // with a few non-ASCII characters for the slow path.
+  auto text =
+    manifestText(100) + QStringLiteral("# caf\u00E9\u00A0\u2028\n");
+  auto& predicates = PREDICATES[index];
+  auto predicate = (useTable ? predicates.table : predicates.chained);
+  auto matches = 0;
+  QBENCHMARK
+  {
+    matches = 0;
+    for (auto c : text) {
+      if (predicate(c))
+        matches++;
+    }
+  }
+
+  auto other = (useTable ? predicates.chained : predicates.table);
+  QCOMPARE(matches, int(std::count_if(text.cbegin(), text.cend(), other)));
+}
+
+QTEST_GUILESS_MAIN(TestCharClass)
+#include "tst_charclass.moc"
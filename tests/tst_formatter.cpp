@@ -0,0 +1,117 @@
+#include <QTest>
+#include <QTextBlock>
+#include <QTextDocument>
+
+#include "qyaml/qyamlparser.h"
+#include "qyaml/yamlformatter.h"
+
+//! Checks that formatting the whole text, as the highlighter's worker
+//! does, gives the ranges that formatting each block on its own gives.
+class TestFormatter : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void workerMatchesBlocks_data();
+  void workerMatchesBlocks();
+  void canceledHasNoBlocks();
+};
+
+namespace {
+
+QList<QTextCharFormat>
+testFormats()
+{
+  QList<QTextCharFormat> formats;
+  for (auto i = 0;
+       i < YamlFormatter::FormatKindCount * YamlFormatter::MarkingCount;
+       i++) {
+    QTextCharFormat format;
+    format.setForeground(QColor::fromRgb(i * 8, 0, 0));
+    formats.append(format);
+  }
+  return formats;
+}
+
+QList<QPair<int, int>>
+textBlocks(const QTextDocument& document)
+{
+  QList<QPair<int, int>> blocks;
+  for (auto block = document.begin(); block.isValid(); block = block.next()) {
+    blocks.append({ block.position(), block.length() - 1 });
+  }
+  return blocks;
+}
+
+} // namespace
+
+void
+TestFormatter::workerMatchesBlocks_data()
+{
+  QTest::addColumn<QString>("text");
+
+  QTest::newRow("lines") << QStringLiteral("%YAML 1.2\n---\na: 1\n"
+                                           "b: [ 1, 2 ]\n# comment\n...\n"
+                                           "---\n- c\n- { d: 4 }\n");
+  // a paragraph separator starts a new QTextDocument block but not a new
+  // line of the parse.
+  QTest::newRow("paragraph separator")
+    << QStringLiteral("---\na: 1\n# one\u2029two\nb: 2\n");
+  QTest::newRow("line separator")
+    << QStringLiteral("---\na: 1\n# one\u2028two\nb: 2\n");
+}
+
+void
+TestFormatter::workerMatchesBlocks()
+{
+  QFETCH(QString, text);
+
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(text);
+  auto documents = parser.documents();
+  for (auto& doc : documents) {
+    doc->nodeTable();
+  }
+
+  QTextDocument document;
+  document.setPlainText(text);
+  auto blocks = textBlocks(document);
+
+  YamlFormatter worker(testFormats());
+  auto result = worker.formatText(documents, blocks, 7);
+  QCOMPARE(result.revision, 7);
+  QCOMPARE(result.blocks.size(), document.blockCount());
+
+  YamlFormatter formatter(testFormats());
+  for (auto i = 0; i < blocks.size(); i++) {
+    auto& [position, length] = blocks.at(i);
+    QCOMPARE(result.blocks.at(i),
+             formatter.formatBlock(documents, position, length));
+  }
+}
+
+void
+TestFormatter::canceledHasNoBlocks()
+{
+  auto text = QStringLiteral("---\na: 1\nb: 2\n");
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(text);
+  QTextDocument document;
+  document.setPlainText(text);
+
+  QPromise<YamlBlockFormats> promise;
+  promise.start();
+  promise.future().cancel();
+  YamlFormatter formatter(testFormats());
+  auto result = formatter.formatText(
+    parser.documents(), textBlocks(document), 3, &promise);
+  QCOMPARE(result.revision, 3);
+  QVERIFY(result.blocks.isEmpty());
+}
+
+// QTextDocument needs a QGuiApplication, the test runs on the offscreen
+// platform.
+QTEST_MAIN(TestFormatter)
+#include "tst_formatter.moc"
@@ -0,0 +1,58 @@
+#include <QTemporaryFile>
+#include <QTest>
+
+#include "documentcompare.h"
+#include "qyaml/qyamlbuilder.h"
+#include "qyaml/qyamlparser.h"
+
+//! Checks that loading a memory mapped file gives the same documents as
+//! parsing the text read from it.
+class TestMappedLoad : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void mappedMatchesText_data();
+  void mappedMatchesText();
+};
+
+void
+TestMappedLoad::mappedMatchesText_data()
+{
+  QTest::addColumn<int>("backend");
+  QTest::addColumn<QString>("text");
+
+  // the non ASCII characters make the UTF-8 and UTF-16 offsets differ.
+  auto text = QStringLiteral("%YAML 1.2\n---\n# café \U0001F600\n"
+                             "name: über\nitems:\n  - a\n  - \"b\"\n"
+                             "...\n# second\n---\nkey: value\n");
+  QTest::newRow("native") << int(QYamlParser::NativeBackend) << text;
+  if (QYamlBuilder::isAvailable())
+    QTest::newRow("libfyaml") << int(QYamlParser::FYamlBackend) << text;
+}
+
+void
+TestMappedLoad::mappedMatchesText()
+{
+  QFETCH(int, backend);
+  QFETCH(QString, text);
+
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  file.write(text.toUtf8());
+  file.close();
+
+  QYamlParser mapped;
+  mapped.setBackend(QYamlParser::Backend(backend));
+  QVERIFY(mapped.loadFile(file.fileName()));
+
+  QYamlParser serial;
+  serial.setBackend(QYamlParser::Backend(backend));
+  serial.parse(text);
+
+  compareDocuments(mapped.documents(), serial.documents());
+  QCOMPARE(mapped.text(), text);
+}
+
+QTEST_GUILESS_MAIN(TestMappedLoad)
+#include "tst_mappedload.moc"
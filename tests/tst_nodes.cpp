@@ -0,0 +1,93 @@
+#include <QTest>
+
+#include "allocationcounter.h"
+#include "qyaml/qyamlparser.h"
+#include "qyaml/yamlarena.h"
+#include "qyaml/yamlnode.h"
+#include "qyaml/yamlnodeobject.h"
+
+namespace {
+
+//! Returns the bytes allocated to make a T on the heap, without an arena.
+template<typename T>
+qint64
+heapBytes()
+{
+  AllocationCounter counter;
+  auto node = YamlArena::create<T>(nullptr);
+  return counter.bytes();
+}
+
+} // namespace
+
+//! Measures the memory a node takes now that it is a plain class rather
+//! than a QObject, and checks the QObject wrapper that replaces it.
+class TestNodes : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void nodeMemory_data();
+  void nodeMemory();
+  void objectKeepsNode();
+};
+
+void
+TestNodes::nodeMemory_data()
+{
+  QTest::addColumn<qint64>("bytes");
+
+  // A QObject with no children, properties or connections, which every
+  // node used to carry on top of its own members.
+  AllocationCounter counter;
+  auto object = new QObject;
+  QTest::newRow("QObject") << counter.bytes();
+  delete object;
+
+  QTest::newRow("YamlScalar") << heapBytes<YamlScalar>();
+  QTest::newRow("YamlMap") << heapBytes<YamlMap>();
+  QTest::newRow("YamlMapItem") << heapBytes<YamlMapItem>();
+  QTest::newRow("YamlSequence") << heapBytes<YamlSequence>();
+  QTest::newRow("YamlComment") << heapBytes<YamlComment>();
+}
+
+void
+TestNodes::nodeMemory()
+{
+  QFETCH(qint64, bytes);
+
+  if (!AllocationCounter::isAvailable())
+    QSKIP("allocations can only be counted with glibc");
+  QVERIFY(bytes > 0);
+  QTest::setBenchmarkResult(qreal(bytes), QTest::BytesAllocated);
+}
+
+void
+TestNodes::objectKeepsNode()
+{
+  QList<QSharedPointer<YamlNodeObject>> objects;
+  QList<bool> errors;
+  {
+    QYamlParser parser;
+    parser.setThreaded(false);
+    // the second directive is an error.
+    parser.parse(QStringLiteral("%YAML 1.2\n%YAML 1.2\n---\n# comment\n"));
+    auto& table = parser.document(0)->nodeTable();
+    for (auto row = 0; row < table.size(); row++) {
+      auto node = table.node(row);
+      objects.append(QSharedPointer<YamlNodeObject>::create(node));
+      errors.append(node->hasErrors());
+    }
+  }
+  QVERIFY(errors.contains(true));
+
+  // the parser and its documents are gone, the objects hold the arena of
+  // their nodes.
+  for (auto i = 0; i < objects.size(); i++) {
+    QCOMPARE(objects.at(i)->hasErrors(), errors.at(i));
+    QVERIFY(objects.at(i)->startPos() >= 0);
+  }
+}
+
+QTEST_GUILESS_MAIN(TestNodes)
+#include "tst_nodes.moc"
@@ -0,0 +1,191 @@
+#include <QTest>
+
+#include <algorithm>
+
+#include "qyaml/qyamlbuilder.h"
+#include "qyaml/qyamlparser.h"
+
+namespace {
+
+//! Returns the rows of table that contain position, or that overlap from
+//! to to inclusive, found by checking every row.
+QList<int>
+scanRows(const YamlNodeTable& table, int from, int to)
+{
+  QList<int> rows;
+  for (auto row = 0; row < table.size(); row++) {
+    auto start = table.startPos(row);
+    if (start < 0)
+      continue;
+    if ((start >= from && start <= to) ||
+        (start < from && table.endPos(row) > from)) {
+      rows.append(row);
+    }
+  }
+  return rows;
+}
+
+//! Returns the innermost row containing position by checking every row,
+//! or NoIndex if none does.
+int
+scanRowAt(const YamlNodeTable& table, int position)
+{
+  auto best = int(YamlNodeTable::NoIndex);
+  for (auto row = 0; row < table.size(); row++) {
+    auto start = table.startPos(row);
+    if (start < 0 || position < start || position >= table.endPos(row))
+      continue;
+    if (best == YamlNodeTable::NoIndex || start > table.startPos(best) ||
+        (start == table.startPos(best) &&
+         table.length(row) <= table.length(best))) {
+      best = row;
+    }
+  }
+  return best;
+}
+
+//! Returns the innermost node of any of documents containing position by
+//! checking every row of every document, or nullptr if none does.
+SharedNode
+scanNodeAt(const QList<SharedDocument>& documents, int position)
+{
+  SharedNode best;
+  auto bestStart = 0, bestLength = 0;
+  for (auto& doc : documents) {
+    auto& table = doc->nodeTable();
+    auto row = scanRowAt(table, position);
+    if (row == YamlNodeTable::NoIndex)
+      continue;
+    auto start = table.startPos(row);
+    auto length = table.length(row);
+    if (!best || start > bestStart ||
+        (start == bestStart && length <= bestLength)) {
+      best = table.node(row);
+      bestStart = start;
+      bestLength = length;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+//! Checks the position index of YamlNodeTable, and QYamlParser::nodeAt()
+//! which finds the document before using it, against a scan of every row,
+//! the way nodes were found before the index.
+class TestNodeTable : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void lookupMatchesScan_data();
+  void lookupMatchesScan();
+  void nodeAtMatchesScan_data();
+  void nodeAtMatchesScan();
+};
+
+void
+TestNodeTable::lookupMatchesScan_data()
+{
+  QTest::addColumn<int>("backend");
+  QTest::addColumn<QString>("text");
+
+  auto text = QStringLiteral(
+    "%YAML 1.2\n%TAG !e! tag:e,2000:\n---\n# first\nname: value\n"
+    "items:\n  - a\n  - { b: 1, c: [2, 3] }\n...\n# between\n---\n"
+    "# second\nkey: &anchor value\nother: *anchor\n");
+  QTest::newRow("native") << int(QYamlParser::NativeBackend) << text;
+  if (QYamlBuilder::isAvailable())
+    QTest::newRow("libfyaml") << int(QYamlParser::FYamlBackend) << text;
+}
+
+void
+TestNodeTable::lookupMatchesScan()
+{
+  QFETCH(int, backend);
+  QFETCH(QString, text);
+
+  QYamlParser parser;
+  parser.setBackend(QYamlParser::Backend(backend));
+  parser.parse(text);
+
+  for (auto& doc : parser.documents()) {
+    auto& table = doc->nodeTable();
+    QVERIFY(!table.isEmpty());
+
+    for (auto position = -1; position <= text.length(); position++) {
+      auto row = table.rowAt(position);
+      auto expected = scanRowAt(table, position);
+      QCOMPARE(row == YamlNodeTable::NoIndex,
+               expected == YamlNodeTable::NoIndex);
+      if (row != YamlNodeTable::NoIndex) {
+        // rows with the same span are equally innermost.
+        QCOMPARE(table.startPos(row), table.startPos(expected));
+        QCOMPARE(table.length(row), table.length(expected));
+      }
+    }
+
+    for (auto from = 0; from <= text.length(); from++) {
+      for (auto length : { 0, 1, 5, 20 }) {
+        auto rows = table.rowsInRange(from, from + length);
+        std::sort(rows.begin(), rows.end());
+        QCOMPARE(rows, scanRows(table, from, from + length));
+      }
+    }
+  }
+}
+
+void
+TestNodeTable::nodeAtMatchesScan_data()
+{
+  QTest::addColumn<int>("backend");
+  QTest::addColumn<QString>("text");
+
+  QList<QPair<const char*, QString>> texts = {
+    { "explicit ends",
+      QStringLiteral(
+        "%YAML 1.2\n---\n# first\nname: value\n...\n# between\n---\n"
+        "# second\nkey: &anchor value\n...\n---\nother: *anchor\n") },
+    { "implicit ends",
+      QStringLiteral("a: 1\n---\nb: 2\n# c\n---\n# d\n--- # e\nf: 3")
+    },
+    { "markers only",
+      QStringLiteral("---\n...\n---\n...\n%YAML 1.2\n---\n...\n") },
+  };
+  for (auto& [name, text] : texts) {
+    QTest::newRow(qPrintable(QStringLiteral("native %1").arg(name)))
+      << int(QYamlParser::NativeBackend) << text;
+    if (QYamlBuilder::isAvailable()) {
+      QTest::newRow(qPrintable(QStringLiteral("libfyaml %1").arg(name)))
+        << int(QYamlParser::FYamlBackend) << text;
+    }
+  }
+}
+
+void
+TestNodeTable::nodeAtMatchesScan()
+{
+  QFETCH(int, backend);
+  QFETCH(QString, text);
+
+  QYamlParser parser;
+  parser.setBackend(QYamlParser::Backend(backend));
+  parser.parse(text);
+  QVERIFY(parser.documents().size() > 1);
+
+  // every position, including those on the markers and line feeds
+  // between documents and those outside the text.
+  for (auto position = -1; position <= text.length() + 1; position++) {
+    auto node = parser.nodeAt(position);
+    auto expected = scanNodeAt(parser.documents(), position);
+    QCOMPARE(bool(node), bool(expected));
+    if (node) {
+      // nodes with the same span are equally innermost.
+      QCOMPARE(node->startPos(), expected->startPos());
+      QCOMPARE(node->endPos(), expected->endPos());
+    }
+  }
+}
+
+QTEST_GUILESS_MAIN(TestNodeTable)
+#include "tst_nodetable.moc"
@@ -0,0 +1,53 @@
+#include <QTest>
+
+#include "qyaml/qyamlbuilder.h"
+#include "qyaml/qyamlparser.h"
+#include "sampletext.h"
+
+//! Measures how the parse time grows with the size of the text. Nodes
+//! are placed in constant time, so four times the text should take about
+//! four times as long. The native parser is compared with the libfyaml
+//! event stream backend on the same text.
+class TestParse : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void parse_data();
+  void parse();
+};
+
+void
+TestParse::parse_data()
+{
+  QTest::addColumn<int>("backend");
+  QTest::addColumn<int>("documents");
+
+  for (auto documents : { 1000, 4000, 16000 }) {
+    QTest::addRow("native %d", documents)
+      << int(QYamlParser::NativeBackend) << documents;
+    if (QYamlBuilder::isAvailable())
+      QTest::addRow("libfyaml %d", documents)
+        << int(QYamlParser::FYamlBackend) << documents;
+  }
+}
+
+void
+TestParse::parse()
+{
+  QFETCH(int, backend);
+  QFETCH(int, documents);
+
+  auto text = manifestText(documents);
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.setBackend(QYamlParser::Backend(backend));
+  QBENCHMARK
+  {
+    parser.parse(text);
+  }
+  QCOMPARE(parser.documents().size(), documents);
+}
+
+QTEST_GUILESS_MAIN(TestParse)
+#include "tst_parse.moc"
@@ -0,0 +1,91 @@
+#include <QTest>
+
+#include "allocationcounter.h"
+#include "qyaml/qyamlparser.h"
+
+namespace {
+
+//! Returns count lines made from pattern, each with its %1 replaced by
+//! padding characters.
+QString
+linesOf(const QString& pattern, int padding, int count = 50)
+{
+  auto line = pattern.arg(QString(padding, u'x'));
+  QString text;
+  for (auto i = 0; i < count; i++) {
+    text += line;
+  }
+  return text;
+}
+
+//! Returns the number of allocations made parsing text.
+qint64
+parseAllocations(const QString& text)
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  AllocationCounter counter;
+  parser.parse(text);
+  return counter.count();
+}
+
+} // namespace
+
+//! Checks that the productions of the native parser read the text through
+//! views, with no allocation per line or per character. A fixed input is
+//! parsed with short and long lines, only the number of lines may change
+//! the number of allocations.
+class TestProductions : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void allocationsDoNotGrow_data();
+  void allocationsDoNotGrow();
+};
+
+void
+TestProductions::initTestCase()
+{
+  if (!AllocationCounter::isAvailable())
+    QSKIP("allocations can only be counted with glibc");
+  // anything made once for the whole program is made here.
+  parseAllocations(
+    QStringLiteral("%YAML 1.2\n%TAG !e! tag:e,2000: # c\n%FOO a b\n"
+                   "---\n# comment\n... # end\n"));
+}
+
+void
+TestProductions::allocationsDoNotGrow_data()
+{
+  QTest::addColumn<QString>("pattern");
+
+  QTest::newRow("comment") << QStringLiteral("# comment %1\n");
+  QTest::newRow("indented comment") << QStringLiteral("    # %1\n");
+  QTest::newRow("yaml directive")
+    << QStringLiteral("%YAML 1.2 # %1\n---\n");
+  QTest::newRow("tag handle")
+    << QStringLiteral("%TAG !%1! tag:e,2000: # c\n---\n");
+  QTest::newRow("tag prefix")
+    << QStringLiteral("%TAG !e! tag:%1,2000: # c\n---\n");
+  QTest::newRow("reserved directive")
+    << QStringLiteral("%FOO %1 b%1 # c\n---\n");
+  QTest::newRow("document end") << QStringLiteral("---\n... # %1\n");
+  QTest::newRow("content") << QStringLiteral("key: value %1\n");
+}
+
+void
+TestProductions::allocationsDoNotGrow()
+{
+  QFETCH(QString, pattern);
+
+  auto shortLines = parseAllocations(linesOf(pattern, 1));
+  auto longLines = parseAllocations(linesOf(pattern, 2000));
+  qInfo("%lld allocations for 50 lines", longLines);
+  QVERIFY(shortLines > 0);
+  QCOMPARE(longLines, shortLines);
+}
+
+QTEST_GUILESS_MAIN(TestProductions)
+#include "tst_productions.moc"
@@ -0,0 +1,61 @@
+#include <QTest>
+
+#include "documentcompare.h"
+#include "qyaml/qyamlparser.h"
+
+//! Checks that feeding text to the parser in chunks gives the same
+//! documents as parsing the whole text at once.
+class TestPushParser : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void feedMatchesParse_data();
+  void feedMatchesParse();
+};
+
+void
+TestPushParser::feedMatchesParse_data()
+{
+  QTest::addColumn<int>("chunkSize");
+
+  for (auto size : { 1, 2, 3, 7, 16, 64, 4096 }) {
+    QTest::newRow(qPrintable(QStringLiteral("chunks of %1").arg(size)))
+      << size;
+  }
+}
+
+void
+TestPushParser::feedMatchesParse()
+{
+  QFETCH(int, chunkSize);
+
+  // multi byte characters can be split between chunks.
+  auto text = QStringLiteral("%YAML 1.2\n---\n# für \U0001F600\na: 1\n...\n"
+                             "# between\n--- # second\nb: 2\n---\n"
+                             "# third ünïcödé\n%TAG ! tag:a,2000:\n---\n"
+                             "c: 3\n... # end\n# last has no line feed");
+  auto utf8 = text.toUtf8();
+
+  QYamlParser pushed;
+  QList<SharedDocument> documents;
+  connect(&pushed,
+          &QYamlParser::documentParsed,
+          this,
+          [&documents](SharedDocument document) {
+            documents.append(document);
+          });
+  for (qsizetype i = 0; i < utf8.size(); i += chunkSize) {
+    pushed.feed(QByteArrayView(utf8).mid(i, chunkSize));
+  }
+  pushed.finish();
+
+  QYamlParser serial;
+  serial.setThreaded(false);
+  serial.parse(text);
+
+  compareDocuments(documents, serial.documents());
+}
+
+QTEST_GUILESS_MAIN(TestPushParser)
+#include "tst_pushparser.moc"
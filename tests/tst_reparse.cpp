@@ -0,0 +1,71 @@
+#include <QTest>
+
+#include "qyaml/qyamlparser.h"
+#include "sampletext.h"
+
+//! Measures what an edit costs now that nodes hold plain offsets rather
+//! than QTextCursors that the text has to move on every keystroke.
+class TestReparse : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void typing_data();
+  void typing();
+  void nodeMemory();
+};
+
+void
+TestReparse::typing_data()
+{
+  QTest::addColumn<int>("documents");
+
+  QTest::newRow("100 documents") << 100;
+  QTest::newRow("1000 documents") << 1000;
+  QTest::newRow("10000 documents") << 10000;
+}
+
+void
+TestReparse::typing()
+{
+  QFETCH(int, documents);
+
+  auto text = manifestText(documents);
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(text);
+
+  // a key half way through the text, so the documents after it move.
+  auto position = int(
+    text.indexOf(QStringLiteral("name: service-%1").arg(documents / 2)));
+  QVERIFY(position > 0);
+  QBENCHMARK
+  {
+    parser.reparse(position, 0, QStringLiteral("x"));
+    parser.reparse(position, 1, QStringView());
+  }
+  QCOMPARE(parser.text(), text);
+}
+
+void
+TestReparse::nodeMemory()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(manifestText(1000));
+
+  qsizetype nodes = 0;
+  qsizetype bytes = 0;
+  for (auto& doc : parser.documents()) {
+    nodes += doc->nodeTable().size();
+    bytes += doc->arena()->bytesAllocated();
+  }
+  QVERIFY(nodes > 0);
+  // the bytes of each node, its offsets included, no cursor is held
+  // outside of it.
+  QTest::setBenchmarkResult(qreal(bytes) / qreal(nodes),
+                            QTest::BytesAllocated);
+}
+
+QTEST_GUILESS_MAIN(TestReparse)
+#include "tst_reparse.moc"
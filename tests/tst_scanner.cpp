@@ -0,0 +1,145 @@
+#include <QTest>
+
+#include "qyaml/yamlscanner.h"
+#include "sampletext.h"
+
+//! Checks that each vector kernel finds the same structural characters as
+//! the scalar scan, including the tails too short to fill a vector and
+//! indents that run from one vector into the next, and measures the
+//! throughput of every kernel on a large text.
+class TestScanner : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void kernelsMatchScalar_data();
+  void kernelsMatchScalar();
+  void structure();
+  void lines();
+  void throughput_data();
+  void throughput();
+};
+
+void
+TestScanner::kernelsMatchScalar_data()
+{
+  QTest::addColumn<QString>("text");
+
+  QTest::newRow("empty") << QString();
+  QTest::newRow("one line feed") << QStringLiteral("\n");
+
+  // every length up to past two AVX2 vectors, so every length of tail
+  // after the vectors is covered, with the line feeds falling on the
+  // first, last and middle characters of the vectors.
+  for (auto length = 1; length <= 70; length++) {
+    QString text;
+    for (auto i = 0; i < length; i++) {
+      auto c = u'a';
+      if (i % 16 == 0 || i % 16 == 15 || i % 5 == 2)
+        c = u'\n';
+      else if (i % 7 == 3)
+        c = u':';
+      else if (i % 4 != 3)
+        c = u' ';
+      text += QChar(c);
+    }
+    QTest::newRow(qPrintable(QStringLiteral("length %1").arg(length)))
+      << text;
+  }
+
+  // indents of every length, so that they end on every character of a
+  // vector or run on past it.
+  QString indents;
+  for (auto i = 0; i < 70; i++) {
+    indents += QString(i, u' ');
+    indents += QStringLiteral("- {a: \"b\", 'c': [d]} # e\n");
+  }
+  QTest::newRow("indents") << indents;
+
+  // characters that only match in one of their bytes.
+  QString wide;
+  for (auto i = 0; i < 67; i++) {
+    wide += (i % 3 == 0 ? QChar(0x0A0A)
+                        : (i % 3 == 1 ? QChar(0xFF20) : QChar(0x233A)));
+  }
+  QTest::newRow("wide characters") << wide;
+  QTest::newRow("only line feeds") << QString(97, u'\n');
+  QTest::newRow("only spaces") << QString(97, u' ');
+  QTest::newRow("only indicators")
+    << QStringLiteral("#:-'\"[]{},").repeated(9);
+}
+
+void
+TestScanner::kernelsMatchScalar()
+{
+  QFETCH(QString, text);
+
+  auto scalar = YamlScanner::scan(text, YamlScanner::Scalar);
+  for (auto kernel : { YamlScanner::Sse2, YamlScanner::Avx2 }) {
+    if (!YamlScanner::isSupported(kernel))
+      continue;
+    auto structure = YamlScanner::scan(text, kernel);
+    QCOMPARE(structure.newlines, scalar.newlines);
+    QCOMPARE(structure.indents, scalar.indents);
+    QCOMPARE(structure.indicators, scalar.indicators);
+  }
+}
+
+void
+TestScanner::structure()
+{
+  auto text = QStringLiteral("a: [b]\n  - 'c'\n\n   \n\t# d\n");
+  auto structure = YamlScanner::scan(text, YamlScanner::Scalar);
+  QCOMPARE(structure.newlines, QList<int>({ 6, 14, 15, 19, 24 }));
+  // the blank lines have no indent end, a tab is not part of the indent.
+  QCOMPARE(structure.indents, QList<int>({ 0, 9, 20 }));
+  QCOMPARE(structure.indicators, QList<int>({ 1, 3, 5, 9, 11, 13, 21 }));
+}
+
+void
+TestScanner::lines()
+{
+  auto text = QStringLiteral("a\nbb\n\n  ccc\nd");
+  auto structure = YamlScanner::scan(text);
+  QCOMPARE(structure.newlines, QList<int>({ 1, 4, 5, 11 }));
+
+  // the lines of "bb\n\n  ccc", the line feed that ends it is not
+  // included.
+  YamlLines lines(structure, 2, 11);
+  QCOMPARE(lines.size(), qsizetype(2));
+  QCOMPARE(lines.at(0), 2);
+  QCOMPARE(lines.at(1), 3);
+  QCOMPARE(lines.indentCount(), qsizetype(2));
+  QCOMPARE(lines.indentAt(0), 0);
+  QCOMPARE(lines.indentAt(1), 6);
+}
+
+void
+TestScanner::throughput_data()
+{
+  QTest::addColumn<int>("kernel");
+
+  QTest::newRow("avx2") << int(YamlScanner::Avx2);
+  QTest::newRow("sse2") << int(YamlScanner::Sse2);
+  QTest::newRow("scalar") << int(YamlScanner::Scalar);
+}
+
+void
+TestScanner::throughput()
+{
+  QFETCH(int, kernel);
+  if (!YamlScanner::isSupported(YamlScanner::Kernel(kernel)))
+    QSKIP("The kernel is not supported on this machine.");
+
+  // about 2 MB of text.
+  auto text = manifestText(10000);
+  YamlStructure structure;
+  QBENCHMARK
+  {
+    structure = YamlScanner::scan(text, YamlScanner::Kernel(kernel));
+  }
+  QCOMPARE(structure.newlines.size(), text.count(u'\n'));
+}
+
+QTEST_GUILESS_MAIN(TestScanner)
+#include "tst_scanner.moc"
@@ -0,0 +1,178 @@
+#include <QBuffer>
+#include <QTest>
+
+#include <cstring>
+#include <limits>
+
+#include "documentcompare.h"
+#include "qyaml/qyamlparser.h"
+#include "qyaml/qyamlstreamreader.h"
+
+namespace {
+
+//! A sequential device that generates count copies of text, so that a
+//! stream longer than memory could hold is read without storing it.
+class RepeatDevice : public QIODevice
+{
+public:
+  RepeatDevice(const QByteArray& text, qint64 count)
+    : m_text(text)
+    , m_size(text.size() * count)
+  {
+  }
+
+  bool isSequential() const override { return true; }
+  qint64 bytesAvailable() const override
+  {
+    return m_size - m_offset + QIODevice::bytesAvailable();
+  }
+
+protected:
+  qint64 readData(char* data, qint64 maxSize) override
+  {
+    auto length = qMin(maxSize, m_size - m_offset);
+    for (qint64 done = 0; done < length;) {
+      auto from = m_offset % m_text.size();
+      auto count = qMin(length - done, m_text.size() - from);
+      std::memcpy(data + done, m_text.constData() + from, count);
+      done += count;
+      m_offset += count;
+    }
+    return length;
+  }
+  qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+  QByteArray m_text;
+  qint64 m_size;
+  qint64 m_offset = 0;
+};
+
+} // namespace
+
+//! Checks that reading documents from a device gives the same documents as
+//! parsing the whole text, with each document positioned by its base.
+class TestStreamReader : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void readMatchesParse_data();
+  void readMatchesParse();
+  void documentsAreReleased();
+  void longStream();
+};
+
+void
+TestStreamReader::readMatchesParse_data()
+{
+  QTest::addColumn<QString>("text");
+
+  QTest::newRow("one document") << QStringLiteral("a: 1\nb: 2\n");
+  QTest::newRow("markers") << QStringLiteral(
+    "%YAML 1.2\n---\n# für \U0001F600\na: 1\n...\n# between\n--- # second\n"
+    "b: 2\n---\n# third\n%TAG ! tag:a,2000:\n---\nc: 3\n... # end\n");
+
+  // enough text for several chunks of the reader.
+  QString many;
+  for (auto i = 0; i < 20000; i++) {
+    many += QStringLiteral("---\n# document %1\nkey: value\n").arg(i);
+  }
+  QTest::newRow("many documents") << many;
+}
+
+void
+TestStreamReader::readMatchesParse()
+{
+  QFETCH(QString, text);
+
+  auto utf8 = text.toUtf8();
+  QBuffer buffer(&utf8);
+  QYamlStreamReader reader(&buffer);
+  QList<SharedDocument> documents;
+  qsizetype lastBase = -1;
+  for (auto document : reader) {
+    // positions are relative to the document, the base places it.
+    QVERIFY(document->startPos() <= 0);
+    QVERIFY(document->base() > lastBase);
+    lastBase = document->base();
+    documents.append(document);
+  }
+  QVERIFY(reader.atEnd());
+
+  QYamlParser serial;
+  serial.setThreaded(false);
+  serial.parse(text);
+
+  compareDocuments(documents, serial.documents());
+}
+
+void
+TestStreamReader::documentsAreReleased()
+{
+  QByteArray utf8;
+  for (auto i = 0; i < 100; i++) {
+    utf8 += "---\nkey: value\n";
+  }
+  QBuffer buffer(&utf8);
+  QYamlStreamReader reader(&buffer);
+
+  QList<QWeakPointer<QYamlDocument>> seen;
+  for (auto document : reader) {
+    seen.append(document);
+  }
+  QCOMPARE(seen.size(), 100);
+  for (auto& document : seen) {
+    QVERIFY(document.isNull());
+  }
+}
+
+void
+TestStreamReader::longStream()
+{
+  if (!qEnvironmentVariableIsSet("QYAML_TEST_LONG_STREAM"))
+    QSKIP("Set QYAML_TEST_LONG_STREAM to read more than 2^31 characters.");
+
+  // 512 characters a document, so every chunk the reader reads holds the
+  // same documents and what it holds repeats exactly.
+  QByteArray document = "---\n";
+  for (auto i = 0; document.size() < 480; i++) {
+    document += "key-" + QByteArray::number(i) + ": value\n";
+  }
+  document += "# " + QByteArray(512 - document.size() - 3, 'x') + "\n";
+  QCOMPARE(document.size(), qsizetype(512));
+
+  const qint64 count = (qint64(1) << 31) / document.size() + 1024;
+  RepeatDevice device(document, count);
+  QVERIFY(device.open(QIODevice::ReadOnly));
+  QYamlStreamReader reader(&device);
+
+  // The first chunks fill the reader, after them neither the documents
+  // it holds nor its buffer may grow with the length of the stream.
+  const qint64 warmUp = 64 * 128;
+  QList<QWeakPointer<QYamlDocument>> held;
+  qsizetype peakLive = 0, peakPending = 0;
+  qsizetype warmLive = 0, warmPending = 0;
+  qsizetype lastBase = -1;
+  qint64 read = 0;
+  for (auto document : reader) {
+    held.removeIf([](const auto& weak) { return weak.isNull(); });
+    held.append(document);
+    peakLive = qMax(peakLive, held.size() + reader.readyCount());
+    peakPending = qMax(peakPending, reader.pendingSize());
+    QVERIFY(document->base() > lastBase);
+    lastBase = document->base();
+    if (++read == warmUp) {
+      warmLive = peakLive;
+      warmPending = peakPending;
+    }
+  }
+
+  QCOMPARE(read, count);
+  QVERIFY(lastBase > std::numeric_limits<int>::max());
+  QCOMPARE(peakLive, warmLive);
+  QCOMPARE(peakPending, warmPending);
+}
+
+QTEST_GUILESS_MAIN(TestStreamReader)
+#include "tst_streamreader.moc"
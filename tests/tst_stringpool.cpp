@@ -0,0 +1,230 @@
+#include <QBuffer>
+#include <QSet>
+#include <QTest>
+
+#include <iterator>
+
+#include "qyaml/qyamlbuilder.h"
+#include "qyaml/qyamlparser.h"
+#include "qyaml/qyamlstreamreader.h"
+#include "sampletext.h"
+
+namespace {
+
+//! Returns the bytes of string data held by strings, counting data that
+//! several of them share once.
+qint64
+heldBytes(const QList<QString>& strings)
+{
+  QSet<const QChar*> seen;
+  qint64 bytes = 0;
+  for (auto& string : strings) {
+    if (!seen.contains(string.constData())) {
+      seen.insert(string.constData());
+      bytes += (string.capacity() + 1) * qint64(sizeof(QChar));
+    }
+  }
+  return bytes;
+}
+
+} // namespace
+
+//! Checks that the string pool of a parser lasts only as long as the
+//! parse, or the streamed document, that filled it, and measures the
+//! memory it saves on keys that repeat.
+class TestStringPool : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void newPoolPerParse();
+  void sharedPoolIsKept();
+  void reparseUsesDocumentPool();
+  void reparseKeepsParserPool();
+  void newPoolPerStreamedDocument();
+  void anchorsShareNameId();
+  void keysShareStorage();
+  void keyMemory_data();
+  void keyMemory();
+};
+
+void
+TestStringPool::newPoolPerParse()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(QStringLiteral("%TAG !a! tag:a,2000:\n---\n"));
+  auto first = parser.stringPool();
+  QCOMPARE(first->size(), 1);
+
+  parser.parse(QStringLiteral("%TAG !b! tag:b,2000:\n---\n"));
+  auto second = parser.stringPool();
+  QVERIFY(second != first);
+  // the strings of the first text are not kept.
+  QCOMPARE(second->size(), 1);
+  QCOMPARE(parser.document(0)->stringPool(), second);
+}
+
+void
+TestStringPool::sharedPoolIsKept()
+{
+  auto pool = QSharedPointer<YamlStringPool>::create();
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.setStringPool(pool);
+  parser.parse(QStringLiteral("%TAG !a! tag:a,2000:\n---\n"));
+  parser.parse(QStringLiteral("%TAG !b! tag:b,2000:\n---\n"));
+  QCOMPARE(parser.stringPool(), pool);
+  QCOMPARE(pool->size(), 2);
+}
+
+void
+TestStringPool::reparseUsesDocumentPool()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  auto text = QStringLiteral("%TAG !a! tag:a,2000:\n---\n# comment\n");
+  parser.parse(text);
+  auto pool = parser.document(0)->stringPool();
+
+  // an edit within the comment line is reparsed into the same document.
+  auto position = int(text.indexOf(QStringLiteral("comment")));
+  parser.reparse(position, 0, QStringLiteral("a "));
+  QCOMPARE(parser.document(0)->stringPool(), pool);
+  QCOMPARE(parser.stringPool(), pool);
+}
+
+void
+TestStringPool::reparseKeepsParserPool()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  auto text = QStringLiteral("%TAG !a! tag:a,2000:\n---\n# comment\n");
+  parser.parse(text);
+  auto documentPool = parser.document(0)->stringPool();
+  auto pool = QSharedPointer<YamlStringPool>::create();
+  parser.setStringPool(pool);
+
+  // the reparse interns into the document's pool, the pool set on the
+  // parser is kept for the next parse.
+  auto position = int(text.indexOf(QStringLiteral("comment")));
+  parser.reparse(position, 0, QStringLiteral("a "));
+  QCOMPARE(parser.document(0)->stringPool(), documentPool);
+  QCOMPARE(parser.stringPool(), pool);
+}
+
+void
+TestStringPool::newPoolPerStreamedDocument()
+{
+  QByteArray utf8;
+  for (auto i = 0; i < 10; i++) {
+    utf8 += QStringLiteral("%TAG !t%1! tag:t%1,2000:\n---\n# document\n")
+              .arg(i)
+              .toUtf8();
+  }
+  QBuffer buffer(&utf8);
+  QYamlStreamReader reader(&buffer);
+
+  QList<QWeakPointer<YamlStringPool>> pools;
+  for (auto document : reader) {
+    auto pool = document->stringPool();
+    QVERIFY(pool);
+    // only the handle of its own document is in the pool.
+    QCOMPARE(pool->size(), 1);
+    for (auto& earlier : pools) {
+      QVERIFY(earlier.toStrongRef() != pool);
+    }
+    pools.append(pool);
+  }
+  QCOMPARE(pools.size(), 10);
+  // neither the reader nor its parser hold the pools of read documents.
+  for (auto& pool : pools) {
+    QVERIFY(pool.isNull());
+  }
+}
+
+void
+TestStringPool::anchorsShareNameId()
+{
+  YamlAnchor anchor;
+  QCOMPARE(anchor.nameId(), int(YamlStringPool::NoId));
+  anchor.setName(QStringLiteral("a"), 3);
+  QCOMPARE(anchor.nameId(), 3);
+
+  // only the libfyaml backend keeps the anchors it reads.
+  if (!QYamlBuilder::isAvailable())
+    QSKIP("libfyaml is not available");
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.setBackend(QYamlParser::FYamlBackend);
+  parser.parse(QStringLiteral("--- &x a\n--- &x b\n--- &y c\n"));
+  QCOMPARE(parser.documents().size(), 3);
+  auto first = parser.document(0)->anchor(QStringLiteral("x"));
+  auto second = parser.document(1)->anchor(QStringLiteral("x"));
+  auto other = parser.document(2)->anchor(QStringLiteral("y"));
+  QVERIFY(first && second && other);
+  QVERIFY(first->nameId() != YamlStringPool::NoId);
+  QCOMPARE(second->nameId(), first->nameId());
+  QVERIFY(other->nameId() != first->nameId());
+}
+
+void
+TestStringPool::keysShareStorage()
+{
+  // only the libfyaml backend builds map items.
+  if (!QYamlBuilder::isAvailable())
+    QSKIP("libfyaml is not available");
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.setBackend(QYamlParser::FYamlBackend);
+  parser.parse(manifestText(100));
+
+  QList<QString> keys;
+  QSet<QString> distinct;
+  for (auto& doc : parser.documents()) {
+    auto& table = doc->nodeTable();
+    for (auto row = 0; row < table.size(); row++) {
+      if (table.type(row) != YamlNode::MapItem)
+        continue;
+      auto key = yamlRefCast<YamlMapItem>(table.node(row))->key();
+      keys.append(key);
+      distinct.insert(key);
+    }
+  }
+  QVERIFY(keys.size() > distinct.size());
+  QSet<const QChar*> data;
+  for (auto& key : keys) {
+    data.insert(key.constData());
+  }
+  // every use of a key shares the one pooled copy.
+  QCOMPARE(data.size(), distinct.size());
+}
+
+void
+TestStringPool::keyMemory_data()
+{
+  QTest::addColumn<bool>("pooled");
+
+  QTest::newRow("pooled") << true;
+  QTest::newRow("copied") << false;
+}
+
+void
+TestStringPool::keyMemory()
+{
+  QFETCH(bool, pooled);
+
+  // the keys of the manifests, each decoded from the text as a parser
+  // does before it is kept.
+  const QByteArray names[] = { "name", "image", "env", "value", "ports" };
+  YamlStringPool pool;
+  QList<QString> keys;
+  for (auto i = 0; i < 100000; i++) {
+    auto key = QString::fromUtf8(names[i % std::size(names)]);
+    keys.append(pooled ? pool.intern(key).text : key);
+  }
+  QTest::setBenchmarkResult(qreal(heldBytes(keys)), QTest::BytesAllocated);
+}
+
+QTEST_GUILESS_MAIN(TestStringPool)
+#include "tst_stringpool.moc"
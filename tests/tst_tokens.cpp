@@ -0,0 +1,114 @@
+#include <QSignalSpy>
+#include <QTest>
+
+#include "qyaml/qyamlparser.h"
+#include "qyaml/yamltokens.h"
+
+using Ranges = QList<QPair<int, int>>;
+
+//! Checks that the tokens of an edited text are only taken again for the
+//! documents that were reparsed, and that the ranges they give still hold
+//! every change.
+class TestTokens : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void reusesUnchangedDocuments();
+  void matchesFullTake_data();
+  void matchesFullTake();
+  void editIsAlwaysChanged();
+};
+
+namespace {
+
+const auto TEXT = QStringLiteral("---\na: 1\n---\nb: 2\n---\nc: 3\n");
+
+} // namespace
+
+void
+TestTokens::reusesUnchangedDocuments()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(TEXT);
+  QCOMPARE(parser.documents().size(), 3);
+  auto previous = YamlTokens::take(parser.documents());
+  QCOMPARE(previous.reusedCount(), 0);
+
+  auto position = int(TEXT.indexOf(u'2'));
+  parser.reparse(position, 1, QStringLiteral("22"));
+  auto edited = parser.documents().at(1);
+  auto tokens =
+    YamlTokens::take(parser.documents(), previous, { edited.data() });
+  QCOMPARE(tokens.reusedCount(), 2);
+
+  // every change is within the edited document.
+  auto ranges = tokens.changedRanges(previous, position, 1, 2);
+  QVERIFY(!ranges.isEmpty());
+  for (auto& [start, length] : ranges) {
+    QVERIFY(start >= edited->startPos());
+    QVERIFY(start + length <= edited->endPos() + 1);
+  }
+}
+
+void
+TestTokens::matchesFullTake_data()
+{
+  QTest::addColumn<int>("position");
+  QTest::addColumn<int>("removed");
+  QTest::addColumn<QString>("added");
+
+  QTest::newRow("longer scalar")
+    << int(TEXT.indexOf(u'2')) << 1 << QStringLiteral("22");
+  QTest::newRow("shorter key")
+    << int(TEXT.indexOf(u'b')) << 1 << QString();
+  QTest::newRow("flow map") << int(TEXT.indexOf(u'3')) << 1
+                            << QStringLiteral("{ d: 4 }");
+  QTest::newRow("first document")
+    << int(TEXT.indexOf(u'1')) << 1 << QStringLiteral("[ 1, 2 ]");
+}
+
+void
+TestTokens::matchesFullTake()
+{
+  QFETCH(int, position);
+  QFETCH(int, removed);
+  QFETCH(QString, added);
+
+  QYamlParser parser;
+  parser.setThreaded(false);
+  parser.parse(TEXT);
+  auto previous = YamlTokens::take(parser.documents());
+
+  parser.reparse(position, removed, added);
+  QSet<const QYamlDocument*> reparsed;
+  for (auto& doc : parser.documents()) {
+    if (position >= doc->startPos() && position <= doc->endPos())
+      reparsed.insert(doc.data());
+  }
+  auto incremental = YamlTokens::take(parser.documents(), previous, reparsed);
+  auto full = YamlTokens::take(parser.documents());
+  auto length = int(added.length());
+  QCOMPARE(incremental.changedRanges(previous, position, removed, length),
+           full.changedRanges(previous, position, removed, length));
+}
+
+void
+TestTokens::editIsAlwaysChanged()
+{
+  QYamlParser parser;
+  parser.setThreaded(false);
+  auto text = QStringLiteral("a: 1\n# comment\n");
+  parser.parse(text);
+
+  // the same tokens before and after, only the edit itself is changed.
+  QSignalSpy spy(&parser, &QYamlParser::tokensChanged);
+  auto position = int(text.indexOf(QStringLiteral("comment")));
+  parser.reparse(position, 1, QStringLiteral("C"));
+  QCOMPARE(spy.size(), 1);
+  QCOMPARE(spy.at(0).at(0).value<Ranges>(), Ranges({ { position, 1 } }));
+}
+
+QTEST_GUILESS_MAIN(TestTokens)
+#include "tst_tokens.moc"
@@ -0,0 +1,167 @@
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <quazip.h>
+#include <quazipfile.h>
+
+#include "documentcompare.h"
+#include "qyaml/qyamlbuilder.h"
+#include "qyaml/qyamlparser.h"
+#include "sampletext.h"
+
+//! Checks that loading the entries of a zip file gives the same documents,
+//! at the same positions, as parsing their text, and measures loading a
+//! bundle of entries at once against loading them one at a time.
+class TestZipLoad : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void zipMatchesText_data();
+  void zipMatchesText();
+  void archiveMatchesText();
+  void loadBundle_data();
+  void loadBundle();
+
+private:
+  QTemporaryDir m_dir;
+  QString m_zipFile;
+  QMap<QString, QString> m_entries;
+  QString m_bundleFile;
+  QStringList m_bundleEntries;
+};
+
+void
+TestZipLoad::initTestCase()
+{
+  QVERIFY(m_dir.isValid());
+  m_entries.insert(QStringLiteral("single.yaml"),
+                   QStringLiteral("---\nname: value\nitems:\n  - a\n"));
+  m_entries.insert(
+    QStringLiteral("multi.yaml"),
+    QStringLiteral("%YAML 1.2\n---\n# café\nfirst: 1\n...\n# between\n"
+                   "---\nsecond: [ 2, 3 ]\n---\nthird: { d: 4 }\n"));
+
+  m_zipFile = m_dir.filePath(QStringLiteral("entries.zip"));
+  QuaZip zip(m_zipFile);
+  QVERIFY(zip.open(QuaZip::mdCreate));
+  for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+    QuaZipFile file(&zip);
+    QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(it.key())));
+    file.write(it.value().toUtf8());
+    file.close();
+  }
+  zip.close();
+
+  // a configuration bundle, many entries of a few documents each.
+  m_bundleFile = m_dir.filePath(QStringLiteral("bundle.zip"));
+  QuaZip bundle(m_bundleFile);
+  QVERIFY(bundle.open(QuaZip::mdCreate));
+  auto text = manifestText(20).toUtf8();
+  for (auto i = 0; i < 200; i++) {
+    auto name = QStringLiteral("config/entry%1.yaml").arg(i);
+    QuaZipFile file(&bundle);
+    QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(name)));
+    file.write(text);
+    file.close();
+    m_bundleEntries.append(name);
+  }
+  bundle.close();
+}
+
+void
+TestZipLoad::zipMatchesText_data()
+{
+  QTest::addColumn<int>("backend");
+  QTest::addColumn<QString>("href");
+
+  for (auto& href : m_entries.keys()) {
+    QTest::addRow("native %s", qPrintable(href))
+      << int(QYamlParser::NativeBackend) << href;
+    if (QYamlBuilder::isAvailable())
+      QTest::addRow("libfyaml %s", qPrintable(href))
+        << int(QYamlParser::FYamlBackend) << href;
+  }
+}
+
+void
+TestZipLoad::zipMatchesText()
+{
+  QFETCH(int, backend);
+  QFETCH(QString, href);
+  auto text = m_entries.value(href);
+
+  QYamlParser zipped;
+  zipped.setBackend(QYamlParser::Backend(backend));
+  QVERIFY(zipped.loadFromZip(m_zipFile, href));
+  QCOMPARE(zipped.text(), text);
+
+  QYamlParser serial;
+  serial.setBackend(QYamlParser::Backend(backend));
+  serial.parse(text);
+
+  compareDocuments(zipped.documents(), serial.documents());
+  // the documents are at their positions in the whole text, as the
+  // lookups by position expect.
+  for (auto i = 0; i < zipped.documents().size(); i++) {
+    auto doc = zipped.documents().at(i);
+    QCOMPARE(doc->base(), qsizetype(0));
+    QCOMPARE(doc->startPos(), serial.documents().at(i)->startPos());
+  }
+  for (auto position = 0; position < text.length(); position++) {
+    auto node = zipped.nodeAt(position);
+    auto expected = serial.nodeAt(position);
+    QCOMPARE(bool(node), bool(expected));
+    if (node) {
+      QCOMPARE(node->type(), expected->type());
+      QCOMPARE(node->startPos(), expected->startPos());
+    }
+  }
+}
+
+void
+TestZipLoad::archiveMatchesText()
+{
+  auto archive = QYamlParser::loadArchive(m_zipFile);
+  QCOMPARE(archive.keys(), m_entries.keys());
+  for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+    QYamlParser serial;
+    serial.parse(it.value());
+    compareDocuments(archive.value(it.key()), serial.documents());
+  }
+}
+
+void
+TestZipLoad::loadBundle_data()
+{
+  QTest::addColumn<bool>("archive");
+
+  QTest::newRow("loadArchive") << true;
+  QTest::newRow("loadFromZip") << false;
+}
+
+void
+TestZipLoad::loadBundle()
+{
+  QFETCH(bool, archive);
+
+  auto loaded = 0;
+  QBENCHMARK
+  {
+    loaded = 0;
+    if (archive) {
+      loaded = int(QYamlParser::loadArchive(m_bundleFile).size());
+    } else {
+      for (auto& name : m_bundleEntries) {
+        QYamlParser parser;
+        if (parser.loadFromZip(m_bundleFile, name))
+          loaded++;
+      }
+    }
+  }
+  QCOMPARE(loaded, int(m_bundleEntries.size()));
+}
+
+QTEST_GUILESS_MAIN(TestZipLoad)
+#include "tst_zipload.moc"